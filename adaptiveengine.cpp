@@ -0,0 +1,264 @@
+#include "adaptiveengine.h"
+#include <QtMath>
+#include <algorithm>
+#include <limits>
+
+static double logSigmoid(double z)
+{
+    return z >= 0 ? -std::log1p(std::exp(-z)) : z - std::log1p(std::exp(z));
+}
+
+// P (1 - P) of the logistic function at x; 0.25 at 0, decreasing in |x|
+static double logisticSlope(double x)
+{
+    const double e = std::exp(-std::fabs(x));
+    return e / ((1.0 + e) * (1.0 + e));
+}
+
+double AdaptiveEngine::probability(const ItemParams &p, double theta)
+{
+    return 1.0 / (1.0 + std::exp(-p.a * (theta - p.b)));
+}
+
+double AdaptiveEngine::information(const ItemParams &p, double theta)
+{
+    return p.a * p.a * logisticSlope(p.a * (theta - p.b));
+}
+
+double AdaptiveEngine::gridPoint(int k)
+{
+    return MinTheta + (MaxTheta - MinTheta) * k / (GridPoints - 1);
+}
+
+int AdaptiveEngine::bucketOf(double theta)
+{
+    const int count = int((MaxTheta - MinTheta) / BucketWidth);
+    return qBound(0, int(std::floor((theta - MinTheta) / BucketWidth)), count - 1);
+}
+
+void AdaptiveEngine::setItems(QVector<ItemParams> items)
+{
+    mItems = std::move(items);
+    const int count = int((MaxTheta - MinTheta) / BucketWidth);
+    mBuckets = QVector<Bucket>(count);
+    for (int i = 0; i < count; ++i) {
+        mBuckets[i].lo = MinTheta + i * BucketWidth;
+        mBuckets[i].hi = mBuckets[i].lo + BucketWidth;
+    }
+    mMinA = MaxA;
+    mMaxA = MinA;
+    for (int i = 0; i < mItems.size(); ++i) {
+        // the bounds in nextItem() rely on every b lying inside its bucket
+        ItemParams &p = mItems[i];
+        p.a = qBound(MinA, p.a, MaxA);
+        p.b = qBound(MinTheta, p.b, MaxTheta);
+        Bucket &bk = mBuckets[bucketOf(p.b)];
+        bk.items.append(i);
+        bk.minA = qMin(bk.minA, p.a);
+        bk.maxA = qMax(bk.maxA, p.a);
+        mMinA = qMin(mMinA, p.a);
+        mMaxA = qMax(mMaxA, p.a);
+    }
+    for (Bucket &bk : mBuckets) {
+        std::sort(bk.items.begin(), bk.items.end(), [this](int x, int y) { return mItems[x].a > mItems[y].a; });
+    }
+    reset();
+}
+
+void AdaptiveEngine::reset()
+{
+    mUsed = QVector<bool>(mItems.size(), false);
+    mLogPosterior.resize(GridPoints);
+    for (int k = 0; k < GridPoints; ++k) {
+        const double g = gridPoint(k);
+        mLogPosterior[k] = -0.5 * g * g;
+    }
+    mAdministered = 0;
+    updateEstimate();
+}
+
+int AdaptiveEngine::nextItem() const
+{
+    const int nb = mBuckets.size();
+    if (nb == 0) return -1;
+    double best = -1.0;
+    int bestItem = -1;
+
+    // information of an item in the bucket is at most a^2 * slope(minA * distance to the bucket)
+    auto scan = [&](const Bucket &bk) {
+        const double d = mTheta < bk.lo ? bk.lo - mTheta : (mTheta > bk.hi ? mTheta - bk.hi : 0.0);
+        const double f = logisticSlope(bk.minA * d);
+        if (bk.maxA * bk.maxA * f <= best) return;
+        for (int i : bk.items) {
+            const ItemParams &p = mItems[i];
+            if (p.a * p.a * f <= best) break; // sorted by a
+            if (mUsed[i]) continue;
+            const double info = information(p, mTheta);
+            if (info > best) {
+                best = info;
+                bestItem = i;
+            }
+        }
+    };
+
+    const int c = bucketOf(mTheta);
+    scan(mBuckets[c]);
+    // walk outwards, always to the nearer side: distances only grow, so once the
+    // bound at the nearer edge is below the best item no bucket can beat it
+    const double inf = std::numeric_limits<double>::infinity();
+    int l = c - 1;
+    int r = c + 1;
+    while (l >= 0 || r < nb) {
+        const double dl = l >= 0 ? qMax(0.0, mTheta - mBuckets[l].hi) : inf;
+        const double dr = r < nb ? qMax(0.0, mBuckets[r].lo - mTheta) : inf;
+        const bool left = dl <= dr;
+        if (mMaxA * mMaxA * logisticSlope(mMinA * (left ? dl : dr)) <= best) break;
+        scan(mBuckets[left ? l-- : r++]);
+    }
+    return bestItem;
+}
+
+void AdaptiveEngine::record(int item, bool correct)
+{
+    if (item < 0 || item >= mItems.size() || mUsed[item]) return;
+    mUsed[item] = true;
+    ++mAdministered;
+    const ItemParams &p = mItems[item];
+    for (int k = 0; k < GridPoints; ++k) {
+        const double z = p.a * (gridPoint(k) - p.b);
+        mLogPosterior[k] += correct ? logSigmoid(z) : logSigmoid(-z);
+    }
+    updateEstimate();
+}
+
+void AdaptiveEngine::updateEstimate()
+{
+    const double m = *std::max_element(mLogPosterior.constBegin(), mLogPosterior.constEnd());
+    double sw = 0.0, swg = 0.0, swgg = 0.0;
+    for (int k = 0; k < GridPoints; ++k) {
+        const double w = std::exp(mLogPosterior[k] - m);
+        const double g = gridPoint(k);
+        sw += w;
+        swg += w * g;
+        swgg += w * g * g;
+    }
+    mTheta = swg / sw;
+    mSe = std::sqrt(qMax(0.0, swgg / sw - mTheta * mTheta));
+}
+
+bool AdaptiveEngine::finished(const StopRule &rule) const
+{
+    if (mAdministered >= mItems.size() || mAdministered >= rule.maxItems) return true;
+    return mAdministered >= rule.minItems && mSe <= rule.targetSe;
+}
+
+QVector<AdaptiveEngine::ItemParams> AdaptiveEngine::calibrate(int itemCount, int personCount,
+                                                              const QVector<Response> &responses)
+{
+    QVector<ItemParams> params(itemCount);
+    if (itemCount == 0 || personCount == 0) return params;
+
+    // responses grouped by item and by person (offsets into one index array each)
+    QVector<int> itemStart(itemCount + 1, 0), personStart(personCount + 1, 0);
+    for (const Response &r : responses) {
+        ++itemStart[r.item + 1];
+        ++personStart[r.person + 1];
+    }
+    for (int i = 0; i < itemCount; ++i) itemStart[i + 1] += itemStart[i];
+    for (int p = 0; p < personCount; ++p) personStart[p + 1] += personStart[p];
+    QVector<int> byItem(responses.size()), byPerson(responses.size());
+    {
+        QVector<int> fi = itemStart, fp = personStart;
+        for (int n = 0; n < responses.size(); ++n) {
+            byItem[fi[responses[n].item]++] = n;
+            byPerson[fp[responses[n].person]++] = n;
+        }
+    }
+
+    // start: standardized logit of the raw score
+    QVector<double> theta(personCount, 0.0);
+    {
+        double sum = 0.0, sumSq = 0.0;
+        for (int p = 0; p < personCount; ++p) {
+            int correct = 0;
+            const int n = personStart[p + 1] - personStart[p];
+            for (int j = personStart[p]; j < personStart[p + 1]; ++j) correct += responses[byPerson[j]].correct;
+            theta[p] = std::log((correct + 0.5) / (n - correct + 0.5));
+            sum += theta[p];
+            sumSq += theta[p] * theta[p];
+        }
+        const double mean = sum / personCount;
+        const double sd = std::sqrt(qMax(1e-9, sumSq / personCount - mean * mean));
+        for (double &t : theta) t = (t - mean) / sd;
+    }
+
+    // priors keep items with few or one-sided responses finite:
+    // slope ~ N(1, 0.5^2), intercept ~ N(0, 2^2)
+    const double SlopePrecision = 4.0;
+    const double InterceptPrecision = 0.25;
+    const int Rounds = 3;
+    for (int round = 0; round < Rounds; ++round) {
+        for (int i = 0; i < itemCount; ++i) {
+            if (itemStart[i] == itemStart[i + 1]) continue;
+            // logistic regression correct ~ alpha + beta * theta by Newton's method
+            double alpha = 0.0, beta = 1.0;
+            for (int iter = 0; iter < 25; ++iter) {
+                double ga = -InterceptPrecision * alpha;
+                double gb = -SlopePrecision * (beta - 1.0);
+                double haa = InterceptPrecision, hab = 0.0, hbb = SlopePrecision;
+                for (int j = itemStart[i]; j < itemStart[i + 1]; ++j) {
+                    const Response &r = responses[byItem[j]];
+                    const double t = theta[r.person];
+                    const double pr = 1.0 / (1.0 + std::exp(-(alpha + beta * t)));
+                    const double w = pr * (1.0 - pr);
+                    const double e = (r.correct ? 1.0 : 0.0) - pr;
+                    ga += e;
+                    gb += e * t;
+                    haa += w;
+                    hab += w * t;
+                    hbb += w * t * t;
+                }
+                const double det = haa * hbb - hab * hab;
+                if (det <= 1e-12) break;
+                const double da = (hbb * ga - hab * gb) / det;
+                const double db = (haa * gb - hab * ga) / det;
+                alpha += da;
+                beta += db;
+                if (std::fabs(da) + std::fabs(db) < 1e-6) break;
+            }
+            ItemParams &ip = params[i];
+            ip.a = qBound(MinA, beta, MaxA);
+            ip.b = qBound(MinTheta, -alpha / ip.a, MaxTheta);
+        }
+        if (round + 1 == Rounds) break;
+
+        // abilities from the new item parameters; then fixed to mean 0, sd 1 again
+        double sum = 0.0, sumSq = 0.0;
+        QVector<double> lp(GridPoints);
+        for (int p = 0; p < personCount; ++p) {
+            for (int k = 0; k < GridPoints; ++k) lp[k] = -0.5 * gridPoint(k) * gridPoint(k);
+            for (int j = personStart[p]; j < personStart[p + 1]; ++j) {
+                const Response &r = responses[byPerson[j]];
+                const ItemParams &ip = params[r.item];
+                for (int k = 0; k < GridPoints; ++k) {
+                    const double z = ip.a * (gridPoint(k) - ip.b);
+                    lp[k] += r.correct ? logSigmoid(z) : logSigmoid(-z);
+                }
+            }
+            const double m = *std::max_element(lp.constBegin(), lp.constEnd());
+            double sw = 0.0, swg = 0.0;
+            for (int k = 0; k < GridPoints; ++k) {
+                const double w = std::exp(lp[k] - m);
+                sw += w;
+                swg += w * gridPoint(k);
+            }
+            theta[p] = swg / sw;
+            sum += theta[p];
+            sumSq += theta[p] * theta[p];
+        }
+        const double mean = sum / personCount;
+        const double sd = std::sqrt(qMax(1e-9, sumSq / personCount - mean * mean));
+        for (double &t : theta) t = (t - mean) / sd;
+    }
+    return params;
+}
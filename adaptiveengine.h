@@ -0,0 +1,89 @@
+#ifndef ADAPTIVEENGINE_H
+#define ADAPTIVEENGINE_H
+
+#include <QVector>
+
+// Computerized adaptive testing with the two-parameter logistic IRT model:
+// P(correct | theta) = 1 / (1 + exp(-a (theta - b))), a = discrimination,
+// b = difficulty. The next item is the unused one with maximum Fisher
+// information a^2 P (1 - P) at the current ability estimate. Items are kept in
+// buckets by difficulty (sorted by a inside a bucket), so a pick scans the
+// buckets around theta only until the information bound of the rest drops
+// below the best item found; this stays far below a millisecond on banks of
+// 100k items. Ability is the EAP estimate over a fixed grid with a standard
+// normal prior, its posterior standard deviation is the standard error.
+class AdaptiveEngine
+{
+public:
+    struct ItemParams {
+        double a = 1.0; // discrimination
+        double b = 0.0; // difficulty, on the ability scale
+    };
+    // one graded answer of a past attempt, for calibration
+    struct Response {
+        int person = 0;
+        int item = 0;
+        bool correct = false;
+    };
+    struct StopRule {
+        int minItems = 5;
+        int maxItems = 20;
+        double targetSe = 0.3;
+    };
+
+    static constexpr double MinTheta = -4.0;
+    static constexpr double MaxTheta = 4.0;
+    static constexpr double BucketWidth = 0.25;
+    static constexpr double MinA = 0.2;
+    static constexpr double MaxA = 3.0;
+    static const int GridPoints = 81;
+
+    // builds the difficulty index; starts a new attempt
+    void setItems(QVector<ItemParams> items);
+    int itemCount() const { return mItems.size(); }
+    const ItemParams &item(int index) const { return mItems[index]; }
+
+    // new attempt on the same items
+    void reset();
+    // most informative unused item at the current estimate, -1 when all are used
+    int nextItem() const;
+    void record(int item, bool correct);
+    bool isAdministered(int item) const { return mUsed.value(item); }
+    int administeredCount() const { return mAdministered; }
+    double theta() const { return mTheta; }
+    double standardError() const { return mSe; }
+    bool finished(const StopRule &rule) const;
+
+    static double probability(const ItemParams &p, double theta);
+    static double information(const ItemParams &p, double theta);
+
+    // joint estimation of item parameters and abilities from past answers
+    // (alternating: item logistic fits with weak priors, then EAP abilities);
+    // items without responses get the defaults
+    static QVector<ItemParams> calibrate(int itemCount, int personCount, const QVector<Response> &responses);
+
+private:
+    struct Bucket {
+        QVector<int> items; // sorted by a, descending
+        double lo = 0.0;
+        double hi = 0.0;
+        double minA = MaxA;
+        double maxA = 0.0;
+    };
+
+    static double gridPoint(int k);
+    static int bucketOf(double theta);
+    void updateEstimate();
+
+    QVector<ItemParams> mItems;
+    QVector<Bucket> mBuckets;
+    double mMinA = MinA;
+    double mMaxA = MaxA;
+    QVector<bool> mUsed;
+    QVector<double> mLogPosterior; // over the ability grid
+    double mTheta = 0.0;
+    double mSe = 1.0;
+    int mAdministered = 0;
+};
+
+#endif // ADAPTIVEENGINE_H
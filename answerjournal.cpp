@@ -0,0 +1,213 @@
+#include "answerjournal.h"
+#include <QDir>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QUuid>
+#include <QtEndian>
+#include <QDebug>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static quint32 crc32(const QByteArray &data)
+{
+    static quint32 table[256];
+    static bool tableReady = false;
+    if (!tableReady) {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : (c >> 1);
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+    quint32 crc = 0xFFFFFFFFu;
+    for (char ch : data) crc = table[(crc ^ quint8(ch)) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+AnswerJournal::AnswerJournal(QObject *parent)
+    : QObject(parent)
+{
+    mSyncTimer.setSingleShot(true);
+    mSyncTimer.setInterval(SyncIntervalMs);
+    connect(&mSyncTimer, &QTimer::timeout, this, &AnswerJournal::sync);
+}
+
+AnswerJournal::~AnswerJournal()
+{
+    sync();
+}
+
+QString AnswerJournal::journalDir()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/journals";
+}
+
+bool AnswerJournal::begin(const QString &testId, const QString &email, const QStringList &questionIds, QString *err)
+{
+    sync();
+    mFile.close();
+    QDir().mkpath(journalDir());
+    const QString sessionId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    mSessionId = sessionId;
+    mFile.setFileName(journalDir() + "/" + sessionId + ".qtj");
+    if (!mFile.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        if (err) *err = mFile.errorString();
+        return false;
+    }
+    QByteArray payload;
+    QDataStream ds(&payload, QIODevice::WriteOnly);
+    ds << quint8(BeginRecord) << sessionId << testId << email << QDateTime::currentDateTimeUtc() << questionIds;
+    if (!appendRecord(payload)) {
+        if (err) *err = mFile.errorString();
+        return false;
+    }
+    sync(); // the attempt itself must survive
+    return true;
+}
+
+bool AnswerJournal::resume(const Session &s, QString *err)
+{
+    sync();
+    mFile.close();
+    qint64 validSize = 0;
+    Session check;
+    if (!readSession(s.path, &check, &validSize)) {
+        if (err) *err = "Deník odpovědí nelze přečíst.";
+        return false;
+    }
+    mFile.setFileName(s.path);
+    mSessionId = s.sessionId;
+    if (!mFile.open(QIODevice::ReadWrite | QIODevice::Unbuffered)) {
+        if (err) *err = mFile.errorString();
+        return false;
+    }
+    // drop a torn record at the end before appending
+    if (mFile.size() != validSize) mFile.resize(validSize);
+    mFile.seek(validSize);
+    return true;
+}
+
+bool AnswerJournal::appendRecord(const QByteArray &payload)
+{
+    QByteArray rec(8, Qt::Uninitialized);
+    qToLittleEndian<quint32>(quint32(payload.size()), rec.data());
+    qToLittleEndian<quint32>(crc32(payload), rec.data() + 4);
+    rec += payload;
+    if (mFile.write(rec) != rec.size()) {
+        qDebug() << "Answer journal write failed:" << mFile.errorString();
+        return false;
+    }
+    mDirty = true;
+    if (!mSyncTimer.isActive()) mSyncTimer.start();
+    return true;
+}
+
+void AnswerJournal::recordAnswer(int index, const QString &questionId, const QString &answer)
+{
+    if (!mFile.isOpen()) return;
+    QByteArray payload;
+    QDataStream ds(&payload, QIODevice::WriteOnly);
+    ds << quint8(AnswerRecord) << qint32(index) << questionId << answer;
+    appendRecord(payload);
+}
+
+void AnswerJournal::recordQuestion(int index, const QString &questionId)
+{
+    if (!mFile.isOpen()) return;
+    QByteArray payload;
+    QDataStream ds(&payload, QIODevice::WriteOnly);
+    ds << quint8(QuestionRecord) << qint32(index) << questionId;
+    appendRecord(payload);
+}
+
+void AnswerJournal::sync()
+{
+    mSyncTimer.stop();
+    if (!mDirty || !mFile.isOpen()) return;
+#ifdef Q_OS_WIN
+    _commit(mFile.handle());
+#else
+    ::fsync(mFile.handle());
+#endif
+    mDirty = false;
+}
+
+void AnswerJournal::finish()
+{
+    mSyncTimer.stop();
+    mDirty = false;
+    if (mFile.isOpen()) {
+        mFile.close();
+        mFile.remove();
+    }
+}
+
+bool AnswerJournal::readSession(const QString &path, Session *s, qint64 *validSize)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    const QByteArray data = f.readAll();
+    *s = Session();
+    s->path = path;
+
+    qint64 pos = 0;
+    bool haveBegin = false;
+    while (pos + 8 <= data.size()) {
+        const quint32 len = qFromLittleEndian<quint32>(data.constData() + pos);
+        const quint32 crc = qFromLittleEndian<quint32>(data.constData() + pos + 4);
+        if (pos + 8 + qint64(len) > data.size()) break; // torn tail
+        const QByteArray payload = data.mid(pos + 8, len);
+        if (crc32(payload) != crc) break;
+
+        QDataStream ds(payload);
+        quint8 type = 0;
+        ds >> type;
+        if (type == BeginRecord && !haveBegin) {
+            ds >> s->sessionId >> s->testId >> s->email >> s->started >> s->questionIds;
+            s->answers.resize(s->questionIds.size());
+            haveBegin = true;
+        } else if (type == AnswerRecord && haveBegin) {
+            qint32 index = -1;
+            QString questionId, answer;
+            ds >> index >> questionId >> answer;
+            if (index >= 0 && index < s->questionIds.size() && s->questionIds[index] == questionId) {
+                s->answers[index] = answer;
+            }
+        } else if (type == QuestionRecord && haveBegin) {
+            qint32 index = -1;
+            QString questionId;
+            ds >> index >> questionId;
+            if (index == s->questionIds.size()) {
+                s->questionIds.append(questionId);
+                s->answers.append(QString());
+            }
+        }
+        if (ds.status() != QDataStream::Ok) break;
+        pos += 8 + len;
+    }
+    if (validSize) *validSize = pos;
+    for (const QString &a : std::as_const(s->answers)) if (!a.isEmpty()) ++s->answeredCount;
+    return haveBegin;
+}
+
+QVector<AnswerJournal::Session> AnswerJournal::pendingSessions()
+{
+    QVector<Session> out;
+    QDir dir(journalDir());
+    const QStringList files = dir.entryList(QStringList() << "*.qtj", QDir::Files, QDir::Time);
+    for (const QString &f : files) {
+        Session s;
+        if (readSession(dir.filePath(f), &s)) out.append(s);
+        else QFile::remove(dir.filePath(f)); // not even the attempt header made it to disk
+    }
+    return out;
+}
+
+void AnswerJournal::discard(const Session &s)
+{
+    QFile::remove(s.path);
+}
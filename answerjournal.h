@@ -0,0 +1,68 @@
+#ifndef ANSWERJOURNAL_H
+#define ANSWERJOURNAL_H
+
+#include <QObject>
+#include <QFile>
+#include <QTimer>
+#include <QDateTime>
+#include <QStringList>
+#include <QVector>
+
+// Append-only journal of one student attempt, so that a crash or power cut does
+// not lose the answers given so far. Every answer is appended as one record
+// (length + CRC32 + payload) right when it is given; fsync is batched by a short
+// timer so a click costs one write() only. Journals of unfinished attempts are
+// found by pendingSessions() on the next start and can be replayed.
+class AnswerJournal : public QObject
+{
+    Q_OBJECT
+public:
+    // state of an attempt reconstructed from its journal
+    struct Session {
+        QString path;
+        QString sessionId;
+        QString testId;
+        QString email;
+        QDateTime started;
+        QStringList questionIds; // drawn questions in the order shown
+        QVector<QString> answers; // parallel to questionIds, last record wins
+        int answeredCount = 0;
+    };
+
+    static const int SyncIntervalMs = 250;
+
+    explicit AnswerJournal(QObject *parent = nullptr);
+    ~AnswerJournal() override;
+
+    // start journaling a new attempt (closes a previous one without deleting it)
+    bool begin(const QString &testId, const QString &email, const QStringList &questionIds, QString *err = nullptr);
+    // continue appending to a replayed session
+    bool resume(const Session &s, QString *err = nullptr);
+    bool isActive() const { return mFile.isOpen(); }
+    // id of the journaled attempt (also seeds its parametric questions)
+    QString sessionId() const { return mSessionId; }
+
+    void recordAnswer(int index, const QString &questionId, const QString &answer);
+    // question added to the running attempt (adaptive tests draw one at a time)
+    void recordQuestion(int index, const QString &questionId);
+    // attempt is over (result saved or abandoned): journal is removed
+    void finish();
+    // force pending records to disk
+    void sync();
+
+    static QString journalDir();
+    static QVector<Session> pendingSessions();
+    static bool readSession(const QString &path, Session *s, qint64 *validSize = nullptr);
+    static void discard(const Session &s);
+
+private:
+    enum RecordType : quint8 { BeginRecord = 1, AnswerRecord = 2, QuestionRecord = 3 };
+    bool appendRecord(const QByteArray &payload);
+
+    QFile mFile;
+    QString mSessionId;
+    QTimer mSyncTimer;
+    bool mDirty = false;
+};
+
+#endif // ANSWERJOURNAL_H
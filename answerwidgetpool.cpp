@@ -0,0 +1,125 @@
+#include "answerwidgetpool.h"
+#include <QVBoxLayout>
+#include <QLineEdit>
+#include <QRadioButton>
+#include <QCheckBox>
+#include <QButtonGroup>
+
+AnswerWidgetPool::AnswerWidgetPool(QWidget *parent)
+    : QWidget(parent)
+{
+    mLayout = new QVBoxLayout;
+    mLayout->setContentsMargins(0,0,0,0);
+    setLayout(mLayout);
+
+    mTextEdit = new QLineEdit;
+    mTextEdit->hide();
+    mLayout->addWidget(mTextEdit);
+
+    // one group for the whole lifetime of the pool (no group per question)
+    mRadioGroup = new QButtonGroup(this);
+    mRadioGroup->setExclusive(true);
+}
+
+void AnswerWidgetPool::reserve(int n)
+{
+    if (n <= mRadios.size()) return;
+    mRadios.reserve(n);
+    mChecks.reserve(n);
+    for (int i = mRadios.size(); i < n; ++i) {
+        QRadioButton *rb = new QRadioButton;
+        rb->hide();
+        mLayout->addWidget(rb);
+        mRadioGroup->addButton(rb, i);
+        mRadios.append(rb);
+
+        QCheckBox *cb = new QCheckBox;
+        cb->hide();
+        mLayout->addWidget(cb);
+        mChecks.append(cb);
+    }
+}
+
+void AnswerWidgetPool::bind(const Question &q, const QVector<int> &order,
+                            const QStringList &selected, const QString &text)
+{
+    // avoid repainting every single widget while they are rebound
+    setUpdatesEnabled(false);
+
+    mType = q.type;
+    const bool isText = (q.type == QuestionType::TextAnswer);
+    const bool isSingle = (q.type == QuestionType::SingleChoice);
+    const int m = isText ? 0 : order.size();
+    reserve(m);
+
+    mTextEdit->setText(isText ? text : QString());
+    mTextEdit->setVisible(isText);
+
+    // exclusive group does not allow unchecking the checked radio button
+    mRadioGroup->setExclusive(false);
+    for (int i = 0; i < mRadios.size(); ++i) {
+        QRadioButton *rb = mRadios[i];
+        QCheckBox *cb = mChecks[i];
+        if (i < m) {
+            const QString &optText = q.options[order[i]].text;
+            const bool checked = selected.contains(optText);
+            if (isSingle) {
+                rb->setText(optText);
+                rb->setChecked(checked);
+                cb->setChecked(false);
+            } else {
+                cb->setText(optText);
+                cb->setChecked(checked);
+                rb->setChecked(false);
+            }
+            rb->setVisible(isSingle);
+            cb->setVisible(!isSingle);
+        } else {
+            rb->setChecked(false);
+            cb->setChecked(false);
+            rb->setVisible(false);
+            cb->setVisible(false);
+        }
+    }
+    mRadioGroup->setExclusive(true);
+    mBoundCount = m;
+
+    setUpdatesEnabled(true);
+}
+
+void AnswerWidgetPool::clear()
+{
+    setUpdatesEnabled(false);
+    mTextEdit->clear();
+    mTextEdit->hide();
+    mRadioGroup->setExclusive(false);
+    for (int i = 0; i < mRadios.size(); ++i) {
+        mRadios[i]->setChecked(false);
+        mRadios[i]->hide();
+        mChecks[i]->setChecked(false);
+        mChecks[i]->hide();
+    }
+    mRadioGroup->setExclusive(true);
+    mBoundCount = 0;
+    setUpdatesEnabled(true);
+}
+
+QString AnswerWidgetPool::textAnswer() const
+{
+    if (mType != QuestionType::TextAnswer) return QString();
+    return mTextEdit->text().trimmed();
+}
+
+QStringList AnswerWidgetPool::selectedOptionTexts() const
+{
+    QStringList sel;
+    if (mType == QuestionType::TextAnswer) return sel;
+    for (int i = 0; i < mBoundCount; ++i) {
+        if (mType == QuestionType::SingleChoice) {
+            if (mRadios[i]->isChecked()) { sel.append(mRadios[i]->text()); break; }
+        } else {
+            if (mChecks[i]->isChecked()) sel.append(mChecks[i]->text());
+        }
+    }
+    return sel;
+}
@@ -0,0 +1,50 @@
+#ifndef ANSWERWIDGETPOOL_H
+#define ANSWERWIDGETPOOL_H
+
+#include <QWidget>
+#include <QVector>
+#include <QStringList>
+#include "models.h"
+
+class QLineEdit;
+class QRadioButton;
+class QCheckBox;
+class QButtonGroup;
+class QVBoxLayout;
+
+// Reusable set of answer controls (radio buttons / check boxes / line edit).
+// Widgets are created once and only rebound to the data of the current question,
+// so navigation between questions does not allocate or destroy widgets.
+class AnswerWidgetPool : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit AnswerWidgetPool(QWidget *parent = nullptr);
+
+    // make sure questions with up to n options can be shown without creating widgets
+    void reserve(int n);
+    int capacity() const { return mRadios.size(); }
+
+    // show question q; order is the permutation of option indices to display,
+    // selected are texts of previously chosen options, text is previous text answer
+    void bind(const Question &q, const QVector<int> &order,
+              const QStringList &selected = QStringList(), const QString &text = QString());
+    // hide all controls
+    void clear();
+
+    // read back state of the bound question
+    QString textAnswer() const;
+    QStringList selectedOptionTexts() const;
+
+private:
+    QVBoxLayout *mLayout;
+    QLineEdit *mTextEdit;
+    QButtonGroup *mRadioGroup;
+    QVector<QRadioButton*> mRadios;
+    QVector<QCheckBox*> mChecks;
+
+    QuestionType mType = QuestionType::SingleChoice;
+    int mBoundCount = 0; // number of option widgets currently in use
+};
+
+#endif // ANSWERWIDGETPOOL_H
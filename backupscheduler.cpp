@@ -0,0 +1,177 @@
+#include "backupscheduler.h"
+#include <QThread>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QDebug>
+#include <sqlite3.h>
+#include <zlib.h>
+
+BackupScheduler::BackupScheduler(QObject *parent)
+    : QObject(parent)
+{
+    mOptions.directory = defaultDirectory();
+    connect(&mTimer, &QTimer::timeout, this, &BackupScheduler::backupNow);
+}
+
+BackupScheduler::~BackupScheduler()
+{
+    if (mWorker) {
+        mCancel = true;
+        mWorker->wait();
+    }
+}
+
+QString BackupScheduler::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/backups";
+}
+
+void BackupScheduler::setOptions(const Options &o)
+{
+    mOptions = o;
+    if (mOptions.intervalMinutes > 0) mTimer.start(mOptions.intervalMinutes * 60 * 1000);
+    else mTimer.stop();
+}
+
+void BackupScheduler::backupNow()
+{
+    if (mWorker || mDbPath.isEmpty()) return; // previous backup still running
+    QDir().mkpath(mOptions.directory);
+    const QString base = QFileInfo(mDbPath).completeBaseName();
+    const QString dest = QDir(mOptions.directory).filePath(
+        base + "-" + QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss") + (mOptions.compress ? ".db.gz" : ".db"));
+
+    const QString dbPath = mDbPath;
+    const Options o = mOptions;
+    mCancel = false;
+    auto result = std::make_shared<QString>();
+    auto ok = std::make_shared<bool>(false);
+    QThread *worker = QThread::create([this, dbPath, dest, o, result, ok]() {
+        *ok = backupDatabase(dbPath, dest, o, &mCancel, result.get());
+        if (*ok) rotate(dbPath, o.directory, o.keepCount);
+    });
+    worker->setObjectName("db-backup");
+    connect(worker, &QThread::finished, this, [this, worker, dest, result, ok]() {
+        worker->deleteLater();
+        mWorker = nullptr;
+        if (*ok) qDebug() << "Backup written to" << dest;
+        else qDebug() << "Backup failed:" << *result;
+        emit backupFinished(*ok, *ok ? dest : *result);
+    });
+    mWorker = worker;
+    worker->start(QThread::LowPriority);
+}
+
+static bool gzipFile(const QString &src, const QString &dest, QString *err)
+{
+    QFile in(src);
+    if (!in.open(QIODevice::ReadOnly)) {
+        if (err) *err = in.errorString();
+        return false;
+    }
+    gzFile out = gzopen(QFile::encodeName(dest).constData(), "wb6");
+    if (!out) {
+        if (err) *err = "Cannot create " + dest;
+        return false;
+    }
+    QByteArray buf(1 << 16, Qt::Uninitialized);
+    for (;;) {
+        const qint64 n = in.read(buf.data(), buf.size());
+        if (n <= 0) break;
+        if (gzwrite(out, buf.constData(), unsigned(n)) != int(n)) {
+            gzclose(out);
+            if (err) *err = "Write error: " + dest;
+            return false;
+        }
+    }
+    if (gzclose(out) != Z_OK) {
+        if (err) *err = "Write error: " + dest;
+        return false;
+    }
+    return true;
+}
+
+bool BackupScheduler::backupDatabase(const QString &dbPath, const QString &destPath, const Options &o,
+                                     const std::atomic<bool> *cancel, QString *err)
+{
+    const QString tmpPath = destPath + ".part";
+    QFile::remove(tmpPath);
+    sqlite3 *src = nullptr;
+    sqlite3 *dst = nullptr;
+    sqlite3_backup *bk = nullptr;
+    bool ok = false;
+    int rc = SQLITE_OK;
+
+    auto fail = [&](sqlite3 *db, const QString &what) {
+        if (err) *err = what + ": " + QString::fromUtf8(db ? sqlite3_errmsg(db) : sqlite3_errstr(rc));
+    };
+
+    if ((rc = sqlite3_open_v2(QFile::encodeName(dbPath).constData(), &src, SQLITE_OPEN_READONLY, nullptr)) != SQLITE_OK) {
+        fail(src, dbPath);
+    } else if ((rc = sqlite3_open_v2(QFile::encodeName(tmpPath).constData(), &dst,
+                                     SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr)) != SQLITE_OK) {
+        fail(dst, tmpPath);
+    } else {
+        sqlite3_busy_timeout(src, 5000);
+        // in WAL mode keep one snapshot for all steps (reads the schema, so the transaction
+        // really starts); in rollback-journal mode that would lock writers out until the end,
+        // so there each step reads on its own and a commit meanwhile restarts the copy
+        sqlite3_stmt *mode = nullptr;
+        bool wal = false;
+        if (sqlite3_prepare_v2(src, "PRAGMA journal_mode", -1, &mode, nullptr) == SQLITE_OK && sqlite3_step(mode) == SQLITE_ROW)
+            wal = qstricmp(reinterpret_cast<const char *>(sqlite3_column_text(mode, 0)), "wal") == 0;
+        sqlite3_finalize(mode);
+        if (wal) sqlite3_exec(src, "BEGIN; SELECT count(*) FROM sqlite_master;", nullptr, nullptr, nullptr);
+        bk = sqlite3_backup_init(dst, "main", src, "main");
+        if (!bk) {
+            fail(dst, "Backup init");
+        } else {
+            for (;;) {
+                rc = sqlite3_backup_step(bk, o.pagesPerStep);
+                if (rc == SQLITE_DONE) { ok = true; break; }
+                if (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) { fail(dst, "Backup step"); break; }
+                if (cancel && *cancel) {
+                    if (err) *err = "Backup cancelled";
+                    break;
+                }
+                QThread::msleep(rc == SQLITE_OK ? o.pauseMs : 50);
+            }
+            sqlite3_backup_finish(bk);
+        }
+        if (wal) sqlite3_exec(src, "COMMIT", nullptr, nullptr, nullptr);
+    }
+    sqlite3_close_v2(src);
+    if (dst && (rc = sqlite3_close_v2(dst)) != SQLITE_OK && ok) {
+        fail(nullptr, "Backup close");
+        ok = false;
+    }
+
+    if (ok) {
+        // finished file appears under its final name only when complete
+        const QString written = o.compress ? destPath + ".part.gz" : tmpPath;
+        if (o.compress && !gzipFile(tmpPath, written, err)) {
+            ok = false;
+        } else {
+            QFile::remove(destPath);
+            ok = QFile::rename(written, destPath);
+            if (!ok && err) *err = "Cannot write " + destPath;
+        }
+        if (o.compress) QFile::remove(destPath + ".part.gz");
+    }
+    QFile::remove(tmpPath);
+    return ok;
+}
+
+void BackupScheduler::rotate(const QString &dbPath, const QString &directory, int keepCount)
+{
+    if (keepCount <= 0) return;
+    const QString base = QFileInfo(dbPath).completeBaseName();
+    QDir dir(directory);
+    // timestamped names sort chronologically
+    QStringList files = dir.entryList(QStringList() << base + "-????????-??????.db" << base + "-????????-??????.db.gz",
+                                      QDir::Files, QDir::Name);
+    while (files.size() > keepCount) dir.remove(files.takeFirst());
+}
@@ -0,0 +1,67 @@
+#ifndef BACKUPSCHEDULER_H
+#define BACKUPSCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QPointer>
+#include <atomic>
+
+class QThread;
+
+// Periodic online backup of the SQLite database.
+//
+// The copy is made with the SQLite backup API on a worker thread, a few
+// hundred pages per step with a short pause in between, so the UI and the
+// exam server keep working. In WAL mode the source is read inside one read
+// transaction: writers are not blocked and the copy is a consistent snapshot (it
+// is not restarted by commits made meanwhile). In rollback-journal mode each step
+// holds the read lock only for its own pages, so writers wait briefly per step,
+// and a commit by another connection restarts the copy. Backups are named
+// <db name>-yyyyMMdd-HHmmss.db(.gz), optionally gzip compressed, and only the
+// newest keepCount files are kept.
+//
+// Uses the system SQLite on its own connection; on Unix the Qt SQLite driver
+// must use the same library (the default for distribution Qt packages).
+class BackupScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options {
+        QString directory;
+        int intervalMinutes = 60; // 0 = only on request
+        int keepCount = 10;
+        bool compress = true;
+        int pagesPerStep = 256;
+        int pauseMs = 5;
+    };
+
+    explicit BackupScheduler(QObject *parent = nullptr);
+    ~BackupScheduler() override;
+
+    void setDatabasePath(const QString &path) { mDbPath = path; }
+    void setOptions(const Options &o);
+    const Options &options() const { return mOptions; }
+    bool isRunning() const { return mWorker != nullptr; }
+
+    static QString defaultDirectory();
+    // synchronous backup (worker thread body, also used by the CLI)
+    static bool backupDatabase(const QString &dbPath, const QString &destPath, const Options &o,
+                               const std::atomic<bool> *cancel = nullptr, QString *err = nullptr);
+    // delete all but the newest keepCount backups of dbPath in directory
+    static void rotate(const QString &dbPath, const QString &directory, int keepCount);
+
+public slots:
+    void backupNow();
+
+signals:
+    void backupFinished(bool ok, const QString &pathOrError);
+
+private:
+    QString mDbPath;
+    Options mOptions;
+    QTimer mTimer;
+    QPointer<QThread> mWorker;
+    std::atomic<bool> mCancel{false};
+};
+
+#endif // BACKUPSCHEDULER_H
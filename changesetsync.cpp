@@ -0,0 +1,273 @@
+#include "changesetsync.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <sqlite3.h>
+#include <memory>
+
+static const char SyncMagic[8] = { 'Q', 'T', 'M', 'S', 'Y', 'N', 'C', '1' };
+static const quint32 SyncFormatVersion = 1;
+
+namespace {
+struct DbCloser { void operator()(sqlite3 *db) const { sqlite3_close_v2(db); } };
+struct SessionDeleter { void operator()(sqlite3_session *s) const { sqlite3session_delete(s); } };
+using DbPtr = std::unique_ptr<sqlite3, DbCloser>;
+using SessionPtr = std::unique_ptr<sqlite3_session, SessionDeleter>;
+
+struct ConflictContext {
+    ChangesetSync::ConflictPolicy policy;
+    int conflicts = 0;
+};
+}
+
+static DbPtr openDb(const QString &path, bool create, QString *err)
+{
+    sqlite3 *raw = nullptr;
+    const int flags = SQLITE_OPEN_READWRITE | (create ? SQLITE_OPEN_CREATE : 0);
+    const int rc = sqlite3_open_v2(QFile::encodeName(path).constData(), &raw, flags, nullptr);
+    DbPtr db(raw);
+    if (rc != SQLITE_OK) {
+        if (err) *err = path + ": " + (raw ? QString::fromUtf8(sqlite3_errmsg(raw)) : QString::fromUtf8(sqlite3_errstr(rc)));
+        return DbPtr();
+    }
+    sqlite3_busy_timeout(raw, 5000); // the application may be writing meanwhile
+    return db;
+}
+
+static bool execSql(sqlite3 *db, const QString &sql, QString *err)
+{
+    char *msg = nullptr;
+    if (sqlite3_exec(db, sql.toUtf8().constData(), nullptr, nullptr, &msg) != SQLITE_OK) {
+        if (err) *err = QString::fromUtf8(msg ? msg : sqlite3_errmsg(db)) + "\nQuery: " + sql;
+        sqlite3_free(msg);
+        return false;
+    }
+    return true;
+}
+
+// single text column of the first row, or the column of every row when all is set
+static QStringList queryStrings(sqlite3 *db, const QString &sql, const QString &bind, int column, bool all)
+{
+    QStringList out;
+    sqlite3_stmt *st = nullptr;
+    if (sqlite3_prepare_v2(db, sql.toUtf8().constData(), -1, &st, nullptr) != SQLITE_OK) return out;
+    const QByteArray b = bind.toUtf8();
+    if (!bind.isNull()) sqlite3_bind_text(st, 1, b.constData(), b.size(), SQLITE_TRANSIENT);
+    while (sqlite3_step(st) == SQLITE_ROW) {
+        out.append(QString::fromUtf8(reinterpret_cast<const char*>(sqlite3_column_text(st, column))));
+        if (!all) break;
+    }
+    sqlite3_finalize(st);
+    return out;
+}
+
+static QStringList tableColumns(sqlite3 *db, const QString &schema, const QString &table)
+{
+    return queryStrings(db, QString("PRAGMA %1.table_info(%2)").arg(schema, table), QString(), 1, true);
+}
+
+static int onConflict(void *ctx, int conflict, sqlite3_changeset_iter *)
+{
+    ConflictContext *c = static_cast<ConflictContext*>(ctx);
+    ++c->conflicts;
+    if (c->policy == ChangesetSync::ConflictPolicy::Abort) return SQLITE_CHANGESET_ABORT;
+    // REPLACE is only allowed for DATA and CONFLICT; missing rows and constraint failures are skipped
+    if (c->policy == ChangesetSync::ConflictPolicy::Overwrite
+        && (conflict == SQLITE_CHANGESET_DATA || conflict == SQLITE_CHANGESET_CONFLICT))
+        return SQLITE_CHANGESET_REPLACE;
+    return SQLITE_CHANGESET_OMIT;
+}
+
+QStringList ChangesetSync::syncedTables()
+{
+    return QStringList{ "tests", "questions", "options", "results", "result_details" };
+}
+
+bool ChangesetSync::exportChanges(const QString &dbPath, const QString &basePath, const QString &outFile,
+                                  int *changeCount, QString *err)
+{
+    DbPtr db = openDb(dbPath, false, err);
+    if (!db) return false;
+    const QStringList tables = syncedTables();
+
+    // no base yet: empty tables with the current definitions, the first export is full
+    if (!QFile::exists(basePath)) {
+        DbPtr base = openDb(basePath, true, err);
+        if (!base) return false;
+        for (const QString &t : tables) {
+            const QStringList sql = queryStrings(db.get(), "SELECT sql FROM sqlite_master WHERE type = 'table' AND name = ?", t, 0, false);
+            if (sql.isEmpty()) {
+                if (err) *err = "Missing table " + t;
+                return false;
+            }
+            if (!execSql(base.get(), sql.first(), err)) return false;
+        }
+    }
+
+    QString attach = basePath;
+    attach.replace("'", "''");
+    if (!execSql(db.get(), "ATTACH DATABASE '" + attach + "' AS syncbase", err)) return false;
+
+    QList<QStringList> columns;
+    for (const QString &t : tables) {
+        columns.append(tableColumns(db.get(), "main", t));
+        if (columns.last() != tableColumns(db.get(), "syncbase", t)) {
+            if (err) *err = QString("Table %1 differs from the sync base; delete %2 for a full export.").arg(t, basePath);
+            return false;
+        }
+    }
+
+    // one read transaction: all tables are diffed against the same snapshot
+    QByteArray changeset;
+    {
+        if (!execSql(db.get(), "BEGIN", err)) return false;
+        sqlite3_session *raw = nullptr;
+        if (sqlite3session_create(db.get(), "main", &raw) != SQLITE_OK) {
+            if (err) *err = QString::fromUtf8(sqlite3_errmsg(db.get()));
+            execSql(db.get(), "ROLLBACK", nullptr);
+            return false;
+        }
+        SessionPtr session(raw);
+        for (const QString &t : tables) {
+            const QByteArray tn = t.toUtf8();
+            char *msg = nullptr;
+            if (sqlite3session_attach(session.get(), tn.constData()) != SQLITE_OK
+                || sqlite3session_diff(session.get(), "syncbase", tn.constData(), &msg) != SQLITE_OK) {
+                if (err) *err = t + ": " + QString::fromUtf8(msg ? msg : sqlite3_errmsg(db.get()));
+                sqlite3_free(msg);
+                execSql(db.get(), "ROLLBACK", nullptr);
+                return false;
+            }
+        }
+        int n = 0;
+        void *buf = nullptr;
+        if (sqlite3session_changeset(session.get(), &n, &buf) != SQLITE_OK) {
+            if (err) *err = QString::fromUtf8(sqlite3_errmsg(db.get()));
+            execSql(db.get(), "ROLLBACK", nullptr);
+            return false;
+        }
+        changeset = QByteArray(static_cast<const char*>(buf), n);
+        sqlite3_free(buf);
+        session.reset();
+        execSql(db.get(), "COMMIT", nullptr);
+    }
+    execSql(db.get(), "DETACH DATABASE syncbase", nullptr);
+    db.reset();
+
+    int count = 0;
+    sqlite3_changeset_iter *it = nullptr;
+    if (!changeset.isEmpty() && sqlite3changeset_start(&it, changeset.size(), changeset.data()) == SQLITE_OK) {
+        while (sqlite3changeset_next(it) == SQLITE_ROW) ++count;
+        sqlite3changeset_finalize(it);
+    }
+    if (changeCount) *changeCount = count;
+
+    QSaveFile f(outFile);
+    if (!f.open(QIODevice::WriteOnly)) {
+        if (err) *err = f.errorString();
+        return false;
+    }
+    f.write(SyncMagic, sizeof(SyncMagic));
+    QDataStream ds(&f);
+    ds.setVersion(QDataStream::Qt_6_0);
+    ds << SyncFormatVersion << QDateTime::currentDateTimeUtc() << tables << columns
+       << quint32(changeset.size()) << qCompress(changeset);
+    if (ds.status() != QDataStream::Ok || !f.commit()) {
+        if (err) *err = f.errorString();
+        return false;
+    }
+
+    // move the base forward by the same delta (no full copy of the database)
+    if (count > 0) {
+        DbPtr base = openDb(basePath, false, err);
+        if (!base) return false;
+        ConflictContext ctx{ ConflictPolicy::Overwrite };
+        if (sqlite3changeset_apply(base.get(), changeset.size(), changeset.data(), nullptr, onConflict, &ctx) != SQLITE_OK) {
+            if (err) *err = "Sync base update failed: " + QString::fromUtf8(sqlite3_errmsg(base.get()));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ChangesetSync::applyChanges(const QString &dbPath, const QString &inFile, ConflictPolicy policy,
+                                 ApplyStats *stats, QString *err)
+{
+    QFile f(inFile);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (err) *err = f.errorString();
+        return false;
+    }
+    if (f.read(sizeof(SyncMagic)) != QByteArray(SyncMagic, sizeof(SyncMagic))) {
+        if (err) *err = "Not a sync file: " + inFile;
+        return false;
+    }
+    QDataStream ds(&f);
+    ds.setVersion(QDataStream::Qt_6_0);
+    quint32 version = 0;
+    QDateTime created;
+    QStringList tables;
+    QList<QStringList> columns;
+    quint32 rawSize = 0;
+    QByteArray compressed;
+    ds >> version >> created >> tables >> columns >> rawSize >> compressed;
+    if (ds.status() != QDataStream::Ok || version != SyncFormatVersion || tables.size() != columns.size()) {
+        if (err) *err = "Unsupported or damaged sync file: " + inFile;
+        return false;
+    }
+    QByteArray changeset = qUncompress(compressed);
+    if (quint32(changeset.size()) != rawSize) {
+        if (err) *err = "Damaged sync file: " + inFile;
+        return false;
+    }
+
+    DbPtr db = openDb(dbPath, false, err);
+    if (!db) return false;
+    // changesets address columns by position, so the layouts must agree
+    for (int i = 0; i < tables.size(); ++i) {
+        if (tableColumns(db.get(), "main", tables[i]) != columns[i]) {
+            if (err) *err = QString("Table %1 has a different layout than in the sync file.").arg(tables[i]);
+            return false;
+        }
+    }
+
+    ApplyStats st;
+    bool testsChanged = false;
+    sqlite3_changeset_iter *it = nullptr;
+    if (!changeset.isEmpty() && sqlite3changeset_start(&it, changeset.size(), changeset.data()) == SQLITE_OK) {
+        while (sqlite3changeset_next(it) == SQLITE_ROW) {
+            const char *table = nullptr;
+            int nCol = 0, op = 0, indirect = 0;
+            sqlite3changeset_op(it, &table, &nCol, &op, &indirect);
+            const QString t = QString::fromUtf8(table);
+            if (t == "questions" || t == "options") st.questionsChanged = true;
+            if (t == "tests") testsChanged = true;
+            ++st.changes;
+        }
+        sqlite3changeset_finalize(it);
+    }
+
+    if (st.changes > 0) {
+        ConflictContext ctx{ policy };
+        const int rc = sqlite3changeset_apply(db.get(), changeset.size(), changeset.data(), nullptr, onConflict, &ctx);
+        st.conflicts = ctx.conflicts;
+        if (rc != SQLITE_OK) {
+            if (err) *err = rc == SQLITE_ABORT ? QString("Conflict found, nothing was applied (%1 conflicts).").arg(ctx.conflicts)
+                                              : QString::fromUtf8(sqlite3_errmsg(db.get()));
+            return false;
+        }
+    }
+    if (st.questionsChanged || testsChanged) {
+        // running editors and exam hosts reload everything (see DBManager::pollChanges);
+        // older databases without change_log simply have nobody to notify; 3 = Change::Reset
+        QString logErr;
+        if (!execSql(db.get(), "INSERT INTO change_log (origin, tbl, op) VALUES (0, '*', 3)", &logErr))
+            qDebug() << "Sync: change not logged:" << logErr;
+    }
+    qDebug() << "Sync: applied" << st.changes << "changes from" << inFile << "created" << created
+             << "," << st.conflicts << "conflicts";
+    if (stats) *stats = st;
+    return true;
+}
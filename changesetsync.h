@@ -0,0 +1,49 @@
+#ifndef CHANGESETSYNC_H
+#define CHANGESETSYNC_H
+
+#include <QString>
+#include <QStringList>
+
+// DB-to-DB synchronization with SQLite session changesets.
+//
+// Export compares the database with its sync base (<db>.syncbase, the state
+// at the previous export) using sqlite3session_diff, so only rows that changed
+// since then end up in the file; the base is then moved forward by applying
+// the same changeset to it. Deleting the base makes the next export a full one.
+// Apply replays a changeset on another database with a conflict policy.
+//
+// Synced tables: tests, questions, options, results, result_details. Derived
+// tables (full-text and similarity index) are rebuilt by the caller after apply.
+// Both functions use their own sqlite3 connection: the database must not be
+// open through DBManager in the same process at the same time.
+//
+// File (.qts): "QTMSYNC1", then QDataStream (Qt 6.0): quint32 version,
+// QDateTime created, QStringList tables, QList<QStringList> columns per table,
+// quint32 changeset size, QByteArray qCompress(changeset).
+//
+// Results and their details get ids from a per-database range (see
+// DBManager::siteId), so results of different labs never collide on merge.
+class ChangesetSync
+{
+public:
+    enum class ConflictPolicy {
+        Skip,      // keep the local row, drop the incoming change
+        Overwrite, // incoming row replaces the local one
+        Abort      // first conflict rolls the whole apply back
+    };
+    struct ApplyStats {
+        int changes = 0;   // changes contained in the file
+        int conflicts = 0; // conflicting changes (resolved by the policy)
+        bool questionsChanged = false; // derived indexes need a rebuild
+    };
+
+    static QStringList syncedTables();
+    static QString defaultBasePath(const QString &dbPath) { return dbPath + ".syncbase"; }
+
+    static bool exportChanges(const QString &dbPath, const QString &basePath, const QString &outFile,
+                              int *changeCount = nullptr, QString *err = nullptr);
+    static bool applyChanges(const QString &dbPath, const QString &inFile, ConflictPolicy policy,
+                             ApplyStats *stats = nullptr, QString *err = nullptr);
+};
+
+#endif // CHANGESETSYNC_H
@@ -0,0 +1,35 @@
+#include "dbchangebus.h"
+#include <QDebug>
+
+DbChangeBus &DbChangeBus::instance()
+{
+    static DbChangeBus inst;
+    return inst;
+}
+
+DbChangeBus::DbChangeBus()
+{
+    connect(&mPollTimer, &QTimer::timeout, this, &DbChangeBus::poll);
+}
+
+void DbChangeBus::publish(const QVector<DBManager::Change> &changes, bool external)
+{
+    if (changes.isEmpty()) return;
+    emit changed(changes, external);
+}
+
+void DbChangeBus::startWatching(int intervalMs)
+{
+    mPollTimer.start(intervalMs);
+}
+
+void DbChangeBus::poll()
+{
+    QVector<DBManager::Change> changes;
+    QString err;
+    if (!DBManager::instance().pollChanges(changes, &err)) {
+        qDebug() << "Change polling failed:" << err;
+        return;
+    }
+    publish(changes, true);
+}
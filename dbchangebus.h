@@ -0,0 +1,38 @@
+#ifndef DBCHANGEBUS_H
+#define DBCHANGEBUS_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+#include "dbmanager.h"
+
+// Publishes row-level changes of the database opened by DBManager.
+// Own writes arrive right after their transaction commits (external = false).
+// With startWatching() the bus also polls PRAGMA data_version and reports changes
+// committed by other processes or connections (external = true), read from change_log.
+// Receivers update only the affected rows; a Reset means "reload that table" ("*" = all).
+class DbChangeBus : public QObject
+{
+    Q_OBJECT
+public:
+    static const int DefaultPollIntervalMs = 1000;
+
+    static DbChangeBus &instance();
+
+    void publish(const QVector<DBManager::Change> &changes, bool external);
+    void startWatching(int intervalMs = DefaultPollIntervalMs);
+    void stopWatching() { mPollTimer.stop(); }
+
+signals:
+    void changed(const QVector<DBManager::Change> &changes, bool external);
+
+private slots:
+    void poll();
+
+private:
+    DbChangeBus();
+
+    QTimer mPollTimer;
+};
+
+#endif // DBCHANGEBUS_H
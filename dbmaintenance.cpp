@@ -0,0 +1,103 @@
+#include "dbmaintenance.h"
+#include "dbmanager.h"
+#include <QDebug>
+
+DbMaintenance::DbMaintenance(QObject *parent)
+    : QObject(parent)
+{
+    mSliceTimer.setInterval(SliceIntervalMs);
+    connect(&mSliceTimer, &QTimer::timeout, this, &DbMaintenance::runSlice);
+    connect(&mRunTimer, &QTimer::timeout, this, &DbMaintenance::beginRun);
+    mSinceActivity.start();
+}
+
+void DbMaintenance::start(int intervalMinutes)
+{
+    mRunTimer.start(intervalMinutes * 60 * 1000);
+    beginRun();
+}
+
+void DbMaintenance::notifyActivity()
+{
+    mSinceActivity.restart();
+}
+
+void DbMaintenance::beginRun()
+{
+    if (mStep != Step::Idle) return; // previous run still in progress
+    mStep = Step::Optimize;
+    mSpentMs = 0;
+    mPagesFreed = 0;
+    mTablesChecked = 0;
+    mTablesToCheck.clear();
+    mSliceTimer.start();
+}
+
+void DbMaintenance::runSlice()
+{
+    if (!DBManager::instance().isOpen()) return;
+    if (mSinceActivity.elapsed() < IdleDelayMs) return; // not idle, try on the next tick
+
+    DBManager &db = DBManager::instance();
+    QElapsedTimer t;
+    t.start();
+    QString err;
+
+    switch (mStep) {
+    case Step::Idle:
+        mSliceTimer.stop();
+        return;
+    case Step::Optimize:
+        if (!db.optimize(&err)) qDebug() << "Maintenance: PRAGMA optimize failed:" << err;
+        mStep = Step::Vacuum;
+        break;
+    case Step::Vacuum: {
+        if (!db.isIncrementalVacuum()) {
+            // the conversion is one unbounded VACUUM, never run from here
+            if (!mVacuumHintShown) qInfo() << "Maintenance: free pages are not reclaimed, run QtTestMaker --vacuum once";
+            mVacuumHintShown = true;
+            mStep = Step::Integrity;
+            mTablesToCheck = db.tableNames();
+            break;
+        }
+        int freed = 0, remaining = 0;
+        if (!db.incrementalVacuum(VacuumPagesPerSlice, &freed, &remaining, &err)) {
+            if (!err.isEmpty()) qDebug() << "Maintenance: incremental vacuum failed:" << err;
+            remaining = 0;
+        }
+        mPagesFreed += freed;
+        if (remaining == 0 || freed == 0) {
+            mStep = Step::Integrity;
+            mTablesToCheck = db.tableNames();
+        }
+        break;
+    }
+    case Step::Integrity:
+        if (!mTablesToCheck.isEmpty()) {
+            const QString table = mTablesToCheck.takeFirst();
+            QStringList problems;
+            if (!db.quickCheckTable(table, &problems, &err)) {
+                qDebug() << "Maintenance: quick_check of" << table << "failed:" << err;
+            } else if (!problems.isEmpty()) {
+                qWarning() << "Maintenance: integrity problems in" << table << problems;
+                emit integrityProblem(table, problems);
+            }
+            ++mTablesChecked;
+        }
+        if (mTablesToCheck.isEmpty()) {
+            mSpentMs += t.elapsed();
+            finishRun();
+            return;
+        }
+        break;
+    }
+    mSpentMs += t.elapsed();
+}
+
+void DbMaintenance::finishRun()
+{
+    mSliceTimer.stop();
+    mStep = Step::Idle;
+    qInfo() << "DB maintenance finished:" << mSpentMs << "ms spent," << mPagesFreed << "pages freed,"
+            << mTablesChecked << "tables checked";
+}
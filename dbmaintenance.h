@@ -0,0 +1,57 @@
+#ifndef DBMAINTENANCE_H
+#define DBMAINTENANCE_H
+
+#include <QObject>
+#include <QTimer>
+#include <QStringList>
+#include <QElapsedTimer>
+
+// Idle-time maintenance of the database opened by DBManager.
+// A maintenance run is split into short slices (one slice per timer tick):
+//   1. PRAGMA optimize
+//   2. incremental_vacuum of at most VacuumPagesPerSlice pages per slice until
+//      the free list is empty (databases created before auto_vacuum=INCREMENTAL
+//      need the one-time full VACUUM of QtTestMaker --vacuum first)
+//   3. PRAGMA quick_check, one table per slice
+// Slices only run when notifyActivity() was not called for IdleDelayMs.
+// Time spent and pages freed are logged when the run finishes.
+class DbMaintenance : public QObject
+{
+    Q_OBJECT
+public:
+    static const int IdleDelayMs = 30 * 1000;
+    static const int SliceIntervalMs = 2000;
+    static const int VacuumPagesPerSlice = 256;
+
+    explicit DbMaintenance(QObject *parent = nullptr);
+    // start a run now and then every intervalMinutes
+    void start(int intervalMinutes = 6 * 60);
+
+public slots:
+    // user or server activity: postpone the next slice
+    void notifyActivity();
+
+signals:
+    void integrityProblem(const QString &table, const QStringList &problems);
+
+private slots:
+    void runSlice();
+    void beginRun();
+
+private:
+    enum class Step { Idle, Optimize, Vacuum, Integrity };
+
+    void finishRun();
+
+    QTimer mSliceTimer;
+    QTimer mRunTimer;
+    QElapsedTimer mSinceActivity;
+    Step mStep = Step::Idle;
+    QStringList mTablesToCheck;
+    qint64 mSpentMs = 0;
+    int mPagesFreed = 0;
+    int mTablesChecked = 0;
+    bool mVacuumHintShown = false;
+};
+
+#endif // DBMAINTENANCE_H
@@ -1,10 +1,25 @@
 #include "dbmanager.h"
+#include "similarityindex.h"
+#include "dbchangebus.h"
+#include "adaptiveengine.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QVariant>
 #include <QDateTime>
 #include <QUuid>
 #include <QDebug>
+#include <QHash>
+#include <QRegularExpression>
+#include <QSet>
+#include <QFileInfo>
+#include <QDir>
+#include <QRandomGenerator>
+#include <QSysInfo>
+#include <algorithm>
+#include <functional>
+
+// change_log rows kept by optimize(); watchers further behind get a Reset
+static const int ChangeLogKeep = 10000;
 
 DBManager &DBManager::instance()
 {
@@ -48,6 +63,73 @@ static bool execOrFail(QSqlQuery &qq, QString *err)
     return true;
 }
 
+DbTransaction::DbTransaction(QString *err)
+    : mDbm(DBManager::instance()), mLevel(mDbm.mTxDepth), mChangeMark(mDbm.mPendingChanges.size())
+{
+    if (mLevel == 0) {
+        mActive = mDbm.mDb.transaction();
+        if (!mActive && err) *err = mDbm.mDb.lastError().text();
+    } else {
+        QSqlQuery q(mDbm.mDb);
+        q.prepare(QString("SAVEPOINT sp%1").arg(mLevel));
+        mActive = execOrFail(q, err);
+    }
+    if (mActive) ++mDbm.mTxDepth;
+}
+
+DbTransaction::~DbTransaction()
+{
+    if (mActive) rollback();
+}
+
+bool DbTransaction::commit(QString *err)
+{
+    if (!mActive) {
+        if (err) *err = "Transaction is not active.";
+        return false;
+    }
+    // scopes must end in reverse order of creation
+    Q_ASSERT(mDbm.mTxDepth == mLevel + 1);
+    bool ok;
+    if (mLevel == 0) {
+        ok = mDbm.mDb.commit();
+        if (!ok && err) *err = mDbm.mDb.lastError().text();
+    } else {
+        QSqlQuery q(mDbm.mDb);
+        q.prepare(QString("RELEASE sp%1").arg(mLevel));
+        ok = execOrFail(q, err);
+    }
+    if (!ok) {
+        rollback();
+        return false;
+    }
+    mActive = false;
+    --mDbm.mTxDepth;
+    if (mLevel == 0 && !mDbm.mPendingChanges.isEmpty()) {
+        const QVector<DBManager::Change> changes = std::move(mDbm.mPendingChanges);
+        mDbm.mPendingChanges.clear();
+        DbChangeBus::instance().publish(changes, false);
+    }
+    return true;
+}
+
+void DbTransaction::rollback()
+{
+    if (!mActive) return;
+    Q_ASSERT(mDbm.mTxDepth == mLevel + 1);
+    if (mLevel == 0) {
+        mDbm.mDb.rollback();
+    } else {
+        // ROLLBACK TO keeps the savepoint open, RELEASE removes it
+        QSqlQuery q(mDbm.mDb);
+        q.exec(QString("ROLLBACK TO sp%1").arg(mLevel));
+        q.exec(QString("RELEASE sp%1").arg(mLevel));
+    }
+    mDbm.mPendingChanges.resize(mChangeMark);
+    mActive = false;
+    --mDbm.mTxDepth;
+}
+
 bool DBManager::openDatabase(const QString &path, QString *err)
 {
     if (mDb.isValid() && mDb.isOpen()) mDb.close();
@@ -58,9 +140,27 @@ bool DBManager::openDatabase(const QString &path, QString *err)
         if (err) *err = mDb.lastError().text();
         return false;
     }
+    // only takes effect for a new file (or with the next full VACUUM, QtTestMaker --vacuum)
+    QSqlQuery av(mDb);
+    av.exec("PRAGMA auto_vacuum=INCREMENTAL");
     return ensureSchema(err);
 }
 
+bool DBManager::setWriteAheadLog(bool on, QString *err)
+{
+    const QString mode = on ? "wal" : "delete";
+    QSqlQuery q(mDb);
+    q.prepare("PRAGMA journal_mode=" + mode);
+    if (!execOrFail(q, err)) return false;
+    // the pragma reports the mode in effect; switching fails while other connections use the file
+    const QString now = q.next() ? q.value(0).toString().toLower() : QString();
+    if (now != mode) {
+        if (err) *err = QString("Journal mode stays %1 (database in use?)").arg(now);
+        return false;
+    }
+    return true;
+}
+
 bool DBManager::ensureSchema(QString *err)
 {
     QSqlQuery q(mDb);
@@ -204,9 +304,428 @@ bool DBManager::ensureSchema(QString *err)
         );
     if (!execOrFail(q, err)) return false;
 
+    // near-duplicate detection: MinHash signature and LSH band keys per question
+    q.prepare(
+        "CREATE TABLE IF NOT EXISTS question_signatures ("
+        "question_id TEXT PRIMARY KEY,"
+        "signature BLOB"
+        ")"
+        );
+    if (!execOrFail(q, err)) return false;
+    q.prepare(
+        "CREATE TABLE IF NOT EXISTS question_lsh ("
+        "lsh_key INTEGER NOT NULL,"
+        "question_id TEXT NOT NULL,"
+        "PRIMARY KEY(lsh_key, question_id)"
+        ") WITHOUT ROWID"
+        );
+    if (!execOrFail(q, err)) return false;
+    q.prepare("CREATE INDEX IF NOT EXISTS idx_question_lsh_question ON question_lsh(question_id)");
+    if (!execOrFail(q, err)) return false;
+
+    // indexes (created after migrations, test_id may have been added just now)
+    q.prepare("CREATE INDEX IF NOT EXISTS idx_questions_test ON questions(test_id)");
+    if (!execOrFail(q, err)) return false;
+    q.prepare("CREATE INDEX IF NOT EXISTS idx_options_question ON options(question_id, ord)");
+    if (!execOrFail(q, err)) return false;
+    // covering index: per-test attempt counts and averages of the catalog never touch the table
+    q.prepare("DROP INDEX IF EXISTS idx_results_test");
+    if (!execOrFail(q, err)) return false;
+    q.prepare("CREATE INDEX IF NOT EXISTS idx_results_test_score ON results(test_id, score, total)");
+    if (!execOrFail(q, err)) return false;
+    // keyset order of the results browser, alone and under each of its filters
+    q.prepare("CREATE INDEX IF NOT EXISTS idx_results_time ON results(timestamp, id)");
+    if (!execOrFail(q, err)) return false;
+    q.prepare("CREATE INDEX IF NOT EXISTS idx_results_test_time ON results(test_id, timestamp, id)");
+    if (!execOrFail(q, err)) return false;
+    q.prepare("CREATE INDEX IF NOT EXISTS idx_results_email_time ON results(student_email COLLATE NOCASE, timestamp, id)");
+    if (!execOrFail(q, err)) return false;
+    q.prepare("CREATE INDEX IF NOT EXISTS idx_result_details_result ON result_details(result_id)");
+    if (!execOrFail(q, err)) return false;
+
+    if (!ensureSiteId(err)) return false;
+
+    // archives of old results (see archiveResults)
+    q.prepare(
+        "CREATE TABLE IF NOT EXISTS result_archives ("
+        "term TEXT PRIMARY KEY,"
+        "file_name TEXT NOT NULL,"
+        "result_count INTEGER,"
+        "min_timestamp TEXT,"
+        "max_timestamp TEXT"
+        ")"
+        );
+    if (!execOrFail(q, err)) return false;
+
+    // tags (closure table, see DBManager::Tag) and per-test blueprints
+    const QStringList tagSchema{
+        "CREATE TABLE IF NOT EXISTS tags ("
+        "id INTEGER PRIMARY KEY,"
+        "parent_id INTEGER NOT NULL DEFAULT 0," // 0 = top level
+        "name TEXT NOT NULL,"
+        "UNIQUE(parent_id, name)"
+        ")",
+        "CREATE TABLE IF NOT EXISTS tag_closure ("
+        "ancestor INTEGER NOT NULL,"
+        "descendant INTEGER NOT NULL,"
+        "depth INTEGER NOT NULL,"
+        "PRIMARY KEY(ancestor, descendant)"
+        ") WITHOUT ROWID",
+        "CREATE INDEX IF NOT EXISTS idx_tag_closure_descendant ON tag_closure(descendant, depth)",
+        "CREATE TABLE IF NOT EXISTS question_tags ("
+        "question_id TEXT NOT NULL,"
+        "tag_id INTEGER NOT NULL,"
+        "PRIMARY KEY(question_id, tag_id)"
+        ") WITHOUT ROWID",
+        "CREATE TABLE IF NOT EXISTS test_blueprints ("
+        "test_id TEXT NOT NULL,"
+        "ord INTEGER NOT NULL,"
+        "tag_id INTEGER NOT NULL,"
+        "count INTEGER NOT NULL,"
+        "PRIMARY KEY(test_id, ord)"
+        ")"
+    };
+    for (const QString &sql : tagSchema) {
+        q.prepare(sql);
+        if (!execOrFail(q, err)) return false;
+    }
+
+    // parametric questions: template definition per question (see QuestionTemplate)
+    q.prepare(
+        "CREATE TABLE IF NOT EXISTS question_templates ("
+        "question_id TEXT PRIMARY KEY,"
+        "definition TEXT NOT NULL"
+        ") WITHOUT ROWID"
+        );
+    if (!execOrFail(q, err)) return false;
+
+    // adaptive testing: settings per test, IRT parameters per question
+    q.prepare(
+        "CREATE TABLE IF NOT EXISTS adaptive_tests ("
+        "test_id TEXT PRIMARY KEY,"
+        "min_items INTEGER NOT NULL,"
+        "target_se REAL NOT NULL"
+        ")"
+        );
+    if (!execOrFail(q, err)) return false;
+    q.prepare(
+        "CREATE TABLE IF NOT EXISTS item_params ("
+        "question_id TEXT PRIMARY KEY,"
+        "a REAL NOT NULL,"
+        "b REAL NOT NULL,"
+        "responses INTEGER NOT NULL,"
+        "calibrated TEXT"
+        ") WITHOUT ROWID"
+        );
+    if (!execOrFail(q, err)) return false;
+
+    // practice mode: one row per student and question; the primary key serves the
+    // session load (one test of one student) and deletions of a whole test
+    q.prepare(
+        "CREATE TABLE IF NOT EXISTS srs_state ("
+        "test_id TEXT NOT NULL,"
+        "student_email TEXT NOT NULL,"
+        "question_id TEXT NOT NULL,"
+        "due INTEGER NOT NULL,"
+        "interval REAL NOT NULL,"
+        "ease REAL NOT NULL,"
+        "reps INTEGER NOT NULL,"
+        "lapses INTEGER NOT NULL,"
+        "last_review INTEGER NOT NULL,"
+        "PRIMARY KEY(test_id, student_email, question_id)"
+        ") WITHOUT ROWID"
+        );
+    if (!execOrFail(q, err)) return false;
+    q.prepare("CREATE INDEX IF NOT EXISTS idx_srs_state_question ON srs_state(question_id)");
+    if (!execOrFail(q, err)) return false;
+
+    // outbound mail; the sender polls (status, next_attempt), reports are queued once per result
+    q.prepare(
+        "CREATE TABLE IF NOT EXISTS mail_queue ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "result_id INTEGER,"
+        "recipient TEXT NOT NULL,"
+        "subject TEXT NOT NULL,"
+        "body TEXT NOT NULL,"
+        "status INTEGER NOT NULL DEFAULT 0,"
+        "attempts INTEGER NOT NULL DEFAULT 0,"
+        "next_attempt INTEGER NOT NULL,"
+        "last_error TEXT,"
+        "created INTEGER NOT NULL,"
+        "sent INTEGER"
+        ")"
+        );
+    if (!execOrFail(q, err)) return false;
+    q.prepare("CREATE INDEX IF NOT EXISTS idx_mail_queue_due ON mail_queue(status, next_attempt)");
+    if (!execOrFail(q, err)) return false;
+    q.prepare("CREATE UNIQUE INDEX IF NOT EXISTS idx_mail_queue_result ON mail_queue(result_id) WHERE result_id IS NOT NULL");
+    if (!execOrFail(q, err)) return false;
+
+    if (!ensureChangeLog(err)) return false;
+
+    // full-text index is optional: without FTS5 in the SQLite build the editor just cannot search
+    QString ftsErr;
+    mHasFts = ensureSearchIndex(&ftsErr);
+    if (!mHasFts) qDebug() << "Full-text search index not available:" << ftsErr;
+
+    return true;
+}
+
+// machine and file the site id belongs to; a copied file still carries its original's
+static QString siteOrigin(const QString &path)
+{
+    const QFileInfo fi(path);
+    return QSysInfo::machineHostName() + ':' + (fi.exists() ? fi.canonicalFilePath() : fi.absoluteFilePath());
+}
+
+bool DBManager::ensureSiteId(QString *err)
+{
+    QSqlQuery q(mDb);
+    q.prepare("CREATE TABLE IF NOT EXISTS sync_meta (key TEXT PRIMARY KEY, value TEXT)");
+    if (!execOrFail(q, err)) return false;
+    q.prepare("SELECT key, value FROM sync_meta WHERE key IN ('site_id', 'site_origin')");
+    if (!execOrFail(q, err)) return false;
+    QString id, origin;
+    while (q.next()) (q.value(0).toString() == "site_id" ? id : origin) = q.value(1).toString();
+    q.finish();
+    const QString here = siteOrigin(mDb.databaseName());
+    if (!id.isEmpty()) {
+        mSiteId = id.toLongLong();
+        mSiteCopied = !origin.isEmpty() && origin != here;
+        if (!origin.isEmpty()) return true;
+        // site id assigned before origins were recorded: this file is taken as the original
+        q.prepare("INSERT INTO sync_meta (key, value) VALUES ('site_origin', ?)");
+        q.addBindValue(here);
+        return execOrFail(q, err);
+    }
+
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+    if (!writeSiteId(err)) return false;
+    // results from before site ids (plain 1..n) move into this copy's range as lo + old id,
+    // so they do not collide with those of other copies upgraded the same way
+    const char *legacy[] = {
+        "UPDATE result_details SET result_id = result_id + ? WHERE result_id < 4294967296",
+        "UPDATE result_details SET id = id + ? WHERE id < 4294967296",
+        "UPDATE results SET id = id + ? WHERE id < 4294967296"
+    };
+    for (const char *sql : legacy) {
+        q.prepare(sql);
+        q.addBindValue(mSiteId << 32);
+        if (!execOrFail(q, err)) return false;
+    }
+    if (!tx.commit(err)) return false;
+    qDebug() << "Database site id" << mSiteId << "assigned";
+    return true;
+}
+
+// new random site id for this file; the reserved id ranges of the old one no longer apply
+bool DBManager::writeSiteId(QString *err)
+{
+    // 21 bits: ids stay below 2^53, collisions between a few dozen copies are unlikely
+    const qint64 siteId = 1 + QRandomGenerator::global()->bounded((1 << 21) - 1);
+    QSqlQuery q(mDb);
+    q.prepare("DELETE FROM sync_meta WHERE substr(key, 1, 8) = 'next_id:'");
+    if (!execOrFail(q, err)) return false;
+    q.prepare("INSERT OR REPLACE INTO sync_meta (key, value) VALUES ('site_id', ?), ('site_origin', ?)");
+    q.addBindValue(QString::number(siteId));
+    q.addBindValue(siteOrigin(mDb.databaseName()));
+    if (!execOrFail(q, err)) return false;
+    mSiteId = siteId;
+    mSiteCopied = false;
+    return true;
+}
+
+bool DBManager::assignNewSiteId(QString *err)
+{
+    const qint64 old = mSiteId;
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+    if (!writeSiteId(err) || !tx.commit(err)) {
+        mSiteId = old;
+        return false;
+    }
+    qDebug() << "Database site id" << mSiteId << "assigned, was" << old;
+    return true;
+}
+
+// count consecutive ids of table inside this copy's range (call inside the write transaction);
+// the high-water mark in sync_meta keeps ids of rows moved to an archive from being handed out again
+bool DBManager::reserveSiteRowIds(const QString &table, qint64 count, qint64 *first, QString *err)
+{
+    const qint64 lo = mSiteId << 32;
+    const QString key = "next_id:" + table;
+    QSqlQuery q(mDb);
+    q.prepare(QString("SELECT MAX(id) FROM %1 WHERE id >= ? AND id < ?").arg(table));
+    q.addBindValue(lo);
+    q.addBindValue(lo + (Q_INT64_C(1) << 32));
+    if (!execOrFail(q, err)) return false;
+    qint64 id = (q.next() && !q.value(0).isNull()) ? q.value(0).toLongLong() + 1 : lo + 1;
+    q.prepare("SELECT value FROM sync_meta WHERE key = ?");
+    q.addBindValue(key);
+    if (!execOrFail(q, err)) return false;
+    if (q.next()) id = qMax(id, q.value(0).toLongLong());
+    if (id + count > lo + (Q_INT64_C(1) << 32)) {
+        if (err) *err = "Id range of this database copy is exhausted for " + table;
+        return false;
+    }
+    q.prepare("INSERT OR REPLACE INTO sync_meta (key, value) VALUES (?, ?)");
+    q.addBindValue(key);
+    q.addBindValue(QString::number(id + count));
+    if (!execOrFail(q, err)) return false;
+    *first = id;
+    return true;
+}
+
+bool DBManager::ensureChangeLog(QString *err)
+{
+    QSqlQuery q(mDb);
+    q.prepare(
+        "CREATE TABLE IF NOT EXISTS change_log ("
+        "seq INTEGER PRIMARY KEY AUTOINCREMENT," // without gaps: a gap means pruned rows
+        "origin INTEGER NOT NULL,"               // connection that wrote the change (0 = tool)
+        "tbl TEXT NOT NULL,"
+        "row_key TEXT,"
+        "test_id TEXT,"
+        "op INTEGER NOT NULL"
+        ")"
+        );
+    if (!execOrFail(q, err)) return false;
+    q.prepare("SELECT MAX(seq) FROM change_log");
+    if (!execOrFail(q, err)) return false;
+    mLastChangeSeq = q.next() ? q.value(0).toLongLong() : 0;
+    q.prepare("PRAGMA data_version");
+    if (!execOrFail(q, err)) return false;
+    mDataVersion = q.next() ? q.value(0).toLongLong() : -1;
+    mChangeOrigin = 1 + QRandomGenerator::global()->bounded(0x7fffffff);
+    mPendingChanges.clear();
+    return true;
+}
+
+// call inside the write transaction, the change is published when it commits
+bool DBManager::noteChange(const QString &table, const QString &key, const QString &testId,
+                           Change::Op op, QString *err)
+{
+    Q_ASSERT(mTxDepth > 0);
+    // results are too frequent for the log, other processes do not cache them
+    if (table == "tests" || table == "questions" || table == "*") {
+        QSqlQuery q(mDb);
+        q.prepare("INSERT INTO change_log (origin, tbl, row_key, test_id, op) VALUES (?, ?, ?, ?, ?)");
+        q.addBindValue(mChangeOrigin);
+        q.addBindValue(table);
+        q.addBindValue(key);
+        q.addBindValue(testId);
+        q.addBindValue(static_cast<int>(op));
+        if (!execOrFail(q, err)) return false;
+    }
+    Change c;
+    c.table = table;
+    c.key = key;
+    c.testId = testId;
+    c.op = op;
+    mPendingChanges.append(c);
+    return true;
+}
+
+bool DBManager::pollChanges(QVector<Change> &outChanges, QString *err)
+{
+    outChanges.clear();
+    if (!isOpen()) return true;
+    QSqlQuery q(mDb);
+    // changes only when another connection (process, sync tool) has committed
+    q.prepare("PRAGMA data_version");
+    if (!execOrFail(q, err)) return false;
+    const qint64 version = q.next() ? q.value(0).toLongLong() : -1;
+    if (version == mDataVersion) return true;
+    mDataVersion = version;
+
+    q.prepare("SELECT seq, origin, tbl, row_key, test_id, op FROM change_log WHERE seq > ? ORDER BY seq");
+    q.addBindValue(mLastChangeSeq);
+    if (!execOrFail(q, err)) return false;
+    bool gap = false;
+    while (q.next()) {
+        const qint64 seq = q.value(0).toLongLong();
+        if (seq != mLastChangeSeq + 1) gap = true;
+        mLastChangeSeq = seq;
+        if (gap || q.value(1).toUInt() == mChangeOrigin) continue;
+        Change c;
+        c.table = q.value(2).toString();
+        c.key = q.value(3).toString();
+        c.testId = q.value(4).toString();
+        c.op = static_cast<Change::Op>(q.value(5).toInt());
+        outChanges.append(c);
+    }
+    if (gap) {
+        outChanges.clear();
+        Change c;
+        c.table = "*";
+        c.op = Change::Reset;
+        outChanges.append(c);
+    }
     return true;
 }
 
+// questions_fts rows share rowid with the questions table
+bool DBManager::ensureSearchIndex(QString *err)
+{
+    QSqlQuery q(mDb);
+    q.prepare("SELECT COUNT(1) FROM sqlite_master WHERE type = 'table' AND name = 'questions_fts'");
+    if (!execOrFail(q, err)) return false;
+    bool exists = q.next() && q.value(0).toInt() > 0;
+    if (exists) return true;
+
+    q.prepare(
+        "CREATE VIRTUAL TABLE questions_fts USING fts5("
+        "text, options, expected_text,"
+        "tokenize = 'unicode61 remove_diacritics 2'"
+        ")"
+        );
+    if (!execOrFail(q, err)) return false;
+    // question text weighs more than option / expected texts
+    q.prepare("INSERT INTO questions_fts(questions_fts, rank) VALUES ('rank', 'bm25(10.0, 3.0, 3.0)')");
+    if (!execOrFail(q, err)) return false;
+    qDebug() << "CREATE VIRTUAL TABLE questions_fts executed (migration)";
+
+    return rebuildSearchIndex(err);
+}
+
+bool DBManager::rebuildSearchIndex(QString *err)
+{
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+    QSqlQuery q(mDb);
+    q.prepare("DELETE FROM questions_fts");
+    if (!execOrFail(q, err)) return false;
+    q.prepare("INSERT INTO questions_fts (rowid, text, options, expected_text) "
+              "SELECT q.rowid, q.text, "
+              "(SELECT group_concat(o.text, ' ') FROM options o WHERE o.question_id = q.id), "
+              "q.expected_text FROM questions q");
+    if (!execOrFail(q, err)) return false;
+    return tx.commit(err);
+}
+
+// called inside the write transaction of addOrUpdateQuestion
+bool DBManager::updateSearchIndex(const Question &qobj, QString *err)
+{
+    if (!mHasFts) return true;
+    QStringList optionTexts;
+    for (const Answer &a : qobj.options) optionTexts.append(a.text);
+
+    QSqlQuery del(mDb);
+    del.prepare("DELETE FROM questions_fts WHERE rowid = (SELECT rowid FROM questions WHERE id = ?)");
+    del.addBindValue(qobj.id);
+    if (!execOrFail(del, err)) return false;
+
+    QSqlQuery ins(mDb);
+    ins.prepare("INSERT INTO questions_fts (rowid, text, options, expected_text) "
+                "SELECT rowid, ?, ?, ? FROM questions WHERE id = ?");
+    ins.addBindValue(qobj.text);
+    ins.addBindValue(optionTexts.join(' '));
+    ins.addBindValue(qobj.expectedText);
+    ins.addBindValue(qobj.id);
+    return execOrFail(ins, err);
+}
+
 bool DBManager::loadTests(QVector<Test> &outTests, QString *err)
 {
     outTests.clear();
@@ -225,17 +744,77 @@ bool DBManager::loadTests(QVector<Test> &outTests, QString *err)
     return true;
 }
 
-bool DBManager::addOrUpdateTest(const Test &t, QString *err)
+bool DBManager::loadTest(const QString &testId, Test *outTest, bool *found, QString *err)
 {
-    if (!mDb.transaction()) {
-        if (err) *err = mDb.lastError().text();
-        return false;
+    *found = false;
+    QSqlQuery q(mDb);
+    q.prepare("SELECT id, name, description, student_count FROM tests WHERE id = ?");
+    q.addBindValue(testId);
+    if (!execOrFail(q, err)) return false;
+    if (q.next()) {
+        outTest->id = q.value(0).toString();
+        outTest->name = q.value(1).toString();
+        outTest->description = q.value(2).toString();
+        outTest->studentCount = q.value(3).toInt();
+        *found = true;
+    }
+    return true;
+}
+
+bool DBManager::loadTestCatalog(const CatalogQuery &query, QVector<CatalogEntry> &outEntries, QString *err)
+{
+    outEntries.clear();
+    QString where = "rowid > ?";
+    if (!query.nameFilter.isEmpty()) where += " AND name LIKE ? ESCAPE '\\'";
+    if (!query.testId.isEmpty()) where += " AND id = ?";
+
+    // the page first, then question counts (idx_questions_test) and result aggregates
+    // (idx_results_test_score) only for the tests on the page
+    QSqlQuery q(mDb);
+    q.prepare(
+        "WITH page AS (SELECT rowid AS rid, id, name, description, student_count FROM tests "
+        "WHERE " + where + " ORDER BY rowid LIMIT ?) "
+        "SELECT p.rid, p.id, p.name, p.description, p.student_count, "
+        "(SELECT COUNT(*) FROM questions qq WHERE qq.test_id = p.id), "
+        "r.attempts, r.average "
+        "FROM page p LEFT JOIN ("
+        "SELECT test_id, COUNT(*) AS attempts, AVG(CASE WHEN total > 0 THEN score * 100.0 / total END) AS average "
+        "FROM results WHERE test_id IN (SELECT id FROM page) GROUP BY test_id"
+        ") r ON r.test_id = p.id "
+        "ORDER BY p.rid");
+    q.addBindValue(query.afterRowId);
+    if (!query.nameFilter.isEmpty()) {
+        QString pattern = query.nameFilter;
+        pattern.replace("\\", "\\\\").replace("%", "\\%").replace("_", "\\_");
+        q.addBindValue("%" + pattern + "%");
     }
+    if (!query.testId.isEmpty()) q.addBindValue(query.testId);
+    q.addBindValue(query.limit);
+    if (!execOrFail(q, err)) return false;
+    while (q.next()) {
+        CatalogEntry e;
+        e.rowId = q.value(0).toLongLong();
+        e.test.id = q.value(1).toString();
+        e.test.name = q.value(2).toString();
+        e.test.description = q.value(3).toString();
+        e.test.studentCount = q.value(4).toInt();
+        e.stats.questionCount = q.value(5).toInt();
+        e.stats.attemptCount = q.value(6).toLongLong();
+        if (!q.value(7).isNull()) e.stats.averagePercent = q.value(7).toDouble();
+        outEntries.append(e);
+    }
+    return true;
+}
+
+bool DBManager::addOrUpdateTest(const Test &t, QString *err)
+{
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
 
     QSqlQuery q(mDb);
     q.prepare("SELECT COUNT(1) FROM tests WHERE id = ?");
     q.addBindValue(t.id);
-    if (!execOrFail(q, err)) { mDb.rollback(); return false; }
+    if (!execOrFail(q, err)) return false;
     bool exists = false;
     if (q.next()) exists = (q.value(0).toInt() > 0);
 
@@ -246,7 +825,8 @@ bool DBManager::addOrUpdateTest(const Test &t, QString *err)
         ins.addBindValue(t.name);
         ins.addBindValue(t.description);
         ins.addBindValue(t.studentCount);
-        if (!execOrFail(ins, err)) { mDb.rollback(); return false; }
+        if (!execOrFail(ins, err)) return false;
+        if (!noteChange("tests", t.id, t.id, Change::Insert, err)) return false;
     } else {
         QSqlQuery upd(mDb);
         upd.prepare("UPDATE tests SET name=?, description=?, student_count=? WHERE id=?");
@@ -254,33 +834,32 @@ bool DBManager::addOrUpdateTest(const Test &t, QString *err)
         upd.addBindValue(t.description);
         upd.addBindValue(t.studentCount);
         upd.addBindValue(t.id);
-        if (!execOrFail(upd, err)) { mDb.rollback(); return false; }
+        if (!execOrFail(upd, err)) return false;
+        if (!noteChange("tests", t.id, t.id, Change::Update, err)) return false;
     }
 
-    if (!mDb.commit()) {
-        if (err) *err = mDb.lastError().text();
-        mDb.rollback();
-        return false;
-    }
-    return true;
+    return tx.commit(err);
 }
 
 bool DBManager::removeTest(const QString &testId, QString *err)
 {
-    if (!mDb.transaction()) {
-        if (err) *err = mDb.lastError().text();
-        return false;
-    }
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
     QSqlQuery q(mDb);
     q.prepare("DELETE FROM tests WHERE id = ?");
     q.addBindValue(testId);
-    if (!execOrFail(q, err)) { mDb.rollback(); return false; }
-    if (!mDb.commit()) {
-        if (err) *err = q.lastError().text();
-        mDb.rollback();
-        return false;
-    }
-    return true;
+    if (!execOrFail(q, err)) return false;
+    q.prepare("DELETE FROM test_blueprints WHERE test_id = ?");
+    q.addBindValue(testId);
+    if (!execOrFail(q, err)) return false;
+    q.prepare("DELETE FROM adaptive_tests WHERE test_id = ?");
+    q.addBindValue(testId);
+    if (!execOrFail(q, err)) return false;
+    q.prepare("DELETE FROM srs_state WHERE test_id = ?");
+    q.addBindValue(testId);
+    if (!execOrFail(q, err)) return false;
+    if (!noteChange("tests", testId, testId, Change::Delete, err)) return false;
+    return tx.commit(err);
 }
 
 bool DBManager::loadAllQuestions(QVector<Question> &outQuestions, QString *err)
@@ -342,17 +921,90 @@ bool DBManager::loadQuestionsForTest(const QString &testId, QVector<Question> &o
     return true;
 }
 
-bool DBManager::addOrUpdateQuestion(const Question &qobj, QString *err)
+bool DBManager::loadQuestionsPage(const QString &testId, qint64 afterRowId, int limit,
+                                  QVector<Question> &outQuestions, qint64 *lastRowId, QString *err)
 {
-    if (!mDb.transaction()) {
-        if (err) *err = mDb.lastError().text();
-        return false;
+    outQuestions.clear();
+    QSqlQuery q(mDb);
+    q.prepare("SELECT rowid, id, test_id, text, type, expected_text FROM questions "
+              "WHERE test_id = ? AND rowid > ? ORDER BY rowid LIMIT ?");
+    q.addBindValue(testId);
+    q.addBindValue(afterRowId);
+    q.addBindValue(limit);
+    if (!execOrFail(q, err)) return false;
+    QHash<QString, int> posById;
+    qint64 last = afterRowId;
+    while (q.next()) {
+        last = q.value(0).toLongLong();
+        Question qq;
+        qq.id = q.value(1).toString();
+        qq.testId = q.value(2).toString();
+        qq.text = q.value(3).toString();
+        qq.type = static_cast<QuestionType>(q.value(4).toInt());
+        qq.expectedText = q.value(5).toString();
+        posById.insert(qq.id, outQuestions.size());
+        outQuestions.append(qq);
+    }
+    if (lastRowId) *lastRowId = last;
+    if (outQuestions.isEmpty()) return true;
+
+    // options of the whole page in one query (instead of one query per question)
+    QSqlQuery q2(mDb);
+    q2.prepare("SELECT question_id, text, correct FROM options WHERE question_id IN ("
+               "SELECT id FROM questions WHERE test_id = ? AND rowid > ? AND rowid <= ?) "
+               "ORDER BY question_id, ord");
+    q2.addBindValue(testId);
+    q2.addBindValue(afterRowId);
+    q2.addBindValue(last);
+    if (!execOrFail(q2, err)) return false;
+    while (q2.next()) {
+        auto it = posById.constFind(q2.value(0).toString());
+        if (it == posById.constEnd()) continue;
+        Answer a;
+        a.text = q2.value(1).toString();
+        a.correct = q2.value(2).toInt() != 0;
+        outQuestions[it.value()].options.append(a);
+    }
+    return true;
+}
+
+bool DBManager::loadQuestion(const QString &questionId, Question *outQuestion, bool *found, QString *err)
+{
+    *found = false;
+    QSqlQuery q(mDb);
+    q.prepare("SELECT id, test_id, text, type, expected_text FROM questions WHERE id = ?");
+    q.addBindValue(questionId);
+    if (!execOrFail(q, err)) return false;
+    if (!q.next()) return true;
+    Question qq;
+    qq.id = q.value(0).toString();
+    qq.testId = q.value(1).toString();
+    qq.text = q.value(2).toString();
+    qq.type = static_cast<QuestionType>(q.value(3).toInt());
+    qq.expectedText = q.value(4).toString();
+    q.prepare("SELECT text, correct FROM options WHERE question_id = ? ORDER BY ord");
+    q.addBindValue(questionId);
+    if (!execOrFail(q, err)) return false;
+    while (q.next()) {
+        Answer a;
+        a.text = q.value(0).toString();
+        a.correct = q.value(1).toInt() != 0;
+        qq.options.append(a);
     }
+    *outQuestion = qq;
+    *found = true;
+    return true;
+}
+
+bool DBManager::addOrUpdateQuestion(const Question &qobj, QString *err)
+{
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
 
     QSqlQuery q(mDb);
     q.prepare("SELECT COUNT(1) FROM questions WHERE id = ?");
     q.addBindValue(qobj.id);
-    if (!execOrFail(q, err)) { mDb.rollback(); return false; }
+    if (!execOrFail(q, err)) return false;
     bool exists = false;
     if (q.next()) exists = (q.value(0).toInt() > 0);
 
@@ -364,7 +1016,7 @@ bool DBManager::addOrUpdateQuestion(const Question &qobj, QString *err)
         ins.addBindValue(qobj.text);
         ins.addBindValue(static_cast<int>(qobj.type));
         ins.addBindValue(qobj.expectedText);
-        if (!execOrFail(ins, err)) { mDb.rollback(); return false; }
+        if (!execOrFail(ins, err)) return false;
     } else {
         QSqlQuery upd(mDb);
         upd.prepare("UPDATE questions SET test_id=?, text=?, type=?, expected_text=? WHERE id=?");
@@ -373,12 +1025,12 @@ bool DBManager::addOrUpdateQuestion(const Question &qobj, QString *err)
         upd.addBindValue(static_cast<int>(qobj.type));
         upd.addBindValue(qobj.expectedText);
         upd.addBindValue(qobj.id);
-        if (!execOrFail(upd, err)) { mDb.rollback(); return false; }
+        if (!execOrFail(upd, err)) return false;
         // delete existing options; we will reinsert
         QSqlQuery del(mDb);
         del.prepare("DELETE FROM options WHERE question_id = ?");
         del.addBindValue(qobj.id);
-        if (!execOrFail(del, err)) { mDb.rollback(); return false; }
+        if (!execOrFail(del, err)) return false;
     }
 
     // insert options
@@ -390,79 +1042,1493 @@ bool DBManager::addOrUpdateQuestion(const Question &qobj, QString *err)
         iopt.addBindValue(a.text);
         iopt.addBindValue(a.correct ? 1 : 0);
         iopt.addBindValue(i);
-        if (!execOrFail(iopt, err)) { mDb.rollback(); return false; }
+        if (!execOrFail(iopt, err)) return false;
     }
 
-    if (!mDb.commit()) {
-        if (err) *err = mDb.lastError().text();
-        mDb.rollback();
-        return false;
-    }
-    return true;
+    if (!updateSearchIndex(qobj, err)) return false;
+    if (!updateSimilarityIndex(qobj, err)) return false;
+    if (!noteChange("questions", qobj.id, qobj.testId, exists ? Change::Update : Change::Insert, err)) return false;
+
+    return tx.commit(err);
 }
 
-bool DBManager::removeQuestion(const QString &questionId, QString *err)
+bool DBManager::importQuestions(const std::function<bool(QVector<Question> &, QString *)> &nextBatch,
+                                int *imported, QString *err)
 {
-    if (!mDb.transaction()) {
-        if (err) *err = mDb.lastError().text();
-        return false;
+    if (imported) *imported = 0;
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+
+    // statements are prepared once for the whole import
+    QSqlQuery insQuestion(mDb);
+    insQuestion.prepare("INSERT INTO questions (id, test_id, text, type, expected_text) VALUES (?, ?, ?, ?, ?)");
+    QSqlQuery insOption(mDb);
+    insOption.prepare("INSERT INTO options (question_id, text, correct, ord) VALUES (?, ?, ?, ?)");
+    QSqlQuery insFts(mDb);
+    if (mHasFts) {
+        // runs right after the question insert, so last_insert_rowid() is the question rowid
+        insFts.prepare("INSERT INTO questions_fts (rowid, text, options, expected_text) VALUES (last_insert_rowid(), ?, ?, ?)");
+    }
+    QSqlQuery insSig(mDb);
+    insSig.prepare("INSERT OR REPLACE INTO question_signatures (question_id, signature) VALUES (?, ?)");
+    QSqlQuery insLsh(mDb);
+    insLsh.prepare("INSERT OR IGNORE INTO question_lsh (lsh_key, question_id) VALUES (?, ?)");
+
+    int count = 0;
+    QSet<QString> testIds;
+    QVector<Question> batch;
+    for (;;) {
+        batch.clear();
+        if (!nextBatch(batch, err)) return false;
+        if (batch.isEmpty()) break;
+
+        for (const Question &qobj : std::as_const(batch)) {
+            insQuestion.addBindValue(qobj.id);
+            insQuestion.addBindValue(qobj.testId);
+            insQuestion.addBindValue(qobj.text);
+            insQuestion.addBindValue(static_cast<int>(qobj.type));
+            insQuestion.addBindValue(qobj.expectedText);
+            if (!execOrFail(insQuestion, err)) return false;
+
+            QStringList optionTexts;
+            if (mHasFts) {
+                for (const Answer &a : qobj.options) optionTexts.append(a.text);
+                insFts.addBindValue(qobj.text);
+                insFts.addBindValue(optionTexts.join(' '));
+                insFts.addBindValue(qobj.expectedText);
+                if (!execOrFail(insFts, err)) return false;
+            }
+
+            for (int i = 0; i < qobj.options.size(); ++i) {
+                const Answer &a = qobj.options[i];
+                insOption.addBindValue(qobj.id);
+                insOption.addBindValue(a.text);
+                insOption.addBindValue(a.correct ? 1 : 0);
+                insOption.addBindValue(i);
+                if (!execOrFail(insOption, err)) return false;
+            }
+
+            const QVector<quint32> sig = SimilarityIndex::signature(qobj);
+            insSig.addBindValue(qobj.id);
+            insSig.addBindValue(SimilarityIndex::toBlob(sig));
+            if (!execOrFail(insSig, err)) return false;
+            const QVector<qint64> keys = SimilarityIndex::bandKeys(sig);
+            for (qint64 key : keys) {
+                insLsh.addBindValue(key);
+                insLsh.addBindValue(qobj.id);
+                if (!execOrFail(insLsh, err)) return false;
+            }
+            testIds.insert(qobj.testId);
+            ++count;
+        }
+    }
+
+    // one event per test instead of one per imported question
+    for (const QString &testId : std::as_const(testIds)) {
+        if (!noteChange("questions", QString(), testId, Change::Reset, err)) return false;
+    }
+    if (!tx.commit(err)) return false;
+    if (imported) *imported = count;
+    qDebug() << "Imported" << count << "questions";
+    return true;
+}
+
+bool DBManager::loadQuestionsByIds(const QStringList &ids, QVector<Question> &outQuestions, QString *err)
+{
+    outQuestions.clear();
+    QHash<QString, Question> byId;
+    // chunks stay below SQLite's limit of bound parameters
+    const int Chunk = 500;
+    for (int from = 0; from < ids.size(); from += Chunk) {
+        const QStringList part = ids.mid(from, Chunk);
+        QStringList marks;
+        for (int i = 0; i < part.size(); ++i) marks << "?";
+        QSqlQuery q(mDb);
+        q.prepare("SELECT id, test_id, text, type, expected_text FROM questions WHERE id IN (" + marks.join(',') + ")");
+        for (const QString &id : part) q.addBindValue(id);
+        if (!execOrFail(q, err)) return false;
+        while (q.next()) {
+            Question qq;
+            qq.id = q.value(0).toString();
+            qq.testId = q.value(1).toString();
+            qq.text = q.value(2).toString();
+            qq.type = static_cast<QuestionType>(q.value(3).toInt());
+            qq.expectedText = q.value(4).toString();
+            byId.insert(qq.id, qq);
+        }
+        q.prepare("SELECT question_id, text, correct FROM options WHERE question_id IN (" + marks.join(',') + ") "
+                  "ORDER BY question_id, ord");
+        for (const QString &id : part) q.addBindValue(id);
+        if (!execOrFail(q, err)) return false;
+        while (q.next()) {
+            auto it = byId.find(q.value(0).toString());
+            if (it == byId.end()) continue;
+            Answer a;
+            a.text = q.value(1).toString();
+            a.correct = q.value(2).toInt() != 0;
+            it->options.append(a);
+        }
+    }
+    outQuestions.reserve(ids.size());
+    for (const QString &id : ids) {
+        auto it = byId.constFind(id);
+        if (it != byId.constEnd()) outQuestions.append(it.value());
     }
+    return true;
+}
+
+bool DBManager::loadQuestionTemplate(const QString &questionId, QString *definition, QString *err)
+{
+    definition->clear();
     QSqlQuery q(mDb);
-    q.prepare("DELETE FROM questions WHERE id = ?");
+    q.prepare("SELECT definition FROM question_templates WHERE question_id = ?");
     q.addBindValue(questionId);
-    if (!execOrFail(q, err)) { mDb.rollback(); return false; }
-    if (!mDb.commit()) {
-        if (err) *err = q.lastError().text();
-        mDb.rollback();
+    if (!execOrFail(q, err)) return false;
+    if (q.next()) *definition = q.value(0).toString();
+    return true;
+}
+
+bool DBManager::setQuestionTemplate(const QString &questionId, const QString &definition, QString *err)
+{
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+    QSqlQuery q(mDb);
+    q.prepare("SELECT test_id FROM questions WHERE id = ?");
+    q.addBindValue(questionId);
+    if (!execOrFail(q, err)) return false;
+    const QString testId = q.next() ? q.value(0).toString() : QString();
+    if (definition.trimmed().isEmpty()) {
+        q.prepare("DELETE FROM question_templates WHERE question_id = ?");
+        q.addBindValue(questionId);
+    } else {
+        q.prepare("INSERT OR REPLACE INTO question_templates (question_id, definition) VALUES (?, ?)");
+        q.addBindValue(questionId);
+        q.addBindValue(definition);
+    }
+    if (!execOrFail(q, err)) return false;
+    // exam hosts compile the templates with the bank
+    if (!noteChange("questions", questionId, testId, Change::Update, err)) return false;
+    return tx.commit(err);
+}
+
+bool DBManager::loadQuestionTemplates(const QStringList &ids, QHash<QString, QString> *definitions, QString *err)
+{
+    definitions->clear();
+    const int Chunk = 500;
+    for (int from = 0; from < ids.size(); from += Chunk) {
+        const QStringList part = ids.mid(from, Chunk);
+        QStringList marks;
+        for (int i = 0; i < part.size(); ++i) marks << "?";
+        QSqlQuery q(mDb);
+        q.prepare("SELECT question_id, definition FROM question_templates WHERE question_id IN (" + marks.join(',') + ")");
+        for (const QString &id : part) q.addBindValue(id);
+        if (!execOrFail(q, err)) return false;
+        while (q.next()) definitions->insert(q.value(0).toString(), q.value(1).toString());
+    }
+    return true;
+}
+
+static QStringList splitTagPath(const QString &path)
+{
+    QStringList names;
+    for (const QString &part : path.split('/')) {
+        const QString name = part.trimmed();
+        if (!name.isEmpty()) names.append(name);
+    }
+    return names;
+}
+
+bool DBManager::loadTags(QVector<Tag> &outTags, QString *err)
+{
+    outTags.clear();
+    QSqlQuery q(mDb);
+    q.prepare("SELECT id, parent_id, name FROM tags");
+    if (!execOrFail(q, err)) return false;
+    QHash<qint64, int> posById;
+    while (q.next()) {
+        Tag t;
+        t.id = q.value(0).toLongLong();
+        t.parentId = q.value(1).toLongLong();
+        t.name = q.value(2).toString();
+        posById.insert(t.id, outTags.size());
+        outTags.append(t);
+    }
+    for (Tag &t : outTags) {
+        QStringList names{ t.name };
+        for (qint64 p = t.parentId; p != 0 && posById.contains(p); p = outTags[posById.value(p)].parentId)
+            names.prepend(outTags[posById.value(p)].name);
+        t.path = names.join('/');
+    }
+    std::sort(outTags.begin(), outTags.end(), [](const Tag &a, const Tag &b) { return a.path < b.path; });
+    return true;
+}
+
+bool DBManager::findTagPath(const QString &path, qint64 *tagId, QString *err)
+{
+    *tagId = 0;
+    const QStringList names = splitTagPath(path);
+    if (names.isEmpty()) return true;
+    QSqlQuery q(mDb);
+    q.prepare("SELECT id FROM tags WHERE parent_id = ? AND name = ?");
+    qint64 parent = 0;
+    for (const QString &name : names) {
+        q.addBindValue(parent);
+        q.addBindValue(name);
+        if (!execOrFail(q, err)) return false;
+        if (!q.next()) return true; // not found: *tagId stays 0
+        parent = q.value(0).toLongLong();
+    }
+    *tagId = parent;
+    return true;
+}
+
+bool DBManager::ensureTagPath(const QString &path, qint64 *tagId, QString *err)
+{
+    const QStringList names = splitTagPath(path);
+    if (names.isEmpty()) {
+        if (err) *err = "Empty tag: " + path;
         return false;
     }
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+    QSqlQuery find(mDb);
+    find.prepare("SELECT id FROM tags WHERE parent_id = ? AND name = ?");
+    QSqlQuery ins(mDb);
+    ins.prepare("INSERT INTO tags (parent_id, name) VALUES (?, ?)");
+    // the new tag is a descendant of all ancestors of its parent and of itself
+    QSqlQuery closure(mDb);
+    closure.prepare("INSERT INTO tag_closure (ancestor, descendant, depth) "
+                    "SELECT ancestor, ?, depth + 1 FROM tag_closure WHERE descendant = ? "
+                    "UNION ALL SELECT ?, ?, 0");
+    qint64 parent = 0;
+    for (const QString &name : names) {
+        find.addBindValue(parent);
+        find.addBindValue(name);
+        if (!execOrFail(find, err)) return false;
+        if (find.next()) {
+            parent = find.value(0).toLongLong();
+            continue;
+        }
+        ins.addBindValue(parent);
+        ins.addBindValue(name);
+        if (!execOrFail(ins, err)) return false;
+        const qint64 id = ins.lastInsertId().toLongLong();
+        closure.addBindValue(id);
+        closure.addBindValue(parent);
+        closure.addBindValue(id);
+        closure.addBindValue(id);
+        if (!execOrFail(closure, err)) return false;
+        parent = id;
+    }
+    if (!tx.commit(err)) return false;
+    *tagId = parent;
+    return true;
+}
+
+bool DBManager::tagPathOf(qint64 tagId, QString *path, QString *err)
+{
+    QSqlQuery q(mDb);
+    q.prepare("SELECT t.name FROM tag_closure c JOIN tags t ON t.id = c.ancestor "
+              "WHERE c.descendant = ? ORDER BY c.depth DESC");
+    q.addBindValue(tagId);
+    if (!execOrFail(q, err)) return false;
+    QStringList names;
+    while (q.next()) names.append(q.value(0).toString());
+    *path = names.join('/');
+    return true;
+}
+
+bool DBManager::questionTags(const QString &questionId, QStringList *outPaths, QString *err)
+{
+    outPaths->clear();
+    QSqlQuery q(mDb);
+    q.prepare("SELECT tag_id FROM question_tags WHERE question_id = ?");
+    q.addBindValue(questionId);
+    if (!execOrFail(q, err)) return false;
+    QVector<qint64> ids;
+    while (q.next()) ids.append(q.value(0).toLongLong());
+    for (qint64 id : std::as_const(ids)) {
+        QString path;
+        if (!tagPathOf(id, &path, err)) return false;
+        outPaths->append(path);
+    }
+    outPaths->sort();
+    return true;
+}
+
+bool DBManager::setQuestionTags(const QString &questionId, const QStringList &paths, QString *err)
+{
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+    QSqlQuery q(mDb);
+    q.prepare("SELECT test_id FROM questions WHERE id = ?");
+    q.addBindValue(questionId);
+    if (!execOrFail(q, err)) return false;
+    const QString testId = q.next() ? q.value(0).toString() : QString();
+    q.prepare("DELETE FROM question_tags WHERE question_id = ?");
+    q.addBindValue(questionId);
+    if (!execOrFail(q, err)) return false;
+    q.prepare("INSERT OR IGNORE INTO question_tags (question_id, tag_id) VALUES (?, ?)");
+    for (const QString &path : paths) {
+        if (splitTagPath(path).isEmpty()) continue;
+        qint64 tagId = 0;
+        if (!ensureTagPath(path, &tagId, err)) return false;
+        q.addBindValue(questionId);
+        q.addBindValue(tagId);
+        if (!execOrFail(q, err)) return false;
+    }
+    if (!noteChange("questions", questionId, testId, Change::Update, err)) return false;
+    return tx.commit(err);
+}
+
+bool DBManager::loadBlueprint(const QString &testId, QVector<BlueprintRule> &outRules, QString *err)
+{
+    outRules.clear();
+    QSqlQuery q(mDb);
+    q.prepare("SELECT tag_id, count FROM test_blueprints WHERE test_id = ? ORDER BY ord");
+    q.addBindValue(testId);
+    if (!execOrFail(q, err)) return false;
+    QVector<qint64> tagIds;
+    while (q.next()) {
+        tagIds.append(q.value(0).toLongLong());
+        BlueprintRule r;
+        r.count = q.value(1).toInt();
+        outRules.append(r);
+    }
+    for (int i = 0; i < outRules.size(); ++i) {
+        if (!tagPathOf(tagIds[i], &outRules[i].tagPath, err)) return false;
+    }
+    return true;
+}
+
+bool DBManager::saveBlueprint(const QString &testId, const QVector<BlueprintRule> &rules, QString *err)
+{
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+    QSqlQuery q(mDb);
+    q.prepare("DELETE FROM test_blueprints WHERE test_id = ?");
+    q.addBindValue(testId);
+    if (!execOrFail(q, err)) return false;
+    q.prepare("INSERT INTO test_blueprints (test_id, ord, tag_id, count) VALUES (?, ?, ?, ?)");
+    int ord = 0;
+    for (const BlueprintRule &r : rules) {
+        if (r.count <= 0 || splitTagPath(r.tagPath).isEmpty()) continue;
+        qint64 tagId = 0;
+        if (!ensureTagPath(r.tagPath, &tagId, err)) return false;
+        q.addBindValue(testId);
+        q.addBindValue(ord++);
+        q.addBindValue(tagId);
+        q.addBindValue(r.count);
+        if (!execOrFail(q, err)) return false;
+    }
+    // exam hosts cache the draw setup with the bank
+    if (!noteChange("tests", testId, testId, Change::Update, err)) return false;
+    return tx.commit(err);
+}
+
+// questions of a test under a tag (at any depth): idx_questions_test walk,
+// question_tags and tag_closure primary key lookups per question
+static const char *StratumSql =
+    "SELECT q.id FROM questions q WHERE q.test_id = ? AND EXISTS ("
+    "SELECT 1 FROM question_tags qt JOIN tag_closure c ON c.descendant = qt.tag_id "
+    "WHERE qt.question_id = q.id AND c.ancestor = ?)";
+
+bool DBManager::drawQuestionIds(const QString &testId, int count, QStringList *outIds, QString *err)
+{
+    outIds->clear();
+    if (count <= 0) return true;
+    QVector<BlueprintRule> rules;
+    if (!loadBlueprint(testId, rules, err)) return false;
+
+    QRandomGenerator *rng = QRandomGenerator::global();
+    QSet<QString> chosen;
+    // reservoir sampling (algorithm R) of k ids over a streamed query, skipping drawn ids
+    auto sample = [&](QSqlQuery &q, int k) {
+        QStringList reservoir;
+        qint64 seen = 0;
+        while (q.next()) {
+            const QString id = q.value(0).toString();
+            if (chosen.contains(id)) continue;
+            ++seen;
+            if (reservoir.size() < k) {
+                reservoir.append(id);
+            } else {
+                const qint64 j = rng->bounded(seen);
+                if (j < k) reservoir[int(j)] = id;
+            }
+        }
+        for (const QString &id : std::as_const(reservoir)) {
+            chosen.insert(id);
+            outIds->append(id);
+        }
+    };
+
+    QSqlQuery q(mDb);
+    q.setForwardOnly(true);
+    for (const BlueprintRule &r : std::as_const(rules)) {
+        const int k = qMin(r.count, count - int(outIds->size()));
+        if (k <= 0) break;
+        qint64 tagId = 0;
+        if (!findTagPath(r.tagPath, &tagId, err)) return false;
+        if (tagId == 0) continue;
+        q.prepare(StratumSql);
+        q.addBindValue(testId);
+        q.addBindValue(tagId);
+        if (!execOrFail(q, err)) return false;
+        sample(q, k);
+    }
+    if (outIds->size() < count) {
+        q.prepare("SELECT id FROM questions WHERE test_id = ?");
+        q.addBindValue(testId);
+        if (!execOrFail(q, err)) return false;
+        sample(q, count - int(outIds->size()));
+    }
+    // strata must not come in blocks
+    std::shuffle(outIds->begin(), outIds->end(), *rng);
+    return true;
+}
+
+bool DBManager::loadBlueprintStrata(const QString &testId, QVector<BlueprintStratum> &outStrata, QString *err)
+{
+    outStrata.clear();
+    QVector<BlueprintRule> rules;
+    if (!loadBlueprint(testId, rules, err)) return false;
+    QSqlQuery q(mDb);
+    q.setForwardOnly(true);
+    for (const BlueprintRule &r : std::as_const(rules)) {
+        qint64 tagId = 0;
+        if (!findTagPath(r.tagPath, &tagId, err)) return false;
+        BlueprintStratum s;
+        s.count = r.count;
+        if (tagId != 0) {
+            q.prepare(StratumSql);
+            q.addBindValue(testId);
+            q.addBindValue(tagId);
+            if (!execOrFail(q, err)) return false;
+            while (q.next()) s.questionIds.append(q.value(0).toString());
+        }
+        outStrata.append(s);
+    }
+    return true;
+}
+
+bool DBManager::loadAdaptiveSettings(const QString &testId, AdaptiveSettings *out, QString *err)
+{
+    *out = AdaptiveSettings();
+    QSqlQuery q(mDb);
+    q.prepare("SELECT min_items, target_se FROM adaptive_tests WHERE test_id = ?");
+    q.addBindValue(testId);
+    if (!execOrFail(q, err)) return false;
+    if (q.next()) {
+        out->enabled = true;
+        out->minItems = q.value(0).toInt();
+        out->targetSe = q.value(1).toDouble();
+    }
+    return true;
+}
+
+bool DBManager::saveAdaptiveSettings(const QString &testId, const AdaptiveSettings &s, QString *err)
+{
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+    QSqlQuery q(mDb);
+    if (s.enabled) {
+        q.prepare("INSERT OR REPLACE INTO adaptive_tests (test_id, min_items, target_se) VALUES (?, ?, ?)");
+        q.addBindValue(testId);
+        q.addBindValue(s.minItems);
+        q.addBindValue(s.targetSe);
+    } else {
+        q.prepare("DELETE FROM adaptive_tests WHERE test_id = ?");
+        q.addBindValue(testId);
+    }
+    if (!execOrFail(q, err)) return false;
+    if (!noteChange("tests", testId, testId, Change::Update, err)) return false;
+    return tx.commit(err);
+}
+
+bool DBManager::loadItemParams(const QString &testId, QVector<ItemParams> &outParams, QString *err)
+{
+    outParams.clear();
+    QSqlQuery q(mDb);
+    q.setForwardOnly(true);
+    q.prepare("SELECT p.question_id, p.a, p.b, p.responses FROM questions q "
+              "JOIN item_params p ON p.question_id = q.id WHERE q.test_id = ?");
+    q.addBindValue(testId);
+    if (!execOrFail(q, err)) return false;
+    while (q.next()) {
+        ItemParams p;
+        p.questionId = q.value(0).toString();
+        p.a = q.value(1).toDouble();
+        p.b = q.value(2).toDouble();
+        p.responses = q.value(3).toInt();
+        outParams.append(p);
+    }
+    return true;
+}
+
+bool DBManager::calibrateItems(const QString &testId, int *calibrated, QString *err)
+{
+    if (calibrated) *calibrated = 0;
+    // answers to questions currently in the test (also from attempts before a question was
+    // moved here, they measure the same item). CROSS JOIN keeps one pass over result_details,
+    // it has no index on question_id.
+    QSqlQuery q(mDb);
+    q.setForwardOnly(true);
+    q.prepare("SELECT d.result_id, d.question_id, d.correct FROM result_details d "
+              "CROSS JOIN questions q ON q.id = d.question_id WHERE q.test_id = ?");
+    q.addBindValue(testId);
+    if (!execOrFail(q, err)) return false;
+    QHash<qint64, int> personOf;
+    QHash<QString, int> itemOf;
+    QStringList itemIds;
+    QVector<AdaptiveEngine::Response> responses;
+    while (q.next()) {
+        AdaptiveEngine::Response r;
+        const qint64 resultId = q.value(0).toLongLong();
+        auto pit = personOf.constFind(resultId);
+        if (pit != personOf.constEnd()) {
+            r.person = pit.value();
+        } else {
+            r.person = personOf.size();
+            personOf.insert(resultId, r.person);
+        }
+        const QString questionId = q.value(1).toString();
+        auto iit = itemOf.constFind(questionId);
+        if (iit != itemOf.constEnd()) {
+            r.item = iit.value();
+        } else {
+            r.item = itemIds.size();
+            itemOf.insert(questionId, r.item);
+            itemIds.append(questionId);
+        }
+        r.correct = q.value(2).toInt() != 0;
+        responses.append(r);
+    }
+    q.finish();
+
+    const QVector<AdaptiveEngine::ItemParams> params =
+        AdaptiveEngine::calibrate(itemIds.size(), personOf.size(), responses);
+    QVector<int> counts(itemIds.size(), 0);
+    for (const AdaptiveEngine::Response &r : std::as_const(responses)) ++counts[r.item];
+
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+    QSqlQuery del(mDb);
+    del.prepare("DELETE FROM item_params WHERE question_id IN (SELECT id FROM questions WHERE test_id = ?)");
+    del.addBindValue(testId);
+    if (!execOrFail(del, err)) return false;
+    QSqlQuery ins(mDb);
+    ins.prepare("INSERT INTO item_params (question_id, a, b, responses, calibrated) VALUES (?, ?, ?, ?, ?)");
+    const QString now = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    for (int i = 0; i < itemIds.size(); ++i) {
+        ins.addBindValue(itemIds[i]);
+        ins.addBindValue(params[i].a);
+        ins.addBindValue(params[i].b);
+        ins.addBindValue(counts[i]);
+        ins.addBindValue(now);
+        if (!execOrFail(ins, err)) return false;
+    }
+    if (!tx.commit(err)) return false;
+    if (calibrated) *calibrated = itemIds.size();
+    qDebug() << "Calibrated" << itemIds.size() << "questions of test" << testId << "from" << responses.size() << "answers";
+    return true;
+}
+
+bool DBManager::loadSrsStates(const QString &studentEmail, const QString &testId, QVector<SrsState> &outStates,
+                              QString *err)
+{
+    outStates.clear();
+    QSqlQuery q(mDb);
+    q.setForwardOnly(true);
+    q.prepare("SELECT question_id, due, interval, ease, reps, lapses, last_review FROM srs_state "
+              "WHERE test_id = ? AND student_email = ?");
+    q.addBindValue(testId);
+    q.addBindValue(studentEmail.trimmed().toLower());
+    if (!execOrFail(q, err)) return false;
+    while (q.next()) {
+        SrsState s;
+        s.questionId = q.value(0).toString();
+        s.due = q.value(1).toLongLong();
+        s.interval = q.value(2).toDouble();
+        s.ease = q.value(3).toDouble();
+        s.reps = q.value(4).toInt();
+        s.lapses = q.value(5).toInt();
+        s.lastReview = q.value(6).toLongLong();
+        outStates.append(s);
+    }
+    return true;
+}
+
+bool DBManager::saveSrsState(const QString &studentEmail, const QString &testId, const SrsState &s, QString *err)
+{
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+    QSqlQuery q(mDb);
+    q.prepare("INSERT OR REPLACE INTO srs_state (test_id, student_email, question_id, due, interval, ease, reps, lapses, last_review) "
+              "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    q.addBindValue(testId);
+    q.addBindValue(studentEmail.trimmed().toLower());
+    q.addBindValue(s.questionId);
+    q.addBindValue(s.due);
+    q.addBindValue(s.interval);
+    q.addBindValue(s.ease);
+    q.addBindValue(s.reps);
+    q.addBindValue(s.lapses);
+    q.addBindValue(s.lastReview);
+    if (!execOrFail(q, err)) return false;
+    return tx.commit(err);
+}
+
+bool DBManager::loadQuestionIds(const QString &testId, QStringList *outIds, QString *err)
+{
+    outIds->clear();
+    QSqlQuery q(mDb);
+    q.setForwardOnly(true);
+    q.prepare("SELECT id FROM questions WHERE test_id = ? ORDER BY rowid");
+    q.addBindValue(testId);
+    if (!execOrFail(q, err)) return false;
+    while (q.next()) outIds->append(q.value(0).toString());
+    return true;
+}
+
+bool DBManager::enqueueMails(const QVector<OutgoingMail> &mails, int *queued, QString *err)
+{
+    if (queued) *queued = 0;
+    if (mails.isEmpty()) return true;
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    QSqlQuery q(mDb);
+    q.prepare("INSERT OR IGNORE INTO mail_queue (result_id, recipient, subject, body, next_attempt, created) "
+              "VALUES (?, ?, ?, ?, ?, ?)");
+    int n = 0;
+    for (const OutgoingMail &m : mails) {
+        q.addBindValue(m.resultId > 0 ? QVariant(m.resultId) : QVariant(QMetaType::fromType<qint64>()));
+        q.addBindValue(m.recipient);
+        q.addBindValue(m.subject);
+        q.addBindValue(m.body);
+        q.addBindValue(now);
+        q.addBindValue(now);
+        if (!execOrFail(q, err)) return false;
+        n += q.numRowsAffected();
+    }
+    if (!tx.commit(err)) return false;
+    if (queued) *queued = n;
+    return true;
+}
+
+bool DBManager::loadDueMails(qint64 now, int limit, QVector<OutgoingMail> &outMails, QString *err)
+{
+    outMails.clear();
+    QSqlQuery q(mDb);
+    q.setForwardOnly(true);
+    q.prepare("SELECT id, result_id, recipient, subject, body, attempts FROM mail_queue "
+              "WHERE status = ? AND next_attempt <= ? ORDER BY next_attempt, id LIMIT ?");
+    q.addBindValue(int(MailStatus::Pending));
+    q.addBindValue(now);
+    q.addBindValue(limit);
+    if (!execOrFail(q, err)) return false;
+    while (q.next()) {
+        OutgoingMail m;
+        m.id = q.value(0).toLongLong();
+        m.resultId = q.value(1).toLongLong();
+        m.recipient = q.value(2).toString();
+        m.subject = q.value(3).toString();
+        m.body = q.value(4).toString();
+        m.attempts = q.value(5).toInt();
+        outMails.append(m);
+    }
+    return true;
+}
+
+bool DBManager::markMailSent(qint64 id, qint64 now, QString *err)
+{
+    QSqlQuery q(mDb);
+    q.prepare("UPDATE mail_queue SET status = ?, attempts = attempts + 1, sent = ?, body = '', last_error = NULL "
+              "WHERE id = ?");
+    q.addBindValue(int(MailStatus::Sent));
+    q.addBindValue(now);
+    q.addBindValue(id);
+    return execOrFail(q, err);
+}
+
+bool DBManager::markMailRetry(qint64 id, int attempts, qint64 nextAttempt, const QString &error, QString *err)
+{
+    QSqlQuery q(mDb);
+    q.prepare("UPDATE mail_queue SET status = ?, attempts = ?, next_attempt = ?, last_error = ? WHERE id = ?");
+    q.addBindValue(int(nextAttempt > 0 ? MailStatus::Pending : MailStatus::Failed));
+    q.addBindValue(attempts);
+    q.addBindValue(nextAttempt);
+    q.addBindValue(error);
+    q.addBindValue(id);
+    return execOrFail(q, err);
+}
+
+bool DBManager::mailQueueCounts(int *pending, int *failed, QString *err)
+{
+    QSqlQuery q(mDb);
+    q.setForwardOnly(true);
+    q.prepare("SELECT status, COUNT(*) FROM mail_queue WHERE status IN (?, ?) GROUP BY status");
+    q.addBindValue(int(MailStatus::Pending));
+    q.addBindValue(int(MailStatus::Failed));
+    if (!execOrFail(q, err)) return false;
+    *pending = 0;
+    *failed = 0;
+    while (q.next()) {
+        if (q.value(0).toInt() == int(MailStatus::Pending)) *pending = q.value(1).toInt();
+        else *failed = q.value(1).toInt();
+    }
     return true;
 }
 
+bool DBManager::removeQuestion(const QString &questionId, QString *err)
+{
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+    QSqlQuery owner(mDb);
+    owner.prepare("SELECT test_id FROM questions WHERE id = ?");
+    owner.addBindValue(questionId);
+    if (!execOrFail(owner, err)) return false;
+    const QString testId = owner.next() ? owner.value(0).toString() : QString();
+    if (mHasFts) {
+        QSqlQuery fts(mDb);
+        fts.prepare("DELETE FROM questions_fts WHERE rowid = (SELECT rowid FROM questions WHERE id = ?)");
+        fts.addBindValue(questionId);
+        if (!execOrFail(fts, err)) return false;
+    }
+    QSqlQuery sig(mDb);
+    sig.prepare("DELETE FROM question_signatures WHERE question_id = ?");
+    sig.addBindValue(questionId);
+    if (!execOrFail(sig, err)) return false;
+    QSqlQuery lsh(mDb);
+    lsh.prepare("DELETE FROM question_lsh WHERE question_id = ?");
+    lsh.addBindValue(questionId);
+    if (!execOrFail(lsh, err)) return false;
+    QSqlQuery tags(mDb);
+    tags.prepare("DELETE FROM question_tags WHERE question_id = ?");
+    tags.addBindValue(questionId);
+    if (!execOrFail(tags, err)) return false;
+    tags.prepare("DELETE FROM item_params WHERE question_id = ?");
+    tags.addBindValue(questionId);
+    if (!execOrFail(tags, err)) return false;
+    tags.prepare("DELETE FROM srs_state WHERE question_id = ?");
+    tags.addBindValue(questionId);
+    if (!execOrFail(tags, err)) return false;
+    tags.prepare("DELETE FROM question_templates WHERE question_id = ?");
+    tags.addBindValue(questionId);
+    if (!execOrFail(tags, err)) return false;
+
+    QSqlQuery q(mDb);
+    q.prepare("DELETE FROM questions WHERE id = ?");
+    q.addBindValue(questionId);
+    if (!execOrFail(q, err)) return false;
+    if (!noteChange("questions", questionId, testId, Change::Delete, err)) return false;
+    return tx.commit(err);
+}
+
 bool DBManager::saveResult(const QString &studentEmail, const QString &testId, double score, int total,
                            const QVector<ResultDetail> &details, QString *err)
 {
-    if (!mDb.transaction()) {
-        if (err) *err = mDb.lastError().text();
+    ResultSubmission r;
+    r.testId = testId;
+    r.email = studentEmail;
+    r.score = score;
+    r.total = total;
+    r.details = details;
+    return saveResults(QVector<ResultSubmission>{ r }, err);
+}
+
+bool DBManager::saveResults(const QVector<ResultSubmission> &results, QString *err)
+{
+    if (results.isEmpty()) return true;
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+
+    // ids from this copy's range, reserved once per batch
+    qint64 detailCount = 0;
+    for (const ResultSubmission &r : results) detailCount += r.details.size();
+    qint64 resultId = 0, detailId = 0;
+    if (!reserveSiteRowIds("results", results.size(), &resultId, err)
+        || !reserveSiteRowIds("result_details", detailCount, &detailId, err))
         return false;
-    }
 
-    // Prepare positional insert for results
+    // prepared once for the whole batch, exec resets the positional binds
     QSqlQuery q(mDb);
-    q.prepare("INSERT INTO results (student_email, test_id, score, total, timestamp) VALUES (?, ?, ?, ?, ?)");
-    q.addBindValue(studentEmail);
-    q.addBindValue(testId);
-    q.addBindValue(score);
-    q.addBindValue(total);
-    q.addBindValue(QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
-    if (!execOrFail(q, err)) { mDb.rollback(); return false; }
+    q.prepare("INSERT INTO results (id, student_email, test_id, score, total, timestamp) VALUES (?, ?, ?, ?, ?, ?)");
+    QSqlQuery qd(mDb);
+    qd.prepare("INSERT INTO result_details (id, result_id, question_id, correct, user_answer) VALUES (?, ?, ?, ?, ?)");
+    const QString now = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
 
-    // get last inserted id
-    QSqlQuery q2(mDb);
-    q2.prepare("SELECT last_insert_rowid()");
-    if (!execOrFail(q2, err)) { mDb.rollback(); return false; }
-    if (!q2.next()) {
-        if (err) *err = "Cannot read last_insert_rowid()";
-        mDb.rollback();
+    for (const ResultSubmission &r : results) {
+        q.addBindValue(resultId);
+        q.addBindValue(r.email);
+        q.addBindValue(r.testId);
+        q.addBindValue(r.score);
+        q.addBindValue(r.total);
+        q.addBindValue(now);
+        if (!execOrFail(q, err)) return false;
+
+        for (const ResultDetail &d : r.details) {
+            qd.addBindValue(detailId++);
+            qd.addBindValue(resultId);
+            qd.addBindValue(d.questionId);
+            qd.addBindValue(d.correct ? 1 : 0);
+            qd.addBindValue(d.userAnswer);
+            if (!execOrFail(qd, err)) return false;
+        }
+        if (!noteChange("results", QString::number(resultId), r.testId, Change::Insert, err)) return false;
+        ++resultId;
+    }
+
+    return tx.commit(err);
+}
+
+bool DBManager::searchQuestions(const QString &text, const QString &testId, int offset, int limit,
+                                QVector<SearchHit> &outHits, QString *err)
+{
+    outHits.clear();
+    if (!mHasFts) {
+        if (err) *err = "Fulltextové vyhledávání není v této databázi k dispozici.";
         return false;
     }
-    int resultId = q2.value(0).toInt();
 
-    // Insert details using positional placeholders
-    for (const ResultDetail &d : details) {
-        QSqlQuery qd(mDb);
-        qd.prepare("INSERT INTO result_details (result_id, question_id, correct, user_answer) VALUES (?, ?, ?, ?)");
-        qd.addBindValue(resultId);
-        qd.addBindValue(d.questionId);
-        qd.addBindValue(d.correct ? 1 : 0);
-        qd.addBindValue(d.userAnswer);
-        if (!execOrFail(qd, err)) { mDb.rollback(); return false; }
+    // every word is a prefix term, all must match; quotes make user input safe for MATCH syntax
+    QStringList terms;
+    const QStringList words = text.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+    for (QString w : words) {
+        w.remove('"');
+        if (!w.isEmpty()) terms.append("\"" + w + "\"*");
     }
+    if (terms.isEmpty()) return true;
 
-    if (!mDb.commit()) {
-        if (err) *err = mDb.lastError().text();
-        mDb.rollback();
+    QString sql =
+        "SELECT q.id, q.test_id, t.name, snippet(questions_fts, -1, '[', ']', '...', 12) "
+        "FROM questions_fts "
+        "JOIN questions q ON q.rowid = questions_fts.rowid "
+        "JOIN tests t ON t.id = q.test_id "
+        "WHERE questions_fts MATCH ?";
+    if (!testId.isEmpty()) sql += " AND q.test_id = ?";
+    sql += " ORDER BY rank LIMIT ? OFFSET ?";
+
+    QSqlQuery q(mDb);
+    q.prepare(sql);
+    q.addBindValue(terms.join(' '));
+    if (!testId.isEmpty()) q.addBindValue(testId);
+    q.addBindValue(limit);
+    q.addBindValue(offset);
+    if (!execOrFail(q, err)) return false;
+    while (q.next()) {
+        SearchHit h;
+        h.questionId = q.value(0).toString();
+        h.testId = q.value(1).toString();
+        h.testName = q.value(2).toString();
+        h.snippet = q.value(3).toString();
+        outHits.append(h);
+    }
+    return true;
+}
+
+// called inside a write transaction
+bool DBManager::updateSimilarityIndex(const Question &qobj, QString *err)
+{
+    const QVector<quint32> sig = SimilarityIndex::signature(qobj);
+
+    QSqlQuery upd(mDb);
+    upd.prepare("INSERT OR REPLACE INTO question_signatures (question_id, signature) VALUES (?, ?)");
+    upd.addBindValue(qobj.id);
+    upd.addBindValue(SimilarityIndex::toBlob(sig));
+    if (!execOrFail(upd, err)) return false;
+
+    QSqlQuery del(mDb);
+    del.prepare("DELETE FROM question_lsh WHERE question_id = ?");
+    del.addBindValue(qobj.id);
+    if (!execOrFail(del, err)) return false;
+
+    QSqlQuery ins(mDb);
+    ins.prepare("INSERT OR IGNORE INTO question_lsh (lsh_key, question_id) VALUES (?, ?)");
+    const QVector<qint64> keys = SimilarityIndex::bandKeys(sig);
+    for (qint64 key : keys) {
+        ins.addBindValue(key);
+        ins.addBindValue(qobj.id);
+        if (!execOrFail(ins, err)) return false;
+    }
+    return true;
+}
+
+// signatures for questions written before the index existed
+bool DBManager::backfillSimilarityIndex(QString *err)
+{
+    QSqlQuery q(mDb);
+    q.prepare("SELECT q.id, q.text, q.type, q.expected_text FROM questions q "
+              "LEFT JOIN question_signatures s ON s.question_id = q.id "
+              "WHERE s.question_id IS NULL");
+    if (!execOrFail(q, err)) return false;
+    QVector<Question> missing;
+    while (q.next()) {
+        Question qq;
+        qq.id = q.value(0).toString();
+        qq.text = q.value(1).toString();
+        qq.type = static_cast<QuestionType>(q.value(2).toInt());
+        qq.expectedText = q.value(3).toString();
+        missing.append(qq);
+    }
+    if (missing.isEmpty()) return true;
+
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+    QSqlQuery opts(mDb);
+    opts.prepare("SELECT text, correct FROM options WHERE question_id = ? ORDER BY ord");
+    for (Question &qq : missing) {
+        opts.addBindValue(qq.id);
+        if (!execOrFail(opts, err)) return false;
+        while (opts.next()) {
+            Answer a;
+            a.text = opts.value(0).toString();
+            a.correct = opts.value(1).toInt() != 0;
+            qq.options.append(a);
+        }
+        if (!updateSimilarityIndex(qq, err)) return false;
+    }
+    if (!tx.commit(err)) return false;
+    qDebug() << "Similarity index backfilled for" << missing.size() << "questions";
+    return true;
+}
+
+bool DBManager::rebuildSimilarityIndex(QString *err)
+{
+    QSqlQuery q(mDb);
+    q.prepare("DELETE FROM question_lsh");
+    if (!execOrFail(q, err)) return false;
+    q.prepare("DELETE FROM question_signatures");
+    if (!execOrFail(q, err)) return false;
+    return backfillSimilarityIndex(err);
+}
+
+bool DBManager::findDuplicates(const QString &testId, double threshold, QVector<DuplicateGroup> &outGroups,
+                               QString *err)
+{
+    outGroups.clear();
+    if (!backfillSimilarityIndex(err)) return false;
+
+    // 1) LSH buckets with more than one member, streamed in key order
+    QSqlQuery q(mDb);
+    if (testId.isEmpty()) {
+        q.prepare("SELECT lsh_key, question_id FROM question_lsh WHERE lsh_key IN ("
+                  "SELECT lsh_key FROM question_lsh GROUP BY lsh_key HAVING COUNT(1) > 1) "
+                  "ORDER BY lsh_key");
+    } else {
+        q.prepare("SELECT l.lsh_key, l.question_id FROM question_lsh l "
+                  "JOIN questions q ON q.id = l.question_id "
+                  "WHERE q.test_id = ? ORDER BY l.lsh_key");
+        q.addBindValue(testId);
+    }
+    if (!execOrFail(q, err)) return false;
+
+    QVector<QStringList> buckets;
+    QSet<QString> candidates;
+    QStringList members;
+    qint64 curKey = 0;
+    auto closeBucket = [&]() {
+        if (members.size() > 1) {
+            for (const QString &id : std::as_const(members)) candidates.insert(id);
+            buckets.append(members);
+        }
+        members.clear();
+    };
+    while (q.next()) {
+        qint64 key = q.value(0).toLongLong();
+        if (!members.isEmpty() && key != curKey) closeBucket();
+        curKey = key;
+        members.append(q.value(1).toString());
+    }
+    closeBucket();
+    if (buckets.isEmpty()) return true;
+
+    // 2) signatures of the candidates only
+    QHash<QString, QVector<quint32>> sigs;
+    QSqlQuery qs(mDb);
+    qs.prepare("SELECT signature FROM question_signatures WHERE question_id = ?");
+    for (const QString &id : std::as_const(candidates)) {
+        qs.addBindValue(id);
+        if (!execOrFail(qs, err)) return false;
+        if (qs.next()) sigs.insert(id, SimilarityIndex::fromBlob(qs.value(0).toByteArray()));
+    }
+
+    // 3) verify candidates against a few representatives per bucket (bounded work per row),
+    //    verified pairs are merged with union-find
+    QHash<QString, QString> parent;
+    std::function<QString(const QString &)> findRoot = [&](const QString &id) -> QString {
+        QString p = parent.value(id, id);
+        if (p == id) return id;
+        QString r = findRoot(p);
+        parent.insert(id, r);
+        return r;
+    };
+    struct Pair { QString a; double sim; };
+    QVector<Pair> verified;
+    const int maxRepresentatives = 8;
+    for (const QStringList &bucket : std::as_const(buckets)) {
+        QStringList reps;
+        for (const QString &id : bucket) {
+            const QVector<quint32> sig = sigs.value(id);
+            bool matched = false;
+            for (const QString &rep : std::as_const(reps)) {
+                double sim = SimilarityIndex::similarity(sig, sigs.value(rep));
+                if (sim >= threshold) {
+                    QString ra = findRoot(id), rb = findRoot(rep);
+                    if (ra != rb) parent.insert(ra, rb);
+                    verified.append(Pair{id, sim});
+                    matched = true;
+                    break;
+                }
+            }
+            if (!matched && reps.size() < maxRepresentatives) reps.append(id);
+        }
+    }
+
+    // 4) groups by root
+    QHash<QString, int> groupOfRoot;
+    QVector<QStringList> groupIds;
+    QVector<double> groupSim;
+    for (const Pair &p : std::as_const(verified)) {
+        QString root = findRoot(p.a);
+        int gi = groupOfRoot.value(root, -1);
+        if (gi < 0) {
+            gi = groupIds.size();
+            groupOfRoot.insert(root, gi);
+            groupIds.append(QStringList());
+            groupSim.append(1.0);
+        }
+        groupSim[gi] = qMin(groupSim[gi], p.sim);
+    }
+    // findRoot compresses paths (writes to parent), so iterate over a copy of the keys
+    const QStringList unioned = parent.keys();
+    for (const QString &id : unioned) {
+        int gi = groupOfRoot.value(findRoot(id), -1);
+        if (gi >= 0) groupIds[gi].append(id);
+    }
+    for (auto it = groupOfRoot.constBegin(); it != groupOfRoot.constEnd(); ++it) {
+        if (!groupIds[it.value()].contains(it.key())) groupIds[it.value()].append(it.key());
+    }
+
+    // 5) texts for the report; questions of removed tests are skipped
+    QSqlQuery qt(mDb);
+    qt.prepare("SELECT q.text, t.name FROM questions q JOIN tests t ON t.id = q.test_id WHERE q.id = ?");
+    for (int gi = 0; gi < groupIds.size(); ++gi) {
+        DuplicateGroup g;
+        g.similarity = groupSim[gi];
+        for (const QString &id : std::as_const(groupIds[gi])) {
+            qt.addBindValue(id);
+            if (!execOrFail(qt, err)) return false;
+            if (!qt.next()) continue;
+            DuplicateItem item;
+            item.questionId = id;
+            item.text = qt.value(0).toString();
+            item.testName = qt.value(1).toString();
+            g.items.append(item);
+        }
+        if (g.items.size() > 1) outGroups.append(g);
+    }
+    std::sort(outGroups.begin(), outGroups.end(), [](const DuplicateGroup &a, const DuplicateGroup &b) {
+        return a.items.size() > b.items.size();
+    });
+    return true;
+}
+
+bool DBManager::loadResultsPage(const ResultFilter &filter, qint64 afterId, int limit,
+                                QVector<ResultRecord> &outResults, QString *err)
+{
+    return loadResultsPageFrom("main", filter, afterId, limit, outResults, err);
+}
+
+bool DBManager::loadResultsPageFrom(const QString &schema, const ResultFilter &filter, qint64 afterId, int limit,
+                                    QVector<ResultRecord> &outResults, QString *err)
+{
+    outResults.clear();
+
+    // same predicate for the results page and for its details
+    QString where = "id > ?";
+    QVariantList binds;
+    binds << afterId;
+    if (!filter.testId.isEmpty()) { where += " AND test_id = ?"; binds << filter.testId; }
+    if (!filter.from.isEmpty()) { where += " AND timestamp >= ?"; binds << filter.from; }
+    if (!filter.to.isEmpty()) { where += " AND timestamp < ?"; binds << filter.to; }
+    if (!filter.studentEmail.isEmpty()) { where += " AND student_email = ? COLLATE NOCASE"; binds << filter.studentEmail; }
+    binds << limit;
+    const QString page = "SELECT id FROM " + schema + ".results WHERE " + where + " ORDER BY id LIMIT ?";
+
+    QSqlQuery q(mDb);
+    q.prepare("SELECT id, student_email, test_id, score, total, timestamp FROM " + schema + ".results WHERE id IN ("
+              + page + ") ORDER BY id");
+    for (const QVariant &v : std::as_const(binds)) q.addBindValue(v);
+    if (!execOrFail(q, err)) return false;
+    QHash<qint64, int> posById;
+    while (q.next()) {
+        ResultRecord r;
+        r.id = q.value(0).toLongLong();
+        r.studentEmail = q.value(1).toString();
+        r.testId = q.value(2).toString();
+        r.score = q.value(3).toDouble();
+        r.total = q.value(4).toInt();
+        r.timestamp = q.value(5).toString();
+        posById.insert(r.id, outResults.size());
+        outResults.append(r);
+    }
+    if (outResults.isEmpty()) return true;
+
+    QSqlQuery qd(mDb);
+    qd.prepare("SELECT result_id, question_id, correct, user_answer FROM " + schema + ".result_details WHERE result_id IN ("
+               + page + ") ORDER BY result_id, id");
+    for (const QVariant &v : std::as_const(binds)) qd.addBindValue(v);
+    if (!execOrFail(qd, err)) return false;
+    while (qd.next()) {
+        auto it = posById.constFind(qd.value(0).toLongLong());
+        if (it == posById.constEnd()) continue;
+        ResultDetail d;
+        d.questionId = qd.value(1).toString();
+        d.correct = qd.value(2).toInt() != 0;
+        d.userAnswer = qd.value(3).toString();
+        outResults[it.value()].details.append(d);
+    }
+    return true;
+}
+
+bool DBManager::browseResults(const ResultFilter &filter, ResultKey *key, int limit,
+                              QVector<ResultRow> &outRows, QString *err)
+{
+    outRows.clear();
+    // row value comparison: SQLite walks the (…, timestamp, id) index backwards from the key
+    QStringList where;
+    QVariantList binds;
+    if (!key->timestamp.isEmpty()) { where << "(r.timestamp, r.id) < (?, ?)"; binds << key->timestamp << key->id; }
+    if (!filter.testId.isEmpty()) { where << "r.test_id = ?"; binds << filter.testId; }
+    if (!filter.studentEmail.isEmpty()) { where << "r.student_email = ? COLLATE NOCASE"; binds << filter.studentEmail; }
+    if (!filter.from.isEmpty()) { where << "r.timestamp >= ?"; binds << filter.from; }
+    if (!filter.to.isEmpty()) { where << "r.timestamp < ?"; binds << filter.to; }
+    binds << limit;
+
+    QSqlQuery q(mDb);
+    q.prepare("SELECT r.id, r.student_email, r.test_id, t.name, r.score, r.total, r.timestamp "
+              "FROM results r LEFT JOIN tests t ON t.id = r.test_id "
+              + (where.isEmpty() ? QString() : "WHERE " + where.join(" AND ") + " ")
+              + "ORDER BY r.timestamp DESC, r.id DESC LIMIT ?");
+    for (const QVariant &v : std::as_const(binds)) q.addBindValue(v);
+    if (!execOrFail(q, err)) return false;
+    while (q.next()) {
+        ResultRow r;
+        r.id = q.value(0).toLongLong();
+        r.studentEmail = q.value(1).toString();
+        r.testId = q.value(2).toString();
+        r.testName = q.value(3).toString();
+        r.score = q.value(4).toDouble();
+        r.total = q.value(5).toInt();
+        r.timestamp = q.value(6).toString();
+        outRows.append(r);
+    }
+    if (!outRows.isEmpty()) {
+        key->timestamp = outRows.last().timestamp;
+        key->id = outRows.last().id;
+    }
+    return true;
+}
+
+bool DBManager::loadResultDetails(qint64 resultId, QVector<ResultDetailRow> &outDetails, QString *err)
+{
+    outDetails.clear();
+    QSqlQuery q(mDb);
+    q.prepare("SELECT d.question_id, qq.text, d.correct, d.user_answer FROM result_details d "
+              "LEFT JOIN questions qq ON qq.id = d.question_id WHERE d.result_id = ? ORDER BY d.id");
+    q.addBindValue(resultId);
+    if (!execOrFail(q, err)) return false;
+    while (q.next()) {
+        ResultDetailRow d;
+        d.questionId = q.value(0).toString();
+        d.questionText = q.value(1).toString();
+        d.correct = q.value(2).toInt() != 0;
+        d.userAnswer = q.value(3).toString();
+        outDetails.append(d);
+    }
+    return true;
+}
+
+bool DBManager::loadResultsPage(const ResultFilter &filter, ResultCursor *cursor, int limit,
+                                QVector<ResultRecord> &outResults, QString *err)
+{
+    outResults.clear();
+    // stores: working DB, then archives whose time range overlaps the filter
+    QStringList stores{ QString() };
+    if (filter.includeArchived) {
+        QVector<ResultArchive> archives;
+        if (!resultArchives(archives, err)) return false;
+        for (const ResultArchive &a : std::as_const(archives)) {
+            if (!filter.from.isEmpty() && a.maxTimestamp < filter.from) continue;
+            if (!filter.to.isEmpty() && a.minTimestamp >= filter.to) continue;
+            stores.append(a.fileName);
+        }
+    }
+
+    while (cursor->store < stores.size()) {
+        const QString &store = stores[cursor->store];
+        if (!store.isEmpty() && !attachArchive(store, err)) return false;
+        if (!loadResultsPageFrom(store.isEmpty() ? "main" : "archive", filter, cursor->afterId, limit, outResults, err))
+            return false;
+        if (!outResults.isEmpty()) {
+            cursor->afterId = outResults.last().id;
+            if (outResults.size() == limit) return true;
+        }
+        // this store is exhausted; a short page is returned as it is
+        ++cursor->store;
+        cursor->afterId = 0;
+        if (!outResults.isEmpty()) return true;
+    }
+    detachArchive();
+    return true;
+}
+
+QString DBManager::archiveDirectory() const
+{
+    return QFileInfo(databasePath()).absolutePath() + "/archive";
+}
+
+bool DBManager::attachArchive(const QString &fileName, QString *err)
+{
+    if (mAttachedArchive == fileName) return true;
+    detachArchive();
+    QSqlQuery q(mDb);
+    q.prepare("ATTACH DATABASE ? AS archive");
+    q.addBindValue(QDir(archiveDirectory()).filePath(fileName));
+    if (!execOrFail(q, err)) return false;
+    mAttachedArchive = fileName;
+    return true;
+}
+
+void DBManager::detachArchive()
+{
+    if (mAttachedArchive.isEmpty()) return;
+    QSqlQuery q(mDb);
+    if (!q.exec("DETACH DATABASE archive")) qDebug() << "DETACH archive failed:" << q.lastError().text();
+    mAttachedArchive.clear();
+}
+
+bool DBManager::resultArchives(QVector<ResultArchive> &outArchives, QString *err)
+{
+    outArchives.clear();
+    QSqlQuery q(mDb);
+    q.prepare("SELECT term, file_name, result_count, min_timestamp, max_timestamp FROM result_archives ORDER BY term");
+    if (!execOrFail(q, err)) return false;
+    while (q.next()) {
+        ResultArchive a;
+        a.term = q.value(0).toString();
+        a.fileName = q.value(1).toString();
+        a.count = q.value(2).toLongLong();
+        a.minTimestamp = q.value(3).toString();
+        a.maxTimestamp = q.value(4).toString();
+        outArchives.append(a);
+    }
+    return true;
+}
+
+// school term of a result timestamp, see ResultArchive
+static const char *TermSql =
+    "(CASE WHEN CAST(strftime('%m', timestamp) AS INTEGER) >= 9 THEN strftime('%Y', timestamp) || '-1' "
+    "WHEN CAST(strftime('%m', timestamp) AS INTEGER) = 1 THEN (CAST(strftime('%Y', timestamp) AS INTEGER) - 1) || '-1' "
+    "ELSE (CAST(strftime('%Y', timestamp) AS INTEGER) - 1) || '-2' END)";
+
+bool DBManager::archiveResults(const QString &cutoff, qint64 *movedResults, QString *err)
+{
+    if (movedResults) *movedResults = 0;
+    if (mTxDepth > 0) {
+        if (err) *err = "Archiving cannot run inside a transaction (ATTACH).";
         return false;
     }
+    detachArchive();
+
+    QSqlQuery q(mDb);
+    q.prepare(QString("SELECT DISTINCT %1 FROM results WHERE timestamp < ?").arg(TermSql));
+    q.addBindValue(cutoff);
+    if (!execOrFail(q, err)) return false;
+    QStringList terms;
+    while (q.next()) if (!q.value(0).isNull()) terms.append(q.value(0).toString());
+    q.finish();
+    if (terms.isEmpty()) return true;
+    QDir().mkpath(archiveDirectory());
+
+    // ids moved by the current term; only these are deleted from the main database afterwards
+    q.prepare("CREATE TEMP TABLE IF NOT EXISTS archive_batch (id INTEGER PRIMARY KEY)");
+    if (!execOrFail(q, err)) return false;
+    const QString selected = "SELECT id FROM temp.archive_batch";
+    for (const QString &term : std::as_const(terms)) {
+        const QString fileName = QFileInfo(databasePath()).completeBaseName() + "-results-" + term + ".db";
+        if (!attachArchive(fileName, err)) return false;
+
+        QSqlQuery a(mDb);
+        const char *schema[] = {
+            "CREATE TABLE IF NOT EXISTS archive.results (id INTEGER PRIMARY KEY, student_email TEXT, test_id TEXT, "
+            "score REAL, total INTEGER, timestamp TEXT)",
+            "CREATE TABLE IF NOT EXISTS archive.result_details (id INTEGER PRIMARY KEY, result_id INTEGER NOT NULL, "
+            "question_id TEXT, correct INTEGER, user_answer TEXT)",
+            "CREATE INDEX IF NOT EXISTS archive.idx_results_test ON results(test_id)",
+            "CREATE INDEX IF NOT EXISTS archive.idx_result_details_result ON result_details(result_id)"
+        };
+        for (const char *sql : schema) {
+            a.prepare(sql);
+            if (!execOrFail(a, err)) { detachArchive(); return false; }
+        }
+
+        // 1) copy; in WAL mode a transaction over two files is not atomic as a whole,
+        //    so rows are deleted only after the archive has committed them
+        {
+            DbTransaction tx(err);
+            if (!tx.isActive()) { detachArchive(); return false; }
+            a.prepare("DELETE FROM temp.archive_batch");
+            bool ok = execOrFail(a, err);
+            if (ok) {
+                a.prepare(QString("INSERT INTO temp.archive_batch (id) SELECT id FROM main.results WHERE timestamp < ? AND %1 = ?")
+                              .arg(TermSql));
+                a.addBindValue(cutoff);
+                a.addBindValue(term);
+                ok = execOrFail(a, err);
+            }
+            // plain INSERT: an id the archive holds for a different row aborts the run instead of
+            // losing the row; rows an interrupted earlier run already copied unchanged are skipped
+            if (ok) {
+                a.prepare("INSERT INTO archive.results (id, student_email, test_id, score, total, timestamp) "
+                          "SELECT m.id, m.student_email, m.test_id, m.score, m.total, m.timestamp FROM main.results m "
+                          "WHERE m.id IN (" + selected + ") AND NOT EXISTS (SELECT 1 FROM archive.results x WHERE x.id = m.id "
+                          "AND x.student_email IS m.student_email AND x.test_id IS m.test_id AND x.score IS m.score "
+                          "AND x.total IS m.total AND x.timestamp IS m.timestamp)");
+                ok = execOrFail(a, err);
+            }
+            if (ok) {
+                a.prepare("INSERT INTO archive.result_details (id, result_id, question_id, correct, user_answer) "
+                          "SELECT d.id, d.result_id, d.question_id, d.correct, d.user_answer FROM main.result_details d "
+                          "WHERE d.result_id IN (" + selected + ") AND NOT EXISTS (SELECT 1 FROM archive.result_details x "
+                          "WHERE x.id = d.id AND x.result_id = d.result_id)");
+                ok = execOrFail(a, err);
+            }
+            // DETACH is not possible inside the transaction
+            if (!ok || !tx.commit(err)) { tx.rollback(); detachArchive(); return false; }
+        }
+
+        // 2) delete the rows copied above and register the archive
+        int moved = 0;
+        {
+            DbTransaction tx(err);
+            if (!tx.isActive()) { detachArchive(); return false; }
+            a.prepare("DELETE FROM main.result_details WHERE result_id IN (" + selected + ")");
+            bool ok = execOrFail(a, err);
+            if (ok) {
+                a.prepare("DELETE FROM main.results WHERE id IN (" + selected + ")");
+                ok = execOrFail(a, err);
+                moved = a.numRowsAffected();
+            }
+            if (ok) {
+                a.prepare("INSERT OR REPLACE INTO result_archives (term, file_name, result_count, min_timestamp, max_timestamp) "
+                          "SELECT ?, ?, COUNT(*), MIN(timestamp), MAX(timestamp) FROM archive.results");
+                a.addBindValue(term);
+                a.addBindValue(fileName);
+                ok = execOrFail(a, err);
+            }
+            if (ok) ok = noteChange("results", QString(), QString(), Change::Reset, err);
+            if (!ok || !tx.commit(err)) { tx.rollback(); detachArchive(); return false; }
+        }
+        if (movedResults) *movedResults += moved;
+        qDebug() << "Archived" << moved << "results of term" << term << "to" << fileName;
+    }
+    detachArchive();
+    return true;
+}
+
+bool DBManager::optimize(QString *err)
+{
+    QSqlQuery q(mDb);
+    // watchers that fall further behind get a Reset instead of the single changes
+    q.prepare("DELETE FROM change_log WHERE seq <= (SELECT MAX(seq) FROM change_log) - ?");
+    q.addBindValue(ChangeLogKeep);
+    if (!execOrFail(q, err)) return false;
+    q.prepare("PRAGMA optimize");
+    return execOrFail(q, err);
+}
+
+bool DBManager::isIncrementalVacuum(QString *err)
+{
+    QSqlQuery q(mDb);
+    q.prepare("PRAGMA auto_vacuum");
+    if (!execOrFail(q, err)) return false;
+    return q.next() && q.value(0).toInt() == 2;
+}
+
+bool DBManager::convertToIncrementalVacuum(QString *err)
+{
+    QSqlQuery q(mDb);
+    q.prepare("PRAGMA auto_vacuum=INCREMENTAL");
+    if (!execOrFail(q, err)) return false;
+    q.prepare("VACUUM");
+    if (!execOrFail(q, err)) return false;
+    // VACUUM may renumber rowids of tables without INTEGER PRIMARY KEY (questions),
+    // questions_fts is keyed by them
+    if (mHasFts && !rebuildSearchIndex(err)) return false;
+    // so are the keyset cursors of the test and question lists: everybody reloads
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+    if (!noteChange("*", QString(), QString(), Change::Reset, err)) return false;
+    return tx.commit(err);
+}
+
+bool DBManager::incrementalVacuum(int maxPages, int *freedPages, int *remainingFreePages, QString *err)
+{
+    QSqlQuery q(mDb);
+    q.prepare("PRAGMA freelist_count");
+    if (!execOrFail(q, err)) return false;
+    const int before = q.next() ? q.value(0).toInt() : 0;
+    int after = before;
+    if (before > 0) {
+        q.prepare(QString("PRAGMA incremental_vacuum(%1)").arg(maxPages));
+        if (!execOrFail(q, err)) return false;
+        while (q.next()) {} // the pragma frees pages while it is stepped
+        q.finish();
+        q.prepare("PRAGMA freelist_count");
+        if (!execOrFail(q, err)) return false;
+        after = q.next() ? q.value(0).toInt() : 0;
+    }
+    if (freedPages) *freedPages = before - after;
+    if (remainingFreePages) *remainingFreePages = after;
+    return true;
+}
+
+bool DBManager::databaseSize(qint64 *pageCount, qint64 *pageSize, QString *err)
+{
+    QSqlQuery q(mDb);
+    q.prepare("PRAGMA page_count");
+    if (!execOrFail(q, err)) return false;
+    *pageCount = q.next() ? q.value(0).toLongLong() : 0;
+    q.prepare("PRAGMA page_size");
+    if (!execOrFail(q, err)) return false;
+    *pageSize = q.next() ? q.value(0).toLongLong() : 0;
+    return true;
+}
+
+QStringList DBManager::tableNames(QString *err)
+{
+    QStringList names;
+    QSqlQuery q(mDb);
+    q.prepare("SELECT name FROM sqlite_master WHERE type = 'table' ORDER BY name");
+    if (!execOrFail(q, err)) return names;
+    while (q.next()) names.append(q.value(0).toString());
+    return names;
+}
+
+bool DBManager::quickCheckTable(const QString &table, QStringList *problems, QString *err)
+{
+    problems->clear();
+    QString quoted = table;
+    quoted.replace("\"", "\"\"");
+    QSqlQuery q(mDb);
+    q.prepare(QString("PRAGMA quick_check(\"%1\")").arg(quoted));
+    if (!execOrFail(q, err)) return false;
+    while (q.next()) {
+        const QString line = q.value(0).toString();
+        if (line != "ok") problems->append(line);
+    }
     return true;
 }
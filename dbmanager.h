@@ -3,28 +3,173 @@
 
 #include <QString>
 #include <QVector>
+#include <QHash>
 #include <QSqlDatabase>
+#include <functional>
 #include "models.h"
 
+class DbTransaction;
+
 // Simple DB manager for SQLite usage
 class DBManager
 {
+    friend class DbTransaction;
 public:
     static DBManager &instance();
+    // path used when no other database is given on the command line
+    static QString defaultDatabasePath() { return "../../questions.db"; }
 
     // open (and create) database file
     bool openDatabase(const QString &path, QString *err = nullptr);
+    bool isOpen() const { return mDb.isValid() && mDb.isOpen(); }
+    void closeDatabase() { if (isOpen()) mDb.close(); }
+    QString databasePath() const { return mDb.databaseName(); }
+    // Journal mode, stored in the file. WAL lets readers (online backup, exports) run
+    // next to writers, but every process using the file must share memory with the
+    // others, i.e. run on the same machine; a questions.db that kiosks open over a
+    // network share has to stay in rollback-journal mode. Only the teacher editor
+    // and the exam host set the mode (WAL with --wal), other openers leave it alone.
+    bool setWriteAheadLog(bool on, QString *err = nullptr);
 
     // Tests (sady otázek)
     bool loadTests(QVector<Test> &outTests, QString *err = nullptr);
     bool addOrUpdateTest(const Test &t, QString *err = nullptr);
     bool removeTest(const QString &testId, QString *err = nullptr);
 
+    bool loadTest(const QString &testId, Test *outTest, bool *found, QString *err = nullptr);
+    // Test catalog: tests with their aggregates in one query, one page ordered by rowid.
+    // Aggregates only cover the working DB (archived results are not counted).
+    struct TestStatistics {
+        int questionCount = 0;
+        qint64 attemptCount = 0;
+        double averagePercent = -1.0; // average score in % of total; -1 = no attempts
+    };
+    struct CatalogEntry {
+        qint64 rowId = 0; // keyset cursor
+        Test test;
+        TestStatistics stats;
+    };
+    struct CatalogQuery {
+        QString nameFilter; // substring of the name, empty = all tests
+        QString testId;     // only this test (refreshing one row), empty = all
+        qint64 afterRowId = 0;
+        int limit = -1;     // -1 = no limit
+    };
+    bool loadTestCatalog(const CatalogQuery &query, QVector<CatalogEntry> &outEntries, QString *err = nullptr);
+
     // CRUD for questions
     bool loadAllQuestions(QVector<Question> &outQuestions, QString *err = nullptr); // legacy: load all questions regardless test
     bool loadQuestionsForTest(const QString &testId, QVector<Question> &outQuestions, QString *err = nullptr);
+    // one page of questions of a test ordered by rowid; afterRowId is the keyset cursor
+    // (0 for the first page), lastRowId receives the cursor for the next page; limit -1 = no limit
+    bool loadQuestionsPage(const QString &testId, qint64 afterRowId, int limit,
+                           QVector<Question> &outQuestions, qint64 *lastRowId, QString *err = nullptr);
+    bool loadQuestion(const QString &questionId, Question *outQuestion, bool *found, QString *err = nullptr);
     bool addOrUpdateQuestion(const Question &q, QString *err = nullptr);
     bool removeQuestion(const QString &questionId, QString *err = nullptr);
+    // Bulk insert of new questions (ids and test ids already set) in one transaction
+    // with reused prepared statements. nextBatch fills the next batch and returns true,
+    // an empty batch ends the import; returning false aborts and rolls everything back.
+    bool importQuestions(const std::function<bool(QVector<Question> &batch, QString *err)> &nextBatch,
+                         int *imported = nullptr, QString *err = nullptr);
+    // questions in the order of ids (ids that do not exist are skipped)
+    bool loadQuestionsByIds(const QStringList &ids, QVector<Question> &outQuestions, QString *err = nullptr);
+    // Parametric questions (see QuestionTemplate): definition per question, none = plain question
+    bool loadQuestionTemplate(const QString &questionId, QString *definition, QString *err = nullptr);
+    bool setQuestionTemplate(const QString &questionId, const QString &definition, QString *err = nullptr);
+    // definitions of those of ids that are templates
+    bool loadQuestionTemplates(const QStringList &ids, QHash<QString, QString> *definitions, QString *err = nullptr);
+
+    // Tags: hierarchical categories of questions written as paths ("Kapitola 1/Zlomky").
+    // tag_closure holds every ancestor-descendant pair (and each tag with itself), so
+    // "questions under a tag" is one indexed lookup at any depth.
+    struct Tag {
+        qint64 id = 0;
+        qint64 parentId = 0; // 0 = top level
+        QString name;
+        QString path;
+    };
+    bool loadTags(QVector<Tag> &outTags, QString *err = nullptr); // ordered by path
+    // id of the tag, missing levels of the path are created
+    bool ensureTagPath(const QString &path, qint64 *tagId, QString *err = nullptr);
+    bool questionTags(const QString &questionId, QStringList *outPaths, QString *err = nullptr);
+    bool setQuestionTags(const QString &questionId, const QStringList &paths, QString *err = nullptr);
+
+    // Blueprint of a test: ordered rules "count questions under tagPath". A draw takes each
+    // rule in turn, then fills up to studentCount from the whole test; no question twice.
+    struct BlueprintRule {
+        QString tagPath;
+        int count = 0;
+    };
+    bool loadBlueprint(const QString &testId, QVector<BlueprintRule> &outRules, QString *err = nullptr);
+    bool saveBlueprint(const QString &testId, const QVector<BlueprintRule> &rules, QString *err = nullptr);
+    // Stratified random draw of count question ids following the blueprint. Candidates are
+    // streamed from the indexes and reservoir-sampled, only the drawn ids are kept in memory.
+    bool drawQuestionIds(const QString &testId, int count, QStringList *outIds, QString *err = nullptr);
+    // candidate ids of each rule, for drawing from a bank already in memory (ExamSessionManager)
+    struct BlueprintStratum {
+        int count = 0;
+        QStringList questionIds;
+    };
+    bool loadBlueprintStrata(const QString &testId, QVector<BlueprintStratum> &outStrata, QString *err = nullptr);
+
+    // Adaptive testing (see AdaptiveEngine): a test with settings asks one question at a
+    // time, chosen by the answers so far, until the ability is known to targetSe or
+    // studentCount questions were asked.
+    struct AdaptiveSettings {
+        bool enabled = false;
+        int minItems = 5;
+        double targetSe = 0.3;
+    };
+    bool loadAdaptiveSettings(const QString &testId, AdaptiveSettings *out, QString *err = nullptr);
+    bool saveAdaptiveSettings(const QString &testId, const AdaptiveSettings &s, QString *err = nullptr);
+    // IRT parameters of calibrated questions of a test (uncalibrated ones are missing)
+    struct ItemParams {
+        QString questionId;
+        double a = 1.0;
+        double b = 0.0;
+        int responses = 0; // answers the estimate is based on
+    };
+    bool loadItemParams(const QString &testId, QVector<ItemParams> &outParams, QString *err = nullptr);
+    // estimates the parameters of the test's questions from its results (not archived ones)
+    bool calibrateItems(const QString &testId, int *calibrated = nullptr, QString *err = nullptr);
+
+    // Practice mode: spaced-repetition memory state per student and question (see
+    // PracticeScheduler). Emails are compared in lower case.
+    struct SrsState {
+        QString questionId;
+        qint64 due = 0;        // seconds since epoch
+        double interval = 0.0; // days
+        double ease = 2.5;
+        int reps = 0;          // correct answers in a row
+        int lapses = 0;
+        qint64 lastReview = 0;
+    };
+    bool loadSrsStates(const QString &studentEmail, const QString &testId, QVector<SrsState> &outStates,
+                       QString *err = nullptr);
+    bool saveSrsState(const QString &studentEmail, const QString &testId, const SrsState &s, QString *err = nullptr);
+    // ids of the test's questions in insertion order (without loading the questions)
+    bool loadQuestionIds(const QString &testId, QStringList *outIds, QString *err = nullptr);
+
+    // Outbound mail queue (see MailQueue). A result is queued at most once; the body
+    // of a sent mail is dropped, the row stays as the record of the delivery.
+    enum class MailStatus { Pending = 0, Sent = 1, Failed = 2 };
+    struct OutgoingMail {
+        qint64 id = 0;
+        qint64 resultId = 0; // 0 = not a result report
+        QString recipient;
+        QString subject;
+        QString body;
+        int attempts = 0;
+    };
+    // returns in *queued how many were new (results queued before are skipped)
+    bool enqueueMails(const QVector<OutgoingMail> &mails, int *queued = nullptr, QString *err = nullptr);
+    // pending mails with next attempt <= now (seconds since epoch), oldest first
+    bool loadDueMails(qint64 now, int limit, QVector<OutgoingMail> &outMails, QString *err = nullptr);
+    bool markMailSent(qint64 id, qint64 now, QString *err = nullptr);
+    // nextAttempt 0 = give up (status Failed)
+    bool markMailRetry(qint64 id, int attempts, qint64 nextAttempt, const QString &error, QString *err = nullptr);
+    bool mailQueueCounts(int *pending, int *failed, QString *err = nullptr);
 
     // Save test result (with details per question)
     struct ResultDetail {
@@ -34,12 +179,205 @@ public:
     };
     bool saveResult(const QString &studentEmail, const QString &testId, double score, int total,
                     const QVector<ResultDetail> &details, QString *err = nullptr);
+    // Several results in one transaction (group commit for the exam server)
+    struct ResultSubmission {
+        QString testId;
+        QString email;
+        double score = 0.0;
+        int total = 0;
+        QVector<ResultDetail> details;
+    };
+    bool saveResults(const QVector<ResultSubmission> &results, QString *err = nullptr);
+
+    // Results with their details, read page by page (keyset on results.id)
+    struct ResultFilter {
+        QString testId; // empty = all tests
+        QString from;   // ISO timestamp (inclusive), empty = unbounded
+        QString to;     // ISO timestamp (exclusive), empty = unbounded
+        QString studentEmail; // exact match ignoring case, empty = all students
+        bool includeArchived = false; // also read archived terms (cursor variant of loadResultsPage)
+    };
+    struct ResultRecord {
+        qint64 id = 0;
+        QString studentEmail;
+        QString testId;
+        double score = 0.0;
+        int total = 0;
+        QString timestamp;
+        QVector<ResultDetail> details;
+    };
+    bool loadResultsPage(const ResultFilter &filter, qint64 afterId, int limit,
+                         QVector<ResultRecord> &outResults, QString *err = nullptr);
+    // Same across the working DB and (with filter.includeArchived) the archives whose
+    // time range overlaps the filter; the cursor walks store by store, empty page = end
+    struct ResultCursor {
+        int store = 0; // 0 = working DB, then archives ordered by term
+        qint64 afterId = 0;
+    };
+    bool loadResultsPage(const ResultFilter &filter, ResultCursor *cursor, int limit,
+                         QVector<ResultRecord> &outResults, QString *err = nullptr);
+
+    // Results browser over the working DB (archives are only exported), newest first.
+    // Keyset pagination on (timestamp, id): each page continues strictly after *key,
+    // which is then moved to the last returned row; a default key starts at the newest.
+    struct ResultKey {
+        QString timestamp; // empty = first page
+        qint64 id = 0;
+    };
+    struct ResultRow {
+        qint64 id = 0;
+        QString studentEmail;
+        QString testId;
+        QString testName;
+        double score = 0.0;
+        int total = 0;
+        QString timestamp;
+    };
+    bool browseResults(const ResultFilter &filter, ResultKey *key, int limit,
+                       QVector<ResultRow> &outRows, QString *err = nullptr);
+    struct ResultDetailRow {
+        QString questionId;
+        QString questionText; // empty when the question was deleted meanwhile
+        bool correct = false;
+        QString userAnswer;
+    };
+    bool loadResultDetails(qint64 resultId, QVector<ResultDetailRow> &outDetails, QString *err = nullptr);
+
+    // Results archive: results older than a cutoff move into one archive DB per school
+    // term (<db dir>/archive/<db name>-results-<term>.db), term "2024-1" = Sep 2024 - Jan 2025,
+    // "2024-2" = Feb - Aug 2025. Archives are ATTACHed only while they are read.
+    struct ResultArchive {
+        QString term;
+        QString fileName; // relative to archiveDirectory()
+        qint64 count = 0;
+        QString minTimestamp;
+        QString maxTimestamp;
+    };
+    QString archiveDirectory() const;
+    bool resultArchives(QVector<ResultArchive> &outArchives, QString *err = nullptr);
+    bool archiveResults(const QString &cutoff, qint64 *movedResults = nullptr, QString *err = nullptr);
+
+    // Full-text search over question text, option texts and expected text (FTS5).
+    // Results are ordered by rank (best first); testId empty = search all tests.
+    struct SearchHit {
+        QString questionId;
+        QString testId;
+        QString testName;
+        QString snippet; // matched text with [ ] around the hits
+    };
+    bool searchQuestions(const QString &text, const QString &testId, int offset, int limit,
+                         QVector<SearchHit> &outHits, QString *err = nullptr);
+    bool hasSearchIndex() const { return mHasFts; }
+    // drop and refill the search index from questions/options
+    bool rebuildSearchIndex(QString *err = nullptr);
+
+    // Near-duplicate questions (MinHash signatures + LSH buckets, see SimilarityIndex).
+    // testId empty = whole database; threshold is the minimal estimated similarity (0..1).
+    struct DuplicateItem {
+        QString questionId;
+        QString testName;
+        QString text;
+    };
+    struct DuplicateGroup {
+        QVector<DuplicateItem> items;
+        double similarity = 1.0; // lowest verified similarity inside the group
+    };
+    bool findDuplicates(const QString &testId, double threshold, QVector<DuplicateGroup> &outGroups,
+                        QString *err = nullptr);
+    // drop and recompute all signatures (after a sync changed questions)
+    bool rebuildSimilarityIndex(QString *err = nullptr);
+
+    // Random id of this database copy; new results / result details get ids in
+    // [siteId << 32, (siteId + 1) << 32), so copies can be merged (ChangesetSync).
+    // The id is stored in the file together with the machine and path it was
+    // assigned for; a file copied from another database (a lab copy of the central
+    // one) keeps the original's id until assignNewSiteId() is called on it.
+    qint64 siteId() const { return mSiteId; }
+    bool isSiteCopy() const { return mSiteCopied; }
+    bool assignNewSiteId(QString *err = nullptr);
+
+    // Change notifications (published through DbChangeBus). Writes of this connection
+    // are collected per transaction and published after the outermost commit; changes of
+    // tests and questions are also logged in change_log, so other processes find them
+    // when PRAGMA data_version tells them that somebody else has committed.
+    struct Change {
+        enum Op { Insert, Update, Delete, Reset }; // Reset: anything in the table may have changed
+        QString table;  // "tests", "questions", "results"; "*" = whole database
+        QString key;    // id of the row (empty for Reset)
+        QString testId; // test the row belongs to (empty = unknown / all tests)
+        Op op = Update;
+    };
+    // changes committed by other connections since the last call (true without changes
+    // when nothing happened); a pruned log gap is reported as Reset of "*"
+    bool pollChanges(QVector<Change> &outChanges, QString *err = nullptr);
+
+    // Maintenance steps, each one bounded (driven by DbMaintenance when idle)
+    bool optimize(QString *err = nullptr); // PRAGMA optimize (refreshes planner stats that need it)
+    bool isIncrementalVacuum(QString *err = nullptr);
+    // one-time full VACUUM switching an old DB to auto_vacuum=INCREMENTAL; not bounded,
+    // so only on request (--vacuum), publishes a Reset of "*" (rowids may change)
+    bool convertToIncrementalVacuum(QString *err = nullptr);
+    // frees at most maxPages pages from the free list
+    bool incrementalVacuum(int maxPages, int *freedPages, int *remainingFreePages, QString *err = nullptr);
+    bool databaseSize(qint64 *pageCount, qint64 *pageSize, QString *err = nullptr);
+    QStringList tableNames(QString *err = nullptr);
+    // PRAGMA quick_check of one table; problems empty = table is fine
+    bool quickCheckTable(const QString &table, QStringList *problems, QString *err = nullptr);
 
 private:
     DBManager() = default;
     bool ensureSchema(QString *err = nullptr);
+    bool ensureSearchIndex(QString *err = nullptr);
+    bool updateSearchIndex(const Question &q, QString *err);
+    bool updateSimilarityIndex(const Question &q, QString *err);
+    bool backfillSimilarityIndex(QString *err);
+    bool ensureSiteId(QString *err);
+    bool writeSiteId(QString *err);
+    bool reserveSiteRowIds(const QString &table, qint64 count, qint64 *first, QString *err);
+    bool loadResultsPageFrom(const QString &schema, const ResultFilter &filter, qint64 afterId, int limit,
+                             QVector<ResultRecord> &outResults, QString *err);
+    bool attachArchive(const QString &fileName, QString *err);
+    void detachArchive();
+    bool ensureChangeLog(QString *err);
+    bool findTagPath(const QString &path, qint64 *tagId, QString *err);
+    bool tagPathOf(qint64 tagId, QString *path, QString *err);
+    // records a change of the running transaction (change_log only for tests / questions)
+    bool noteChange(const QString &table, const QString &key, const QString &testId, Change::Op op, QString *err);
 
     QSqlDatabase mDb;
+    bool mHasFts = false;
+    qint64 mSiteId = 0;
+    bool mSiteCopied = false;
+    QString mAttachedArchive; // file name of the archive attached as "archive"
+    int mTxDepth = 0;          // number of open DbTransaction scopes
+    QVector<Change> mPendingChanges; // written by the open transaction, published on commit
+    quint32 mChangeOrigin = 0;       // marks change_log rows of this connection
+    qint64 mLastChangeSeq = 0;       // last change_log row seen by pollChanges
+    qint64 mDataVersion = -1;
+};
+
+// Unit of work on the DBManager connection. The outermost scope begins a real
+// transaction, nested scopes (including the ones inside DBManager methods) become
+// SAVEPOINTs, so several calls can be committed or rolled back together.
+// Anything not committed is rolled back when the scope ends.
+class DbTransaction
+{
+public:
+    explicit DbTransaction(QString *err = nullptr);
+    ~DbTransaction();
+    DbTransaction(const DbTransaction &) = delete;
+    DbTransaction &operator=(const DbTransaction &) = delete;
+
+    bool isActive() const { return mActive; }
+    bool isNested() const { return mLevel > 0; }
+    bool commit(QString *err = nullptr);
+    void rollback();
+
+private:
+    DBManager &mDbm;
+    int mLevel = 0;
+    int mChangeMark = 0; // size of DBManager::mPendingChanges when the scope began
+    bool mActive = false;
 };
 
 #endif // DBMANAGER_H
@@ -0,0 +1,323 @@
+#include "examhostserver.h"
+#include "dbchangebus.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QDebug>
+
+static QJsonObject errorReply(const QString &msg)
+{
+    return QJsonObject{ {"ok", false}, {"error", msg} };
+}
+
+ExamHostServer::ExamHostServer(QObject *parent)
+    : QObject(parent), mLocalServer(new QLocalServer(this)), mTcpServer(new QTcpServer(this))
+{
+    connect(mLocalServer, &QLocalServer::newConnection, this, &ExamHostServer::onNewLocalConnection);
+    connect(mTcpServer, &QTcpServer::newConnection, this, &ExamHostServer::onNewTcpConnection);
+
+    // abandoned attempts are dropped, nothing was saved for them anyway
+    mExpireTimer.setInterval(60 * 1000);
+    connect(&mExpireTimer, &QTimer::timeout, this, [this]() {
+        int n = mSessions.expireIdle(IdleTimeoutMs);
+        if (n > 0) qDebug() << "Exam host: expired" << n << "idle sessions";
+    });
+    mExpireTimer.start();
+
+    connect(&DbChangeBus::instance(), &DbChangeBus::changed, this, &ExamHostServer::onDatabaseChanged);
+}
+
+ExamHostServer::~ExamHostServer()
+{
+    // workers capture this; their queued completions die with the object
+    mWorkers.waitForDone();
+}
+
+bool ExamHostServer::listen(const QString &name, QString *err)
+{
+    QLocalServer::removeServer(name); // stale socket after a crash
+    if (!mLocalServer->listen(name)) {
+        if (err) *err = mLocalServer->errorString();
+        return false;
+    }
+    return true;
+}
+
+bool ExamHostServer::listenTcp(const QHostAddress &address, quint16 port, QString *err)
+{
+    if (!mTcpServer->listen(address, port)) {
+        if (err) *err = mTcpServer->errorString();
+        return false;
+    }
+    return true;
+}
+
+void ExamHostServer::onNewLocalConnection()
+{
+    while (QLocalSocket *sock = mLocalServer->nextPendingConnection()) {
+        sock->setReadBufferSize(MaxLineLength);
+        connect(sock, &QLocalSocket::disconnected, this, [this, sock]() {
+            mBusy.remove(sock);
+            sock->deleteLater();
+        });
+        addConnection(sock);
+    }
+}
+
+void ExamHostServer::onNewTcpConnection()
+{
+    while (QTcpSocket *sock = mTcpServer->nextPendingConnection()) {
+        // bounded read buffer: a stalled connection pushes back through the TCP window
+        sock->setReadBufferSize(MaxLineLength);
+        sock->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        connect(sock, &QTcpSocket::disconnected, this, [this, sock]() {
+            mBusy.remove(sock);
+            sock->deleteLater();
+        });
+        addConnection(sock);
+    }
+}
+
+void ExamHostServer::addConnection(QIODevice *dev)
+{
+    mBusy.insert(dev, false);
+    connect(dev, &QIODevice::readyRead, this, [this, dev]() { processNext(dev); });
+    connect(dev, &QIODevice::bytesWritten, this, [this, dev]() { processNext(dev); });
+}
+
+/* dispatch the next complete request line of dev, if limits allow */
+void ExamHostServer::processNext(QIODevice *dev)
+{
+    auto it = mBusy.find(dev);
+    if (it == mBusy.end() || it.value()) return;
+    if (dev->bytesToWrite() > MaxPendingOutput) return; // client does not read replies
+
+    while (dev->canReadLine()) {
+        if (mInFlight >= MaxInFlight) {
+            if (!mWaiting.contains(dev)) mWaiting.append(dev);
+            return;
+        }
+        const QByteArray line = dev->readLine(MaxLineLength).trimmed();
+        if (line.isEmpty()) continue;
+
+        QJsonParseError pe;
+        const QJsonDocument doc = QJsonDocument::fromJson(line, &pe);
+        if (!doc.isObject()) {
+            sendReply(dev, errorReply("Invalid request: " + pe.errorString()));
+            continue;
+        }
+        const QJsonObject req = doc.object();
+        QString err;
+        // banks are loaded here on the DB thread, workers only read them
+        if (req.value("cmd").toString() == "start" && !ensureBank(req.value("test").toString(), &err)) {
+            sendReply(dev, errorReply(err));
+            continue;
+        }
+
+        it.value() = true;
+        ++mInFlight;
+        QPointer<QIODevice> guard(dev);
+        mWorkers.start([this, guard, req]() {
+            Outcome o = handle(req);
+            QMetaObject::invokeMethod(this, [this, guard, o]() { completeRequest(guard, o); }, Qt::QueuedConnection);
+        });
+        return;
+    }
+    if (dev->bytesAvailable() >= MaxLineLength) {
+        qDebug() << "Exam host: request too long, closing connection";
+        dev->close();
+    }
+}
+
+void ExamHostServer::completeRequest(const QPointer<QIODevice> &dev, const Outcome &o)
+{
+    if (o.save) {
+        PendingSave ps;
+        ps.device = dev;
+        ps.sessionId = o.sessionId;
+        ps.result = o.result;
+        if (mSaveQueue.isEmpty()) QTimer::singleShot(0, this, &ExamHostServer::flushSaves);
+        mSaveQueue.append(ps);
+        return;
+    }
+    if (dev) sendReply(dev, o.reply);
+    finishRequest(dev);
+}
+
+void ExamHostServer::finishRequest(QIODevice *dev)
+{
+    --mInFlight;
+    if (dev) {
+        auto it = mBusy.find(dev);
+        if (it != mBusy.end()) it.value() = false;
+        processNext(dev);
+    }
+    // wake connections that were stalled by the global limit
+    while (mInFlight < MaxInFlight && !mWaiting.isEmpty()) {
+        QPointer<QIODevice> w = mWaiting.takeFirst();
+        if (w) processNext(w);
+    }
+}
+
+/* group commit of graded submissions */
+void ExamHostServer::flushSaves()
+{
+    while (!mSaveQueue.isEmpty()) {
+        const int n = qMin(int(mSaveQueue.size()), int(MaxSaveBatch));
+        const QVector<PendingSave> batch = mSaveQueue.mid(0, n);
+        mSaveQueue.remove(0, n);
+
+        QVector<DBManager::ResultSubmission> results;
+        results.reserve(n);
+        for (const PendingSave &ps : batch) results.append(ps.result);
+        QString err;
+        const bool ok = DBManager::instance().saveResults(results, &err);
+        if (!ok) qDebug() << "Exam host: saving" << n << "results failed:" << err;
+        else emit resultsSaved(n);
+
+        for (const PendingSave &ps : batch) {
+            // on failure the session stays open, the client may submit again
+            if (ok) mSessions.endSession(ps.sessionId);
+            if (ps.device) {
+                sendReply(ps.device, ok ? QJsonObject{ {"ok", true}, {"score", ps.result.score}, {"total", ps.result.total} }
+                                        : errorReply(err));
+            }
+            finishRequest(ps.device);
+        }
+    }
+}
+
+void ExamHostServer::sendReply(QIODevice *dev, const QJsonObject &reply)
+{
+    QByteArray out = QJsonDocument(reply).toJson(QJsonDocument::Compact);
+    out += '\n';
+    dev->write(out);
+}
+
+bool ExamHostServer::ensureBank(const QString &testId, QString *err)
+{
+    if (mSessions.hasBank(testId)) return true;
+    ExamSessionManager::QuestionBank b;
+    if (!loadBank(testId, &b, err)) return false;
+    mSessions.registerBank(b.test, std::move(b.questions), std::move(b.strata), std::move(b.templates));
+    return true;
+}
+
+bool ExamHostServer::loadBank(const QString &testId, ExamSessionManager::QuestionBank *out, QString *err)
+{
+    Test t;
+    bool found = false;
+    if (!DBManager::instance().loadTest(testId, &t, &found, err)) return false;
+    if (!found) {
+        if (err) *err = "Unknown test: " + testId;
+        return false;
+    }
+    QVector<Question> questions;
+    if (!DBManager::instance().loadQuestionsForTest(testId, questions, err)) return false;
+    QVector<DBManager::BlueprintStratum> rules;
+    if (!DBManager::instance().loadBlueprintStrata(testId, rules, err)) return false;
+    QHash<QString, quint32> indexOf;
+    for (int i = 0; i < questions.size(); ++i) indexOf.insert(questions[i].id, quint32(i));
+    QVector<ExamSessionManager::Stratum> strata;
+    for (const DBManager::BlueprintStratum &r : std::as_const(rules)) {
+        ExamSessionManager::Stratum st;
+        st.count = r.count;
+        for (const QString &id : r.questionIds) {
+            auto it = indexOf.constFind(id);
+            if (it != indexOf.constEnd()) st.candidates.append(it.value());
+        }
+        strata.append(std::move(st));
+    }
+    QStringList ids;
+    for (const Question &q : std::as_const(questions)) ids.append(q.id);
+    QHash<QString, QString> definitions;
+    if (!DBManager::instance().loadQuestionTemplates(ids, &definitions, err)) return false;
+    // compiled once per bank, instantiated per session
+    QHash<quint32, QuestionTemplate> templates;
+    for (auto it = definitions.constBegin(); it != definitions.constEnd(); ++it) {
+        QuestionTemplate tpl;
+        QString terr;
+        if (!tpl.compile(it.value(), &terr)) {
+            qDebug() << "Question template" << it.key() << "not usable:" << terr;
+            continue;
+        }
+        templates.insert(indexOf.value(it.key()), tpl);
+    }
+    out->test = t;
+    out->questions = std::move(questions);
+    out->strata = std::move(strata);
+    out->templates = std::move(templates);
+    return true;
+}
+
+void ExamHostServer::onDatabaseChanged(const QVector<DBManager::Change> &changes)
+{
+    for (const DBManager::Change &c : changes) {
+        if (c.table == "results") continue;
+        if (c.table == "*" || c.testId.isEmpty()) {
+            mSessions.dropAllBanks();
+            return;
+        }
+        mSessions.dropBank(c.testId);
+    }
+}
+
+ExamHostServer::Outcome ExamHostServer::handle(const QJsonObject &req)
+{
+    Outcome o;
+    const QString cmd = req.value("cmd").toString();
+    QString err;
+
+    if (cmd == "stats") {
+        o.reply = QJsonObject{ {"ok", true}, {"sessions", mSessions.sessionCount()},
+                               {"banks", mSessions.bankCount()} };
+        return o;
+    }
+    if (cmd == "start") {
+        int count = 0;
+        const quint64 id = mSessions.startSession(req.value("test").toString(),
+                                                  req.value("email").toString().trimmed(), &count, &err);
+        o.reply = id == 0 ? errorReply(err)
+                          : QJsonObject{ {"ok", true}, {"session", QString::number(id, 16)}, {"count", count} };
+        return o;
+    }
+
+    bool okId = false;
+    const quint64 id = req.value("session").toString().toULongLong(&okId, 16);
+    if (!okId || id == 0) {
+        o.reply = errorReply("Missing session");
+        return o;
+    }
+
+    if (cmd == "question") {
+        ExamSessionManager::QuestionView v;
+        if (!mSessions.question(id, req.value("index").toInt(-1), &v, &err)) {
+            o.reply = errorReply(err);
+            return o;
+        }
+        QJsonArray options;
+        for (int oi : std::as_const(v.optionOrder)) options.append(v.question.options[oi].text);
+        o.reply = QJsonObject{ {"ok", true}, {"index", v.index}, {"count", v.count},
+                               {"type", int(v.question.type)}, {"text", v.question.text},
+                               {"options", options}, {"answer", v.answer} };
+    } else if (cmd == "answer") {
+        o.reply = mSessions.setAnswer(id, req.value("index").toInt(-1), req.value("answer").toString(), &err)
+                      ? QJsonObject{ {"ok", true} } : errorReply(err);
+    } else if (cmd == "submit") {
+        if (mSessions.gradeSession(id, &o.result, &err)) {
+            o.save = true;
+            o.sessionId = id;
+        } else {
+            o.reply = errorReply(err);
+        }
+    } else if (cmd == "end") {
+        mSessions.endSession(id);
+        o.reply = QJsonObject{ {"ok", true} };
+    } else {
+        o.reply = errorReply("Unknown command: " + cmd);
+    }
+    return o;
+}
@@ -0,0 +1,98 @@
+#ifndef EXAMHOSTSERVER_H
+#define EXAMHOSTSERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <QPointer>
+#include <QThreadPool>
+#include <QJsonObject>
+#include <QHostAddress>
+#include "examsessionmanager.h"
+
+class QLocalServer;
+class QTcpServer;
+class QIODevice;
+
+// Local socket / TCP front end of ExamSessionManager for thin clients and labs.
+// Protocol: one compact JSON object per line in both directions.
+//   {"cmd":"start","test":id,"email":e}           -> {"ok":true,"session":hex,"count":n}
+//   {"cmd":"question","session":hex,"index":i}     -> {"ok":true,"index":i,"count":n,"type":t,
+//                                                      "text":..,"options":[..],"answer":..}
+//   {"cmd":"answer","session":hex,"index":i,"answer":a} -> {"ok":true}
+//   {"cmd":"submit","session":hex}                 -> {"ok":true,"score":s,"total":n}
+//   {"cmd":"end","session":hex}                    -> {"ok":true}
+//   {"cmd":"stats"}                                -> {"ok":true,"sessions":n,"banks":m}
+// Failures answer {"ok":false,"error":msg}. Options are sent already shuffled,
+// answers use the stored string form (see Grading).
+//
+// The server object lives on the DB thread. Requests run on a bounded worker
+// pool; a connection has at most one request in flight (replies keep request
+// order) and at most MaxInFlight requests run in total. Above that limit, or
+// when a client does not read its replies, the server stops reading from the
+// socket, so clients are slowed down by the transport instead of queueing
+// without bound. Submissions are graded on the workers and saved on the DB
+// thread in group commits of up to MaxSaveBatch results.
+class ExamHostServer : public QObject
+{
+    Q_OBJECT
+public:
+    static const int MaxLineLength = 64 * 1024;
+    static const int MaxPendingOutput = 256 * 1024;
+    static const int MaxInFlight = 256;
+    static const int MaxSaveBatch = 64;
+    static const int IdleTimeoutMs = 2 * 60 * 60 * 1000;
+
+    explicit ExamHostServer(QObject *parent = nullptr);
+    ~ExamHostServer() override;
+
+    bool listen(const QString &name, QString *err = nullptr);
+    bool listenTcp(const QHostAddress &address, quint16 port, QString *err = nullptr);
+    void setWorkerCount(int n) { mWorkers.setMaxThreadCount(qMax(1, n)); }
+    ExamSessionManager &sessions() { return mSessions; }
+    // test, questions, blueprint strata and compiled templates from the DB (DB thread only)
+    static bool loadBank(const QString &testId, ExamSessionManager::QuestionBank *out, QString *err = nullptr);
+
+signals:
+    void resultsSaved(int count); // DB write activity (maintenance waits for idle)
+
+private slots:
+    void onNewLocalConnection();
+    void onNewTcpConnection();
+    void flushSaves();
+    // edited tests are reloaded by the next start (running attempts keep their bank)
+    void onDatabaseChanged(const QVector<DBManager::Change> &changes);
+
+private:
+    struct Outcome {
+        QJsonObject reply;
+        bool save = false; // reply only after the result is stored
+        quint64 sessionId = 0;
+        ExamSessionManager::FinishedAttempt result;
+    };
+    struct PendingSave {
+        QPointer<QIODevice> device;
+        quint64 sessionId = 0;
+        ExamSessionManager::FinishedAttempt result;
+    };
+
+    void addConnection(QIODevice *dev);
+    void processNext(QIODevice *dev);
+    void completeRequest(const QPointer<QIODevice> &dev, const Outcome &o);
+    void finishRequest(QIODevice *dev);
+    void sendReply(QIODevice *dev, const QJsonObject &reply);
+    Outcome handle(const QJsonObject &req); // runs on a worker thread
+    bool ensureBank(const QString &testId, QString *err);
+
+    QLocalServer *mLocalServer;
+    QTcpServer *mTcpServer;
+    QHash<QIODevice*, bool> mBusy; // connection -> request in flight
+    QList<QPointer<QIODevice>> mWaiting; // stalled by MaxInFlight
+    int mInFlight = 0;
+    QVector<PendingSave> mSaveQueue;
+    ExamSessionManager mSessions;
+    QTimer mExpireTimer;
+    QThreadPool mWorkers;
+};
+
+#endif // EXAMHOSTSERVER_H
@@ -0,0 +1,281 @@
+#include "exampackage.h"
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QHash>
+#include <QtEndian>
+#include <cstring>
+
+static_assert(Q_BYTE_ORDER == Q_LITTLE_ENDIAN, "exam packages are read in place and stored little endian");
+
+struct ExamPackage::Header {
+    char magic[8];
+    quint32 formatVersion;
+    quint32 headerSize;
+    quint64 packageVersion;
+    quint32 questionCount;
+    quint32 optionCount;
+    qint32 studentCount;
+    quint32 reserved;
+    quint64 questionsOffset;
+    quint64 optionsOffset;
+    quint64 stringsOffset;
+    quint64 stringsUnits; // pool size in UTF-16 code units
+    StrRef testId;
+    StrRef testName;
+    StrRef testDescription;
+    quint32 reserved2[2];
+    quint8 sha256[32];
+};
+
+struct ExamPackage::QuestionRecord {
+    StrRef id;
+    StrRef text;
+    StrRef expectedText;
+    quint32 type;
+    quint32 firstOption;
+    quint32 optionCount;
+    quint32 flags; // QuestionNumericKey (format version 2)
+};
+
+struct ExamPackage::OptionRecord {
+    StrRef text;
+    quint32 correct;
+    quint32 reserved;
+};
+
+static const quint32 QuestionNumericKey = 1;
+
+static const char PackageMagic[8] = { 'Q', 'T', 'M', 'E', 'X', 'A', 'M', '1' };
+
+static quint64 align8(quint64 v) { return (v + 7) & ~quint64(7); }
+
+ExamPackage::~ExamPackage()
+{
+    close();
+}
+
+bool ExamPackage::write(const QString &path, const Test &t, const QVector<Question> &qs, QString *err)
+{
+    static_assert(sizeof(Header) == 136, "unexpected padding in package header");
+    static_assert(sizeof(QuestionRecord) == 40, "unexpected padding in question record");
+    static_assert(sizeof(OptionRecord) == 16, "unexpected padding in option record");
+
+    // string pool with deduplication (option texts repeat a lot)
+    QString pool;
+    QHash<QString, StrRef> known;
+    auto addString = [&](const QString &s) -> StrRef {
+        auto it = known.constFind(s);
+        if (it != known.constEnd()) return it.value();
+        StrRef r { quint32(pool.size()), quint32(s.size()) };
+        pool += s;
+        known.insert(s, r);
+        return r;
+    };
+
+    Header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, PackageMagic, sizeof(h.magic));
+    h.formatVersion = FormatVersion;
+    h.headerSize = sizeof(Header);
+    h.packageVersion = quint64(QDateTime::currentMSecsSinceEpoch());
+    h.studentCount = t.studentCount;
+    h.testId = addString(t.id);
+    h.testName = addString(t.name);
+    h.testDescription = addString(t.description);
+
+    QVector<QuestionRecord> questions;
+    QVector<OptionRecord> options;
+    questions.reserve(qs.size());
+    for (const Question &q : qs) {
+        QuestionRecord qr;
+        std::memset(&qr, 0, sizeof(qr));
+        qr.id = addString(q.id);
+        qr.text = addString(q.text);
+        qr.expectedText = addString(q.expectedText);
+        qr.type = quint32(q.type);
+        qr.flags = q.numericKey ? QuestionNumericKey : 0;
+        qr.firstOption = quint32(options.size());
+        qr.optionCount = quint32(q.options.size());
+        for (const Answer &a : q.options) {
+            OptionRecord orec;
+            std::memset(&orec, 0, sizeof(orec));
+            orec.text = addString(a.text);
+            orec.correct = a.correct ? 1 : 0;
+            options.append(orec);
+        }
+        questions.append(qr);
+    }
+    h.questionCount = quint32(questions.size());
+    h.optionCount = quint32(options.size());
+    h.questionsOffset = align8(sizeof(Header));
+    h.optionsOffset = align8(h.questionsOffset + quint64(questions.size()) * sizeof(QuestionRecord));
+    h.stringsOffset = align8(h.optionsOffset + quint64(options.size()) * sizeof(OptionRecord));
+    h.stringsUnits = quint64(pool.size());
+
+    QByteArray body(int(h.stringsOffset - sizeof(Header)) + pool.size() * 2, '\0');
+    // offsets are from file start, body starts right after the header
+    char *body0 = body.data();
+    if (!questions.isEmpty())
+        std::memcpy(body0 + (h.questionsOffset - sizeof(Header)), questions.constData(), questions.size() * sizeof(QuestionRecord));
+    if (!options.isEmpty())
+        std::memcpy(body0 + (h.optionsOffset - sizeof(Header)), options.constData(), options.size() * sizeof(OptionRecord));
+    if (!pool.isEmpty())
+        std::memcpy(body0 + (h.stringsOffset - sizeof(Header)), pool.constData(), pool.size() * 2);
+
+    const QByteArray digest = QCryptographicHash::hash(body, QCryptographicHash::Sha256);
+    std::memcpy(h.sha256, digest.constData(), sizeof(h.sha256));
+
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        if (err) *err = out.errorString();
+        return false;
+    }
+    if (out.write(reinterpret_cast<const char*>(&h), sizeof(h)) != qint64(sizeof(h))
+        || out.write(body) != body.size() || !out.commit()) {
+        if (err) *err = out.errorString();
+        out.cancelWriting();
+        return false;
+    }
+    return true;
+}
+
+bool ExamPackage::open(const QString &path, QString *err)
+{
+    close();
+    auto fail = [&](const QString &msg) {
+        if (err) *err = msg;
+        close();
+        return false;
+    };
+
+    mFile.setFileName(path);
+    if (!mFile.open(QIODevice::ReadOnly)) return fail(mFile.errorString());
+    mSize = mFile.size();
+    if (mSize < qint64(sizeof(Header))) return fail("Soubor není balíček testu (příliš krátký).");
+    mData = mFile.map(0, mSize);
+    if (!mData) return fail(mFile.errorString());
+
+    const Header *h = header();
+    if (std::memcmp(h->magic, PackageMagic, sizeof(PackageMagic)) != 0)
+        return fail("Soubor není balíček testu.");
+    // version 1 differs only in the question flags, which it leaves 0
+    if ((h->formatVersion != FormatVersion && h->formatVersion != 1) || h->headerSize != sizeof(Header))
+        return fail(QString("Nepodporovaná verze balíčku (%1).").arg(h->formatVersion));
+
+    // all sections inside the file, in order; offsets are compared with the size before
+    // anything is added to or subtracted from them, so crafted values cannot wrap around
+    const quint64 size = quint64(mSize);
+    auto sectionOk = [size](quint64 offset, quint64 count, quint64 recordSize, quint64 end) {
+        return offset % 8 == 0 && offset <= end && end <= size && count <= (end - offset) / recordSize;
+    };
+    if (h->questionsOffset < sizeof(Header)
+        || !sectionOk(h->questionsOffset, h->questionCount, sizeof(QuestionRecord), h->optionsOffset)
+        || !sectionOk(h->optionsOffset, h->optionCount, sizeof(OptionRecord), h->stringsOffset)
+        || h->stringsOffset % 8 || h->stringsUnits > size || h->stringsUnits * 2 != size - h->stringsOffset)
+        return fail("Poškozený balíček testu (rozsahy sekcí).");
+
+    const QByteArray digest = QCryptographicHash::hash(
+        QByteArray::fromRawData(reinterpret_cast<const char*>(mData) + sizeof(Header), mSize - qint64(sizeof(Header))),
+        QCryptographicHash::Sha256);
+    if (std::memcmp(digest.constData(), h->sha256, sizeof(h->sha256)) != 0)
+        return fail("Poškozený balíček testu (kontrolní součet nesouhlasí).");
+
+    // string references and option ranges
+    auto strOk = [h](StrRef r) { return quint64(r.offset) + r.length <= h->stringsUnits; };
+    if (!strOk(h->testId) || !strOk(h->testName) || !strOk(h->testDescription))
+        return fail("Poškozený balíček testu (řetězce).");
+    const QuestionRecord *qr = questionRecords();
+    for (quint32 i = 0; i < h->questionCount; ++i) {
+        if (!strOk(qr[i].id) || !strOk(qr[i].text) || !strOk(qr[i].expectedText) || qr[i].type > 2
+            || quint64(qr[i].firstOption) + qr[i].optionCount > h->optionCount)
+            return fail("Poškozený balíček testu (otázky).");
+    }
+    const OptionRecord *orec = optionRecords();
+    for (quint32 i = 0; i < h->optionCount; ++i) {
+        if (!strOk(orec[i].text)) return fail("Poškozený balíček testu (možnosti).");
+    }
+    return true;
+}
+
+void ExamPackage::close()
+{
+    if (mData) mFile.unmap(const_cast<uchar*>(mData));
+    mData = nullptr;
+    mSize = 0;
+    if (mFile.isOpen()) mFile.close();
+}
+
+const ExamPackage::Header *ExamPackage::header() const
+{
+    return reinterpret_cast<const Header*>(mData);
+}
+
+const ExamPackage::QuestionRecord *ExamPackage::questionRecords() const
+{
+    return reinterpret_cast<const QuestionRecord*>(mData + header()->questionsOffset);
+}
+
+const ExamPackage::OptionRecord *ExamPackage::optionRecords() const
+{
+    return reinterpret_cast<const OptionRecord*>(mData + header()->optionsOffset);
+}
+
+QString ExamPackage::str(StrRef r) const
+{
+    const QChar *pool = reinterpret_cast<const QChar*>(mData + header()->stringsOffset);
+    return QString::fromRawData(pool + r.offset, r.length);
+}
+
+quint64 ExamPackage::packageVersion() const
+{
+    return mData ? header()->packageVersion : 0;
+}
+
+Test ExamPackage::test() const
+{
+    Test t;
+    if (!mData) return t;
+    const Header *h = header();
+    t.id = str(h->testId);
+    t.name = str(h->testName);
+    t.description = str(h->testDescription);
+    t.studentCount = h->studentCount;
+    return t;
+}
+
+int ExamPackage::questionCount() const
+{
+    return mData ? int(header()->questionCount) : 0;
+}
+
+Question ExamPackage::question(int index) const
+{
+    Question q;
+    if (index < 0 || index >= questionCount()) return q;
+    const QuestionRecord &qr = questionRecords()[index];
+    q.id = str(qr.id);
+    q.testId = str(header()->testId);
+    q.text = str(qr.text);
+    q.type = static_cast<QuestionType>(qr.type);
+    q.expectedText = str(qr.expectedText);
+    q.numericKey = (qr.flags & QuestionNumericKey) != 0;
+    q.options.reserve(qr.optionCount);
+    const OptionRecord *orec = optionRecords() + qr.firstOption;
+    for (quint32 i = 0; i < qr.optionCount; ++i) {
+        Answer a;
+        a.text = str(orec[i].text);
+        a.correct = orec[i].correct != 0;
+        q.options.append(a);
+    }
+    return q;
+}
+
+QVector<Question> ExamPackage::questions() const
+{
+    QVector<Question> out;
+    const int n = questionCount();
+    out.reserve(n);
+    for (int i = 0; i < n; ++i) out.append(question(i));
+    return out;
+}
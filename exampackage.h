@@ -0,0 +1,61 @@
+#ifndef EXAMPACKAGE_H
+#define EXAMPACKAGE_H
+
+#include <QString>
+#include <QVector>
+#include <QFile>
+#include "models.h"
+
+// Immutable, self-contained exam file for student kiosks (*.qtp).
+// One test with all its questions; memory mapped read-only and used without
+// copying: every QString handed out is a QString::fromRawData view into the
+// mapping, so the package must stay open while the questions are in use.
+//
+// Layout (little endian, sections 8-byte aligned):
+//   Header          magic "QTMEXAM1", format version, package version (creation
+//                   time in ms), counts, section offsets, test strings, SHA-256
+//                   of everything after the header
+//   QuestionRecord  [questionCount]
+//   OptionRecord    [optionCount]
+//   string pool     UTF-16 code units, referenced by (offset, length) in code units
+class ExamPackage
+{
+public:
+    static const quint32 FormatVersion = 2; // 2: question flags (numeric template keys)
+
+    ExamPackage() = default;
+    ~ExamPackage();
+    ExamPackage(const ExamPackage &) = delete;
+    ExamPackage &operator=(const ExamPackage &) = delete;
+
+    // write package of test t with questions qs
+    static bool write(const QString &path, const Test &t, const QVector<Question> &qs, QString *err = nullptr);
+
+    // map and validate (magic, version, bounds, checksum)
+    bool open(const QString &path, QString *err = nullptr);
+    void close();
+    bool isOpen() const { return mData != nullptr; }
+
+    quint64 packageVersion() const;
+    Test test() const;
+    int questionCount() const;
+    Question question(int index) const;
+    QVector<Question> questions() const;
+
+private:
+    struct StrRef { quint32 offset; quint32 length; };
+    struct Header;
+    struct QuestionRecord;
+    struct OptionRecord;
+
+    QString str(StrRef r) const;
+    const Header *header() const;
+    const QuestionRecord *questionRecords() const;
+    const OptionRecord *optionRecords() const;
+
+    QFile mFile;
+    const uchar *mData = nullptr;
+    qint64 mSize = 0;
+};
+
+#endif // EXAMPACKAGE_H
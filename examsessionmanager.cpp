@@ -0,0 +1,240 @@
+#include "examsessionmanager.h"
+#include "grading.h"
+#include <QDateTime>
+#include <QRandomGenerator>
+#include <algorithm>
+
+void ExamSessionManager::registerBank(const Test &test, QVector<Question> questions, QVector<Stratum> strata,
+                                      QHash<quint32, QuestionTemplate> templates)
+{
+    auto b = std::make_shared<QuestionBank>();
+    b->test = test;
+    b->questions = std::move(questions);
+    b->strata = std::move(strata);
+    b->templates = std::move(templates);
+    QWriteLocker lock(&mBanksLock);
+    mBanks.insert(test.id, std::move(b));
+}
+
+bool ExamSessionManager::hasBank(const QString &testId) const
+{
+    QReadLocker lock(&mBanksLock);
+    return mBanks.contains(testId);
+}
+
+void ExamSessionManager::dropBank(const QString &testId)
+{
+    QWriteLocker lock(&mBanksLock);
+    mBanks.remove(testId);
+}
+
+void ExamSessionManager::dropAllBanks()
+{
+    QWriteLocker lock(&mBanksLock);
+    mBanks.clear();
+}
+
+int ExamSessionManager::bankCount() const
+{
+    QReadLocker lock(&mBanksLock);
+    return mBanks.size();
+}
+
+std::shared_ptr<const ExamSessionManager::QuestionBank> ExamSessionManager::bank(const QString &testId) const
+{
+    QReadLocker lock(&mBanksLock);
+    return mBanks.value(testId);
+}
+
+QVector<int> ExamSessionManager::optionOrder(quint32 seed, int index, int optionCount)
+{
+    QVector<int> order(optionCount);
+    for (int i = 0; i < optionCount; ++i) order[i] = i;
+    QRandomGenerator rng(seed ^ (quint32(index) * 0x9E3779B9u));
+    std::shuffle(order.begin(), order.end(), rng);
+    return order;
+}
+
+Question ExamSessionManager::presented(const QuestionBank &b, quint32 index, quint32 seed)
+{
+    const Question &q = b.questions[index];
+    auto it = b.templates.constFind(index);
+    if (it == b.templates.constEnd()) return q; // implicitly shared, no deep copy
+    Question out;
+    if (!it->instantiate(q, QuestionTemplate::seedFor(seed, q.id), &out)) return q;
+    return out;
+}
+
+quint64 ExamSessionManager::startSession(const QString &testId, const QString &email, int *questionCount, QString *err)
+{
+    std::shared_ptr<const QuestionBank> b = bank(testId);
+    if (!b) {
+        if (err) *err = "Unknown test: " + testId;
+        return 0;
+    }
+    if (b->questions.isEmpty()) {
+        if (err) *err = "Test has no questions";
+        return 0;
+    }
+
+    Session s;
+    QRandomGenerator *rng = QRandomGenerator::global();
+    s.drawn = drawQuestions(*b, *rng);
+    const int n = s.drawn.size();
+    s.answers.resize(n);
+    s.email = email;
+    s.seed = rng->generate();
+    s.lastActivity = QDateTime::currentMSecsSinceEpoch();
+    s.bank = std::move(b);
+    if (questionCount) *questionCount = n;
+
+    for (;;) {
+        const quint64 id = rng->generate64();
+        if (id == 0) continue;
+        Shard &shard = shardFor(id);
+        QMutexLocker lock(&shard.mutex);
+        if (shard.sessions.contains(id)) continue;
+        shard.sessions.insert(id, std::move(s));
+        return id;
+    }
+}
+
+QVector<quint32> ExamSessionManager::drawQuestions(const QuestionBank &b, QRandomGenerator &rng)
+{
+    const int total = b.questions.size();
+    const int n = qBound(1, b.test.studentCount, total);
+    QVector<quint32> drawn;
+    drawn.reserve(n);
+    QVector<bool> taken(total, false);
+    // partial Fisher-Yates over the not yet taken part of pool: only k positions are drawn
+    auto draw = [&](QVector<quint32> pool, int k) {
+        int avail = 0;
+        for (quint32 i : std::as_const(pool)) {
+            if (i < quint32(total) && !taken[i]) pool[avail++] = i;
+        }
+        k = qMin(k, avail);
+        for (int i = 0; i < k; ++i) {
+            std::swap(pool[i], pool[i + int(rng.bounded(avail - i))]);
+            taken[pool[i]] = true;
+            drawn.append(pool[i]);
+        }
+    };
+    for (const Stratum &st : b.strata) {
+        if (drawn.size() >= n) break;
+        draw(st.candidates, qMin(st.count, n - int(drawn.size())));
+    }
+    if (drawn.size() < n) {
+        QVector<quint32> all(total);
+        for (int i = 0; i < total; ++i) all[i] = quint32(i);
+        draw(std::move(all), n - int(drawn.size()));
+    }
+    // strata must not come in blocks
+    if (!b.strata.isEmpty()) std::shuffle(drawn.begin(), drawn.end(), rng);
+    return drawn;
+}
+
+bool ExamSessionManager::question(quint64 sessionId, int index, QuestionView *out, QString *err)
+{
+    Shard &shard = shardFor(sessionId);
+    QMutexLocker lock(&shard.mutex);
+    auto it = shard.sessions.find(sessionId);
+    if (it == shard.sessions.end()) {
+        if (err) *err = "Unknown session";
+        return false;
+    }
+    Session &s = it.value();
+    if (index < 0 || index >= s.drawn.size()) {
+        if (err) *err = "Question index out of range";
+        return false;
+    }
+    out->index = index;
+    out->count = s.drawn.size();
+    out->answer = s.answers[index];
+    s.lastActivity = QDateTime::currentMSecsSinceEpoch();
+    const quint32 seed = s.seed;
+    const quint32 drawnIndex = s.drawn[index];
+    const std::shared_ptr<const QuestionBank> bank = s.bank;
+    lock.unlock();
+    out->question = presented(*bank, drawnIndex, seed);
+    out->optionOrder = out->question.type == QuestionType::TextAnswer
+                           ? QVector<int>() : optionOrder(seed, index, out->question.options.size());
+    return true;
+}
+
+bool ExamSessionManager::setAnswer(quint64 sessionId, int index, const QString &answer, QString *err)
+{
+    Shard &shard = shardFor(sessionId);
+    QMutexLocker lock(&shard.mutex);
+    auto it = shard.sessions.find(sessionId);
+    if (it == shard.sessions.end()) {
+        if (err) *err = "Unknown session";
+        return false;
+    }
+    if (index < 0 || index >= it->drawn.size()) {
+        if (err) *err = "Question index out of range";
+        return false;
+    }
+    it->answers[index] = answer;
+    it->lastActivity = QDateTime::currentMSecsSinceEpoch();
+    return true;
+}
+
+bool ExamSessionManager::gradeSession(quint64 sessionId, FinishedAttempt *out, QString *err)
+{
+    Session s;
+    {
+        Shard &shard = shardFor(sessionId);
+        QMutexLocker lock(&shard.mutex);
+        auto it = shard.sessions.constFind(sessionId);
+        if (it == shard.sessions.constEnd()) {
+            if (err) *err = "Unknown session";
+            return false;
+        }
+        s = it.value(); // implicitly shared members, cheap
+    }
+    // grading runs outside of the shard lock
+    QVector<Question> drawn;
+    drawn.reserve(s.drawn.size());
+    // parametric questions: the key is recomputed from the session seed
+    for (quint32 i : std::as_const(s.drawn)) drawn.append(presented(*s.bank, i, s.seed));
+    out->testId = s.bank->test.id;
+    out->email = s.email;
+    out->total = drawn.size();
+    out->score = Grading::gradeAttempt(drawn, s.answers, &out->details);
+    return true;
+}
+
+void ExamSessionManager::endSession(quint64 sessionId)
+{
+    Shard &shard = shardFor(sessionId);
+    QMutexLocker lock(&shard.mutex);
+    shard.sessions.remove(sessionId);
+}
+
+int ExamSessionManager::expireIdle(qint64 maxIdleMs)
+{
+    const qint64 limit = QDateTime::currentMSecsSinceEpoch() - maxIdleMs;
+    int removed = 0;
+    for (Shard &shard : mShards) {
+        QMutexLocker lock(&shard.mutex);
+        for (auto it = shard.sessions.begin(); it != shard.sessions.end();) {
+            if (it->lastActivity < limit) {
+                it = shard.sessions.erase(it);
+                ++removed;
+            } else {
+                ++it;
+            }
+        }
+    }
+    return removed;
+}
+
+int ExamSessionManager::sessionCount() const
+{
+    int n = 0;
+    for (const Shard &shard : mShards) {
+        QMutexLocker lock(&shard.mutex);
+        n += shard.sessions.size();
+    }
+    return n;
+}
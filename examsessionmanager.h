@@ -0,0 +1,103 @@
+#ifndef EXAMSESSIONMANAGER_H
+#define EXAMSESSIONMANAGER_H
+
+#include <QHash>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QRandomGenerator>
+#include <QVector>
+#include <memory>
+#include "models.h"
+#include "dbmanager.h"
+#include "questiontemplate.h"
+
+// GUI-free host of many concurrent student attempts.
+//
+// Question banks are immutable and shared by all sessions of a test through
+// shared_ptr; re-registering a bank only affects sessions started afterwards.
+// A session keeps only indices of the drawn questions, its answers and a seed
+// from which the option order of every question is derived, so thousands of
+// sessions cost a few hundred bytes each. Sessions are spread over ShardCount
+// hash maps, each with its own mutex, so calls for different sessions rarely
+// contend. All methods are thread safe; none of them touches the database
+// (bank loading and saving results is left to the caller's DB thread).
+class ExamSessionManager
+{
+public:
+    static const int ShardCount = 64;
+
+    // blueprint rule resolved to bank indices (see DBManager::BlueprintRule)
+    struct Stratum {
+        int count = 0;
+        QVector<quint32> candidates; // indices into QuestionBank::questions
+    };
+
+    struct QuestionBank {
+        Test test;
+        QVector<Question> questions;
+        QVector<Stratum> strata;
+        QHash<quint32, QuestionTemplate> templates; // compiled, by index into questions
+    };
+
+    // one question as presented in a session
+    struct QuestionView {
+        int index = -1;
+        int count = 0;
+        Question question;
+        QVector<int> optionOrder; // permutation of question.options to display
+        QString answer;           // stored answer (see Grading for the format)
+    };
+
+    // graded attempt, ready for DBManager::saveResults
+    using FinishedAttempt = DBManager::ResultSubmission;
+
+    void registerBank(const Test &test, QVector<Question> questions, QVector<Stratum> strata = {},
+                      QHash<quint32, QuestionTemplate> templates = {});
+    bool hasBank(const QString &testId) const;
+    void dropBank(const QString &testId);
+    void dropAllBanks();
+    int bankCount() const;
+
+    // draws test.studentCount random questions, first the strata counts from
+    // their candidates, the rest from the whole bank; returns 0 on failure
+    quint64 startSession(const QString &testId, const QString &email, int *questionCount = nullptr,
+                         QString *err = nullptr);
+    bool question(quint64 sessionId, int index, QuestionView *out, QString *err = nullptr);
+    bool setAnswer(quint64 sessionId, int index, const QString &answer, QString *err = nullptr);
+    // grades the session; call endSession() once the result is stored
+    bool gradeSession(quint64 sessionId, FinishedAttempt *out, QString *err = nullptr);
+    void endSession(quint64 sessionId);
+
+    // removes sessions without activity for maxIdleMs, returns how many
+    int expireIdle(qint64 maxIdleMs);
+    int sessionCount() const;
+
+    // building blocks of a session, also used for printed variants (VariantPrinter)
+    static QVector<quint32> drawQuestions(const QuestionBank &b, QRandomGenerator &rng);
+    static QVector<int> optionOrder(quint32 seed, int index, int optionCount);
+    // the question as a session with this seed sees it (parametric ones instantiated)
+    static Question presented(const QuestionBank &b, quint32 index, quint32 seed);
+
+private:
+    struct Session {
+        std::shared_ptr<const QuestionBank> bank;
+        QVector<quint32> drawn;   // indices into bank->questions
+        QVector<QString> answers; // parallel to drawn, null = not answered
+        QString email;
+        quint32 seed = 0;
+        qint64 lastActivity = 0;
+    };
+    struct Shard {
+        mutable QMutex mutex;
+        QHash<quint64, Session> sessions;
+    };
+
+    Shard &shardFor(quint64 sessionId) { return mShards[sessionId % ShardCount]; }
+    std::shared_ptr<const QuestionBank> bank(const QString &testId) const;
+
+    mutable QReadWriteLock mBanksLock;
+    QHash<QString, std::shared_ptr<const QuestionBank>> mBanks;
+    Shard mShards[ShardCount];
+};
+
+#endif // EXAMSESSIONMANAGER_H
@@ -0,0 +1,62 @@
+#include "grading.h"
+#include <algorithm>
+#include <cmath>
+
+QStringList Grading::splitChoices(const QString &answer)
+{
+    QStringList sel = answer.split(";@", Qt::SkipEmptyParts);
+    for (QString &s : sel) s = s.trimmed();
+    return sel;
+}
+
+bool Grading::isCorrect(const Question &q, const QString &answer)
+{
+    if (q.type == QuestionType::TextAnswer) {
+        // no expected answer provided -> cannot auto-evaluate
+        const QString expected = q.expectedText.trimmed();
+        if (expected.isEmpty()) return false;
+        if (QString::compare(answer.trimmed(), expected, Qt::CaseInsensitive) == 0) return true;
+        if (!q.numericKey) return false;
+        // computed keys of parametric questions: "2,50" == "2.5"
+        bool okExpected = false, okAnswer = false;
+        const double e = QString(expected).replace(',', '.').toDouble(&okExpected);
+        const double a = answer.trimmed().replace(',', '.').toDouble(&okAnswer);
+        return okExpected && okAnswer && std::fabs(a - e) <= 1e-9 * qMax(1.0, std::fabs(e));
+    }
+    if (q.type == QuestionType::SingleChoice) {
+        for (const Answer &a : q.options)
+            if (a.correct) return !a.text.isEmpty() && answer == a.text;
+        return false;
+    }
+    // multiple: selected set must equal the correct set
+    QStringList correctTexts;
+    for (const Answer &a : q.options)
+        if (a.correct) correctTexts.append(a.text.trimmed());
+    QStringList sel = splitChoices(answer);
+    std::sort(correctTexts.begin(), correctTexts.end());
+    std::sort(sel.begin(), sel.end());
+    return correctTexts == sel;
+}
+
+double Grading::gradeAttempt(const QVector<Question> &questions, const QVector<QString> &answers,
+                             QVector<DBManager::ResultDetail> *details)
+{
+    double totalScore = 0.0;
+    if (details) {
+        details->clear();
+        details->reserve(questions.size());
+    }
+    for (int i = 0; i < questions.size(); ++i) {
+        const QString ua = answers.value(i);
+        const bool correct = isCorrect(questions[i], ua);
+        if (correct) totalScore += 1.0;
+        if (details) {
+            DBManager::ResultDetail rd;
+            rd.questionId = questions[i].id;
+            rd.correct = correct;
+            rd.userAnswer = ua;
+            details->append(rd);
+        }
+    }
+    return totalScore;
+}
@@ -0,0 +1,22 @@
+#ifndef GRADING_H
+#define GRADING_H
+
+#include <QVector>
+#include "models.h"
+#include "dbmanager.h"
+
+// Evaluation of answers, shared by the student UI, Testrunner and the exam host.
+// Answers use the stored string form: option text for single choice, option
+// texts joined by ";@ " for multiple choice, plain text for text answers
+// (keys computed by a QuestionTemplate also match numerically, "2,50" == "2.5").
+class Grading
+{
+public:
+    static bool isCorrect(const Question &q, const QString &answer);
+    // score = number of correct answers; details get one entry per question
+    static double gradeAttempt(const QVector<Question> &questions, const QVector<QString> &answers,
+                               QVector<DBManager::ResultDetail> *details = nullptr);
+    static QStringList splitChoices(const QString &answer);
+};
+
+#endif // GRADING_H
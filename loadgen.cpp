@@ -0,0 +1,180 @@
+// Load generator for the exam host (QtTestMaker --host ... --port ...).
+// Simulates many concurrent students over loopback: every student repeatedly
+// starts an attempt, fetches and answers all questions and submits. Reports
+// sustained submissions per second and latency percentiles.
+//
+// QtTestMakerLoadGen --test <id> [--port 7878 | --local <name>] [--students 200] [--seconds 30]
+
+#include <QCoreApplication>
+#include <QLocalSocket>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QTextStream>
+#include <algorithm>
+
+static QString argValue(const QStringList &args, const QString &name)
+{
+    int i = args.indexOf(name);
+    return (i >= 0 && i + 1 < args.size()) ? args.at(i + 1) : QString();
+}
+
+struct LoadStats {
+    QVector<qint64> requestUs; // all requests
+    QVector<qint64> submitUs;  // submit requests only (includes the DB write)
+    qint64 submits = 0;
+    qint64 errors = 0;
+};
+
+class SimStudent : public QObject
+{
+public:
+    SimStudent(QIODevice *dev, const QString &testId, LoadStats *stats, const bool *running, QObject *parent)
+        : QObject(parent), mDev(dev), mTestId(testId), mStats(stats), mRunning(running)
+    {
+        mDev->setParent(this);
+        connect(mDev, &QIODevice::readyRead, this, [this]() { onReadyRead(); });
+    }
+
+    void begin()
+    {
+        send(QJsonObject{ {"cmd", "start"}, {"test", mTestId},
+                          {"email", QString("student%1@lab.local").arg(quintptr(this) % 100000)} });
+    }
+
+private:
+    void send(const QJsonObject &req)
+    {
+        mCmd = req.value("cmd").toString();
+        mTimer.start();
+        mDev->write(QJsonDocument(req).toJson(QJsonDocument::Compact) + '\n');
+    }
+
+    void onReadyRead()
+    {
+        while (mDev->canReadLine()) {
+            const QJsonObject r = QJsonDocument::fromJson(mDev->readLine()).object();
+            const qint64 us = mTimer.nsecsElapsed() / 1000;
+            if (!*mRunning) return;
+            mStats->requestUs.append(us);
+            if (!r.value("ok").toBool()) {
+                ++mStats->errors;
+                begin(); // start over with a new attempt
+                return;
+            }
+            if (mCmd == "start") {
+                mSession = r.value("session").toString();
+                mCount = r.value("count").toInt();
+                mIndex = 0;
+                askQuestion();
+            } else if (mCmd == "question") {
+                send(QJsonObject{ {"cmd", "answer"}, {"session", mSession}, {"index", mIndex}, {"answer", pickAnswer(r)} });
+            } else if (mCmd == "answer") {
+                if (++mIndex < mCount) askQuestion();
+                else send(QJsonObject{ {"cmd", "submit"}, {"session", mSession} });
+            } else if (mCmd == "submit") {
+                mStats->submitUs.append(us);
+                ++mStats->submits;
+                begin();
+            }
+        }
+    }
+
+    void askQuestion()
+    {
+        send(QJsonObject{ {"cmd", "question"}, {"session", mSession}, {"index", mIndex} });
+    }
+
+    static QString pickAnswer(const QJsonObject &q)
+    {
+        const QJsonArray options = q.value("options").toArray();
+        QRandomGenerator *rng = QRandomGenerator::global();
+        const int type = q.value("type").toInt();
+        if (type == 2 || options.isEmpty()) return "odpoved";
+        if (type == 0) return options.at(int(rng->bounded(options.size()))).toString();
+        QStringList sel;
+        for (const QJsonValue &o : options)
+            if (rng->bounded(2)) sel.append(o.toString());
+        return sel.join(";@ ");
+    }
+
+    QIODevice *mDev;
+    QString mTestId;
+    LoadStats *mStats;
+    const bool *mRunning;
+    QString mCmd;
+    QString mSession;
+    int mCount = 0;
+    int mIndex = 0;
+    QElapsedTimer mTimer;
+};
+
+static qint64 percentile(QVector<qint64> v, double p)
+{
+    if (v.isEmpty()) return 0;
+    const int k = qBound(0, int(p * (v.size() - 1) + 0.5), int(v.size()) - 1);
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const QStringList args = app.arguments();
+    QTextStream out(stdout);
+
+    const QString testId = argValue(args, "--test");
+    const QString localName = argValue(args, "--local");
+    const int port = argValue(args, "--port").isEmpty() ? 7878 : argValue(args, "--port").toInt();
+    const int students = argValue(args, "--students").isEmpty() ? 200 : argValue(args, "--students").toInt();
+    const int seconds = argValue(args, "--seconds").isEmpty() ? 30 : argValue(args, "--seconds").toInt();
+    if (testId.isEmpty() || students <= 0 || seconds <= 0) {
+        out << "Usage: QtTestMakerLoadGen --test <id> [--port 7878 | --local <name>] [--students 200] [--seconds 30]\n";
+        return 2;
+    }
+
+    LoadStats stats;
+    bool running = true;
+    for (int i = 0; i < students; ++i) {
+        SimStudent *s;
+        if (!localName.isEmpty()) {
+            QLocalSocket *sock = new QLocalSocket;
+            s = new SimStudent(sock, testId, &stats, &running, &app);
+            QObject::connect(sock, &QLocalSocket::connected, s, [s]() { s->begin(); });
+            sock->connectToServer(localName);
+        } else {
+            QTcpSocket *sock = new QTcpSocket;
+            sock->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+            s = new SimStudent(sock, testId, &stats, &running, &app);
+            QObject::connect(sock, &QTcpSocket::connected, s, [s]() { s->begin(); });
+            sock->connectToHost(QHostAddress::LocalHost, quint16(port));
+        }
+    }
+
+    QElapsedTimer wall;
+    wall.start();
+    QTimer::singleShot(seconds * 1000, &app, [&]() {
+        running = false;
+        const double secs = wall.nsecsElapsed() / 1e9;
+        out << "students:        " << students << "\n"
+            << "duration:        " << QString::number(secs, 'f', 1) << " s\n"
+            << "submissions:     " << stats.submits << " (" << QString::number(stats.submits / secs, 'f', 1) << "/s)\n"
+            << "requests:        " << stats.requestUs.size() << " (" << QString::number(stats.requestUs.size() / secs, 'f', 1) << "/s)\n"
+            << "errors:          " << stats.errors << "\n";
+        const auto report = [&out](const char *name, const QVector<qint64> &v) {
+            out << name << " p50 " << percentile(v, 0.50) / 1000.0 << " ms, p95 " << percentile(v, 0.95) / 1000.0
+                << " ms, p99 " << percentile(v, 0.99) / 1000.0 << " ms, max "
+                << (v.isEmpty() ? 0 : *std::max_element(v.begin(), v.end())) / 1000.0 << " ms\n";
+        };
+        report("request latency:", stats.requestUs);
+        report("submit latency: ", stats.submitUs);
+        out.flush();
+        app.quit();
+    });
+    return app.exec();
+}
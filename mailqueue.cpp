@@ -0,0 +1,439 @@
+#include "mailqueue.h"
+#include <QThread>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QDir>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QLocale>
+#include <QSysInfo>
+#include <QUuid>
+#include <QDebug>
+#include <algorithm>
+#if QT_CONFIG(ssl)
+#include <QSslSocket>
+#endif
+
+/* -----------------------------
+   Message format
+   ----------------------------*/
+
+// RFC 2047 encoded words of at most 75 characters, split between characters
+static QByteArray encodeHeader(const QString &value)
+{
+    const QString v = value.simplified(); // no line breaks in headers
+    bool ascii = true;
+    for (QChar c : v) {
+        if (c.unicode() < 0x20 || c.unicode() > 0x7e) {
+            ascii = false;
+            break;
+        }
+    }
+    if (ascii) return v.toLatin1();
+    QByteArray out;
+    QByteArray chunk;
+    for (int i = 0; i < v.size(); ++i) {
+        // a surrogate pair stays in one word
+        const int len = (v[i].isHighSurrogate() && i + 1 < v.size()) ? 2 : 1;
+        const QByteArray ch = v.mid(i, len).toUtf8();
+        i += len - 1;
+        if (chunk.size() + ch.size() > 45) {
+            out += (out.isEmpty() ? "" : "\r\n ") + QByteArray("=?UTF-8?B?") + chunk.toBase64() + "?=";
+            chunk.clear();
+        }
+        chunk += ch;
+    }
+    if (!chunk.isEmpty()) out += (out.isEmpty() ? "" : "\r\n ") + QByteArray("=?UTF-8?B?") + chunk.toBase64() + "?=";
+    return out;
+}
+
+bool MailTransport::isValidAddress(const QString &address)
+{
+    const int at = address.indexOf('@');
+    if (at <= 0 || at == address.size() - 1) return false;
+    return std::none_of(address.cbegin(), address.cend(), [](QChar c) {
+        return c.unicode() <= 0x20 || c == '<' || c == '>' || c == ',' || c == ';';
+    });
+}
+
+QByteArray MailTransport::message(const DBManager::OutgoingMail &m, const QString &from)
+{
+    QByteArray out;
+    out += "From: " + from.toUtf8() + "\r\n";
+    out += "To: " + m.recipient.toUtf8() + "\r\n";
+    out += "Subject: " + encodeHeader(m.subject) + "\r\n";
+    out += "Date: " + QLocale::c().toString(QDateTime::currentDateTimeUtc(), "ddd, dd MMM yyyy hh:mm:ss").toLatin1()
+           + " +0000\r\n";
+    out += "Message-ID: <" + QUuid::createUuid().toByteArray(QUuid::WithoutBraces) + "@qttestmaker>\r\n";
+    out += "MIME-Version: 1.0\r\n";
+    out += "Content-Type: text/plain; charset=UTF-8\r\n";
+    out += "Content-Transfer-Encoding: base64\r\n";
+    out += "\r\n";
+    // base64 never puts a '.' at the start of a line, so no dot-stuffing is needed for DATA
+    const QByteArray body = m.body.toUtf8().toBase64();
+    for (int pos = 0; pos < body.size(); pos += 76) out += body.mid(pos, 76) + "\r\n";
+    return out;
+}
+
+// the password may travel unencrypted only when it does not leave the machine
+static bool isLoopbackHost(const QString &host)
+{
+    return host.compare("localhost", Qt::CaseInsensitive) == 0 || QHostAddress(host).isLoopback();
+}
+
+std::unique_ptr<MailTransport> MailTransport::create(const QString &url, const QString &from, QString *err)
+{
+    const QUrl u(url);
+    const QString scheme = u.scheme().toLower();
+    if (!isValidAddress(from)) {
+        if (err) *err = "Invalid sender address: " + from;
+        return nullptr;
+    }
+    if (scheme == "smtp" || scheme == "smtps") {
+        if (u.host().isEmpty()) {
+            if (err) *err = "Missing SMTP host in " + url;
+            return nullptr;
+        }
+#if !QT_CONFIG(ssl)
+        if (scheme == "smtps" || (!u.userName().isEmpty() && !isLoopbackHost(u.host()))) {
+            if (err) *err = "TLS is not available in this Qt build";
+            return nullptr;
+        }
+#endif
+        return std::make_unique<SmtpTransport>(u, from);
+    }
+    if (scheme == "file") return std::make_unique<FileTransport>(u.toLocalFile(), from);
+    if (err) *err = "Unknown mail transport: " + url;
+    return nullptr;
+}
+
+/* -----------------------------
+   SMTP
+   ----------------------------*/
+
+SmtpTransport::SmtpTransport(const QUrl &url, const QString &from)
+    : mUrl(url), mFrom(from)
+{
+}
+
+SmtpTransport::~SmtpTransport()
+{
+    close();
+}
+
+void SmtpTransport::drop()
+{
+    if (mSocket) mSocket->abort();
+    mSocket.reset();
+}
+
+void SmtpTransport::close()
+{
+    if (!mSocket) return;
+    if (mSocket->state() == QAbstractSocket::ConnectedState) {
+        QString reply;
+        command("QUIT", &reply);
+    }
+    drop();
+}
+
+int SmtpTransport::readReply(QString *reply)
+{
+    reply->clear();
+    for (;;) {
+        while (!mSocket->canReadLine()) {
+            if (!mSocket->waitForReadyRead(TimeoutMs)) return 0;
+        }
+        const QByteArray line = mSocket->readLine().trimmed();
+        if (line.size() < 3) return 0;
+        *reply += QString::fromUtf8(line.mid(4)) + '\n';
+        // "250-..." continues, "250 ..." ends the reply
+        if (line.size() == 3 || line[3] != '-') return line.left(3).toInt();
+    }
+}
+
+int SmtpTransport::command(const QByteArray &line, QString *reply)
+{
+    mSocket->write(line + "\r\n");
+    return readReply(reply);
+}
+
+bool SmtpTransport::open(QString *err)
+{
+    const bool tls = mUrl.scheme().toLower() == "smtps";
+    const quint16 port = quint16(mUrl.port(tls ? 465 : 25));
+    QString reply;
+    bool encrypted = tls;
+#if QT_CONFIG(ssl)
+    auto *ssl = new QSslSocket;
+    mSocket.reset(ssl);
+    if (tls) ssl->connectToHostEncrypted(mUrl.host(), port);
+    else ssl->connectToHost(mUrl.host(), port);
+    const bool connected = tls ? ssl->waitForEncrypted(TimeoutMs) : ssl->waitForConnected(TimeoutMs);
+#else
+    mSocket.reset(new QTcpSocket);
+    mSocket->connectToHost(mUrl.host(), port);
+    const bool connected = mSocket->waitForConnected(TimeoutMs);
+#endif
+    if (!connected) {
+        if (err) *err = QString("Cannot connect to %1:%2: %3").arg(mUrl.host()).arg(port).arg(mSocket->errorString());
+        drop();
+        return false;
+    }
+    QByteArray helo = QSysInfo::machineHostName().toLatin1();
+    if (helo.isEmpty()) helo = "localhost";
+    int code = readReply(&reply);
+    if (code == 220) code = command("EHLO " + helo, &reply);
+    if (code != 250) {
+        if (err) *err = QString("SMTP greeting failed (%1): %2").arg(code).arg(reply.trimmed());
+        drop();
+        return false;
+    }
+#if QT_CONFIG(ssl)
+    if (!tls && reply.contains("STARTTLS", Qt::CaseInsensitive)) {
+        if (command("STARTTLS", &reply) != 220) {
+            if (err) *err = "STARTTLS refused: " + reply.trimmed();
+            drop();
+            return false;
+        }
+        ssl->startClientEncryption();
+        if (!ssl->waitForEncrypted(TimeoutMs)) {
+            if (err) *err = "TLS handshake failed: " + ssl->errorString();
+            drop();
+            return false;
+        }
+        // capabilities are announced again over TLS
+        if (command("EHLO " + helo, &reply) != 250) {
+            if (err) *err = "EHLO after STARTTLS failed: " + reply.trimmed();
+            drop();
+            return false;
+        }
+        encrypted = true;
+    }
+#endif
+    const QString user = mUrl.userName();
+    if (!user.isEmpty()) {
+        if (!encrypted && !isLoopbackHost(mUrl.host())) {
+            // server without STARTTLS: a configuration problem, the password is not sent in clear
+            if (err) *err = QString("%1 offers no STARTTLS, refusing to authenticate without TLS (use smtps://)")
+                                .arg(mUrl.host());
+            drop();
+            return false;
+        }
+        QString password = mUrl.password();
+        if (password.isEmpty()) password = qEnvironmentVariable("QTTESTMAKER_SMTP_PASSWORD");
+        const QByteArray plain = QByteArray(1, '\0') + user.toUtf8() + QByteArray(1, '\0') + password.toUtf8();
+        if (command("AUTH PLAIN " + plain.toBase64(), &reply) != 235) {
+            if (err) *err = "SMTP authentication failed: " + reply.trimmed();
+            drop();
+            return false;
+        }
+    }
+    return true;
+}
+
+MailTransport::Result SmtpTransport::failure(int code, const QByteArray &step, const QString &reply, QString *err)
+{
+    if (err) *err = QString("%1 failed (%2): %3").arg(QString::fromLatin1(step)).arg(code).arg(reply.trimmed());
+    if (code == 0) {
+        drop(); // reconnect for the next mail
+        return Result::TryLater;
+    }
+    QString ignored;
+    if (command("RSET", &ignored) == 0) drop();
+    return code >= 500 ? Result::Rejected : Result::TryLater;
+}
+
+MailTransport::Result SmtpTransport::send(const DBManager::OutgoingMail &m, QString *err)
+{
+    if (!mSocket || mSocket->state() != QAbstractSocket::ConnectedState) {
+        if (!open(err)) return Result::TryLater;
+    }
+    QString reply;
+    int code = command("MAIL FROM:<" + mFrom.toUtf8() + ">", &reply);
+    if (code != 250) return failure(code, "MAIL FROM", reply, err);
+    code = command("RCPT TO:<" + m.recipient.toUtf8() + ">", &reply);
+    if (code != 250 && code != 251) return failure(code, "RCPT TO", reply, err);
+    code = command("DATA", &reply);
+    if (code != 354) return failure(code, "DATA", reply, err);
+    mSocket->write(message(m, mFrom) + ".\r\n");
+    code = readReply(&reply);
+    if (code != 250) return failure(code, "Message", reply, err);
+    return Result::Sent;
+}
+
+/* -----------------------------
+   File
+   ----------------------------*/
+
+MailTransport::Result FileTransport::send(const DBManager::OutgoingMail &m, QString *err)
+{
+    if (!QDir().mkpath(mDirectory)) {
+        if (err) *err = "Cannot create " + mDirectory;
+        return Result::TryLater;
+    }
+    // written under a temporary name and renamed, so a pickup process never sees half a mail
+    QSaveFile file(QDir(mDirectory).filePath(QString("mail-%1.eml").arg(m.id)));
+    if (!file.open(QIODevice::WriteOnly) || file.write(message(m, mFrom)) < 0 || !file.commit()) {
+        if (err) *err = file.errorString();
+        return Result::TryLater;
+    }
+    return Result::Sent;
+}
+
+/* -----------------------------
+   Queue
+   ----------------------------*/
+
+MailQueue::MailQueue(QObject *parent)
+    : QObject(parent)
+{
+    connect(&mTimer, &QTimer::timeout, this, &MailQueue::deliverNow);
+}
+
+MailQueue::~MailQueue()
+{
+    if (mWorker) {
+        mCancel = true;
+        mWorker->wait();
+    }
+}
+
+void MailQueue::start()
+{
+    mTimer.start(qMax(1, mOptions.pollSeconds) * 1000);
+    deliverNow();
+}
+
+void MailQueue::stop()
+{
+    mTimer.stop();
+    mCancel = true;
+}
+
+void MailQueue::deliverNow()
+{
+    if (mWorker) return; // round in progress
+    QVector<DBManager::OutgoingMail> mails;
+    QString err;
+    if (!DBManager::instance().loadDueMails(QDateTime::currentSecsSinceEpoch(), mOptions.batchSize, mails, &err)) {
+        qDebug() << "Mail queue:" << err;
+        return;
+    }
+    if (mails.isEmpty()) return;
+
+    const Options o = mOptions;
+    mCancel = false;
+    auto outcomes = std::make_shared<QVector<Outcome>>();
+    std::shared_ptr<qint64> nextSlot = mNextSlotMs;
+    QThread *worker = QThread::create([this, o, mails, outcomes, nextSlot]() {
+        *outcomes = sendBatch(o, mails, nextSlot.get(), &mCancel);
+    });
+    worker->setObjectName("mail-queue");
+    connect(worker, &QThread::finished, this, [this, worker, o, mails, outcomes]() {
+        worker->deleteLater();
+        mWorker = nullptr;
+        int sent = 0, failed = 0;
+        QString err;
+        if (!applyOutcomes(o, mails, *outcomes, &sent, &failed, &err)) qDebug() << "Mail queue:" << err;
+        if (!outcomes->isEmpty()) emit delivered(sent, failed);
+        // a full round without temporary failures: more may be due right away
+        const bool clean = outcomes->size() == mails.size()
+                           && std::none_of(outcomes->cbegin(), outcomes->cend(), [](const Outcome &x) {
+                                  return x.result == MailTransport::Result::TryLater;
+                              });
+        if (clean && mails.size() == o.batchSize && mTimer.isActive()) QTimer::singleShot(0, this, &MailQueue::deliverNow);
+    });
+    mWorker = worker;
+    worker->start(QThread::LowPriority);
+}
+
+QVector<MailQueue::Outcome> MailQueue::sendBatch(const Options &o, const QVector<DBManager::OutgoingMail> &mails,
+                                                 qint64 *nextSlotMs, const std::atomic<bool> *cancel)
+{
+    QVector<Outcome> outcomes;
+    QString err;
+    std::unique_ptr<MailTransport> transport = MailTransport::create(o.transport, o.from, &err);
+    if (!transport) {
+        // configuration problem: charge the first mail so that it shows up as an error
+        if (!mails.isEmpty()) outcomes.append({ mails.first().id, MailTransport::Result::TryLater, err });
+        return outcomes;
+    }
+    const qint64 interval = 60000 / qMax(1, o.perMinute);
+    for (const DBManager::OutgoingMail &m : mails) {
+        // rate limit, in short sleeps so that stopping is not delayed
+        for (;;) {
+            if (cancel && *cancel) break;
+            const qint64 wait = *nextSlotMs - QDateTime::currentMSecsSinceEpoch();
+            if (wait <= 0) break;
+            QThread::msleep(ulong(qMin<qint64>(wait, 200)));
+        }
+        if (cancel && *cancel) break;
+        Outcome out;
+        out.id = m.id;
+        if (!MailTransport::isValidAddress(m.recipient)) {
+            out.result = MailTransport::Result::Rejected;
+            out.error = "Invalid recipient address: " + m.recipient;
+            outcomes.append(out);
+            continue;
+        }
+        out.result = transport->send(m, &out.error);
+        *nextSlotMs = QDateTime::currentMSecsSinceEpoch() + interval;
+        outcomes.append(out);
+        if (out.result == MailTransport::Result::TryLater) break;
+    }
+    transport->close();
+    return outcomes;
+}
+
+bool MailQueue::applyOutcomes(const Options &o, const QVector<DBManager::OutgoingMail> &mails,
+                              const QVector<Outcome> &outcomes, int *sent, int *failed, QString *err)
+{
+    *sent = 0;
+    *failed = 0;
+    if (outcomes.isEmpty()) return true;
+    QHash<qint64, int> attempts;
+    for (const DBManager::OutgoingMail &m : mails) attempts.insert(m.id, m.attempts);
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    DBManager &db = DBManager::instance();
+    DbTransaction tx(err);
+    if (!tx.isActive()) return false;
+    for (const Outcome &out : outcomes) {
+        const int n = attempts.value(out.id) + 1;
+        bool ok = true;
+        if (out.result == MailTransport::Result::Sent) {
+            ok = db.markMailSent(out.id, now, err);
+            ++*sent;
+        } else {
+            qint64 next = 0;
+            if (out.result == MailTransport::Result::TryLater && n < o.maxAttempts)
+                next = now + qMin<qint64>(qint64(o.retrySeconds) << qMin(n - 1, 20), 6 * 3600);
+            if (next == 0) ++*failed;
+            qDebug() << "Mail" << out.id << (next ? "will be retried:" : "failed:") << out.error;
+            ok = db.markMailRetry(out.id, n, next, out.error, err);
+        }
+        if (!ok) return false;
+    }
+    return tx.commit(err);
+}
+
+bool MailQueue::deliverDue(const Options &o, int *sent, int *failed, QString *err)
+{
+    if (sent) *sent = 0;
+    if (failed) *failed = 0;
+    qint64 nextSlot = 0;
+    for (;;) {
+        QVector<DBManager::OutgoingMail> mails;
+        if (!DBManager::instance().loadDueMails(QDateTime::currentSecsSinceEpoch(), o.batchSize, mails, err))
+            return false;
+        if (mails.isEmpty()) return true;
+        const QVector<Outcome> outcomes = sendBatch(o, mails, &nextSlot, nullptr);
+        int s = 0, f = 0;
+        if (!applyOutcomes(o, mails, outcomes, &s, &f, err)) return false;
+        if (sent) *sent += s;
+        if (failed) *failed += f;
+        // stopped by a temporary failure: the rest waits for the next run
+        if (outcomes.size() < mails.size() || (!outcomes.isEmpty() && outcomes.last().result == MailTransport::Result::TryLater))
+            return true;
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef MAILQUEUE_H
+#define MAILQUEUE_H
+
+#include <QObject>
+#include <QTimer>
+#include <QPointer>
+#include <QUrl>
+#include <atomic>
+#include <memory>
+#include "dbmanager.h"
+
+class QThread;
+class QTcpSocket;
+
+// Delivery of one mail; MailQueue creates a transport per round on its worker
+// thread and sends the round's mails through it one by one (blocking I/O).
+class MailTransport
+{
+public:
+    enum class Result {
+        Sent,
+        TryLater, // temporary failure (4xx, connection problems), retried with backoff
+        Rejected  // permanent failure (5xx), not retried
+    };
+
+    virtual ~MailTransport() = default;
+    virtual Result send(const DBManager::OutgoingMail &m, QString *err = nullptr) = 0;
+    virtual void close() {}
+
+    // smtp://[user[:password]@]host[:port]   port 25, STARTTLS when offered
+    // smtps://[user[:password]@]host[:port]  port 465, TLS from the start
+    // file:///directory                      one .eml file per mail (pickup directory, tests)
+    // A user without password takes it from QTTESTMAKER_SMTP_PASSWORD. The login is only
+    // sent over TLS, except to a loopback host (local relay).
+    static std::unique_ptr<MailTransport> create(const QString &url, const QString &from, QString *err = nullptr);
+    // something@something without characters that would break the SMTP envelope or headers
+    static bool isValidAddress(const QString &address);
+    // RFC 5322 message: UTF-8 text body in base64, encoded subject, CRLF line ends
+    static QByteArray message(const DBManager::OutgoingMail &m, const QString &from);
+};
+
+// SMTP client over a blocking socket; the connection is kept for the whole round.
+class SmtpTransport : public MailTransport
+{
+public:
+    static const int TimeoutMs = 30000;
+
+    SmtpTransport(const QUrl &url, const QString &from);
+    ~SmtpTransport() override;
+    Result send(const DBManager::OutgoingMail &m, QString *err = nullptr) override;
+    void close() override;
+
+private:
+    bool open(QString *err);
+    void drop();
+    int command(const QByteArray &line, QString *reply); // reply code, 0 = connection lost
+    int readReply(QString *reply);
+    Result failure(int code, const QByteArray &step, const QString &reply, QString *err);
+
+    QUrl mUrl;
+    QString mFrom;
+    std::unique_ptr<QTcpSocket> mSocket;
+};
+
+// Writes every mail as <directory>/mail-<id>.eml.
+class FileTransport : public MailTransport
+{
+public:
+    FileTransport(const QString &directory, const QString &from) : mDirectory(directory), mFrom(from) {}
+    Result send(const DBManager::OutgoingMail &m, QString *err = nullptr) override;
+
+private:
+    QString mDirectory;
+    QString mFrom;
+};
+
+// Sender of the persistent mail queue (DBManager::enqueueMails).
+//
+// Every pollSeconds, and right after deliverNow(), up to batchSize due mails
+// are read on the DB thread and handed to a worker thread, which sends them
+// no faster than perMinute; the outcomes are written back in one transaction.
+// A temporary failure ends the round (the server is most likely unavailable)
+// and the mail is retried after retrySeconds, doubled with every attempt up
+// to six hours; after maxAttempts attempts, or on a permanent failure, it is
+// marked failed. Mails not reached in a round are not charged an attempt.
+class MailQueue : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options {
+        QString transport; // see MailTransport::create
+        QString from;
+        int perMinute = 30;
+        int batchSize = 20;
+        int maxAttempts = 8;
+        int retrySeconds = 60;
+        int pollSeconds = 30;
+    };
+
+    explicit MailQueue(QObject *parent = nullptr);
+    ~MailQueue() override;
+
+    void setOptions(const Options &o) { mOptions = o; }
+    const Options &options() const { return mOptions; }
+    void start();
+    void stop();
+    bool isStarted() const { return mTimer.isActive(); }
+
+    // synchronous delivery of everything due now (CLI); call on the DB thread
+    static bool deliverDue(const Options &o, int *sent = nullptr, int *failed = nullptr, QString *err = nullptr);
+
+public slots:
+    void deliverNow();
+
+signals:
+    void delivered(int sent, int failed); // after every round that sent something
+
+private:
+    struct Outcome {
+        qint64 id = 0;
+        MailTransport::Result result = MailTransport::Result::TryLater;
+        QString error;
+    };
+    // worker thread body; *nextSlotMs carries the rate limit over rounds
+    static QVector<Outcome> sendBatch(const Options &o, const QVector<DBManager::OutgoingMail> &mails,
+                                      qint64 *nextSlotMs, const std::atomic<bool> *cancel);
+    static bool applyOutcomes(const Options &o, const QVector<DBManager::OutgoingMail> &mails,
+                              const QVector<Outcome> &outcomes, int *sent, int *failed, QString *err);
+
+    Options mOptions;
+    QTimer mTimer;
+    QPointer<QThread> mWorker;
+    std::atomic<bool> mCancel{false};
+    std::shared_ptr<qint64> mNextSlotMs = std::make_shared<qint64>(0);
+};
+
+#endif // MAILQUEUE_H
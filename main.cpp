@@ -1,21 +1,408 @@
 #include <QApplication>
 #include "mainwindow.h"
+#include "dbmanager.h"
+#include "resultexporter.h"
+#include "examhostserver.h"
+#include "changesetsync.h"
+#include "backupscheduler.h"
+#include "dbmaintenance.h"
+#include "dbchangebus.h"
+#include "variantprinter.h"
+#include "mailqueue.h"
+#include "resultreport.h"
+#include <QGuiApplication>
 #include <QStringList>
+#include <QDebug>
 
 // TOTO
 // pri otazke s vice moznostami posledni pridana polozka neobsahuje text po zobrazeni.
 // asi sa nespravne anebo vubec neulozi do db
 
+static QString argValue(const QStringList &args, const QString &name)
+{
+    int i = args.indexOf(name);
+    return (i >= 0 && i + 1 < args.size()) ? args.at(i + 1) : QString();
+}
+
+// QtTestMaker --export-results <file.csv|file.qtr> [--test <id>] [--from <iso>] [--to <iso>] [--student <email>] [--include-archived] [--db <path>]
+static int runExportResults(const QStringList &args)
+{
+    QString path = argValue(args, "--export-results");
+    if (path.isEmpty()) {
+        qWarning() << "Usage: --export-results <file.csv|file.qtr> [--test <id>] [--from <iso>] [--to <iso>] [--student <email>] [--include-archived] [--db <path>]";
+        return 2;
+    }
+    QString dbPath = argValue(args, "--db");
+    if (dbPath.isEmpty()) dbPath = DBManager::defaultDatabasePath();
+
+    QString err;
+    if (!DBManager::instance().openDatabase(dbPath, &err)) {
+        qWarning() << "DB Error:" << err;
+        return 1;
+    }
+    DBManager::ResultFilter filter;
+    filter.testId = argValue(args, "--test");
+    filter.from = argValue(args, "--from");
+    filter.to = argValue(args, "--to");
+    filter.studentEmail = argValue(args, "--student");
+    filter.includeArchived = args.contains("--include-archived");
+
+    qint64 count = 0;
+    if (!ResultExporter::exportResults(path, ResultExporter::formatForFile(path), filter, &count, &err)) {
+        qWarning() << "Export failed:" << err;
+        return 1;
+    }
+    qInfo() << "Exported" << count << "results to" << path;
+    return 0;
+}
+
+// QtTestMaker --archive-results <cutoff yyyy-MM-dd> [--db <path>]
+static int runArchiveResults(const QStringList &args)
+{
+    const QString cutoff = argValue(args, "--archive-results");
+    if (cutoff.isEmpty()) {
+        qWarning() << "Usage: --archive-results <yyyy-MM-dd> [--db <path>]";
+        return 2;
+    }
+    QString dbPath = argValue(args, "--db");
+    if (dbPath.isEmpty()) dbPath = DBManager::defaultDatabasePath();
+    QString err;
+    qint64 moved = 0;
+    if (!DBManager::instance().openDatabase(dbPath, &err)
+        || !DBManager::instance().archiveResults(cutoff, &moved, &err)) {
+        qWarning() << "Archiving failed:" << err;
+        return 1;
+    }
+    qInfo() << "Archived" << moved << "results to" << DBManager::instance().archiveDirectory();
+    return 0;
+}
+
+// QtTestMaker --calibrate <test id> [--db <path>]: IRT parameters of the test's questions for adaptive mode
+static int runCalibrate(const QStringList &args)
+{
+    const QString testId = argValue(args, "--calibrate");
+    if (testId.isEmpty()) {
+        qWarning() << "Usage: --calibrate <test id> [--db <path>]";
+        return 2;
+    }
+    QString dbPath = argValue(args, "--db");
+    if (dbPath.isEmpty()) dbPath = DBManager::defaultDatabasePath();
+    QString err;
+    int calibrated = 0;
+    if (!DBManager::instance().openDatabase(dbPath, &err)
+        || !DBManager::instance().calibrateItems(testId, &calibrated, &err)) {
+        qWarning() << "Calibration failed:" << err;
+        return 1;
+    }
+    qInfo() << "Calibrated" << calibrated << "questions";
+    return 0;
+}
+
+// QtTestMaker --backup <file.db|file.db.gz> [--db <path>]: online backup, safe while the DB is in use
+static int runBackup(const QStringList &args)
+{
+    const QString dest = argValue(args, "--backup");
+    if (dest.isEmpty()) {
+        qWarning() << "Usage: --backup <file.db|file.db.gz> [--db <path>]";
+        return 2;
+    }
+    QString dbPath = argValue(args, "--db");
+    if (dbPath.isEmpty()) dbPath = DBManager::defaultDatabasePath();
+    BackupScheduler::Options o;
+    o.compress = dest.endsWith(".gz", Qt::CaseInsensitive);
+    QString err;
+    if (!BackupScheduler::backupDatabase(dbPath, dest, o, nullptr, &err)) {
+        qWarning() << "Backup failed:" << err;
+        return 1;
+    }
+    qInfo() << "Backup written to" << dest;
+    return 0;
+}
+
+// QtTestMaker --vacuum [--db <path>]: one-time switch of an older DB to auto_vacuum=INCREMENTAL
+// (a full VACUUM; run it when nobody else uses the DB, idle maintenance then reclaims free pages)
+static int runVacuum(const QStringList &args)
+{
+    QString dbPath = argValue(args, "--db");
+    if (dbPath.isEmpty()) dbPath = DBManager::defaultDatabasePath();
+    DBManager &db = DBManager::instance();
+    QString err;
+    if (!db.openDatabase(dbPath, &err)) {
+        qWarning() << "DB Error:" << err;
+        return 1;
+    }
+    if (db.isIncrementalVacuum()) {
+        qInfo() << "Database already uses auto_vacuum=INCREMENTAL";
+        return 0;
+    }
+    qint64 before = 0, after = 0, pageSize = 0;
+    db.databaseSize(&before, &pageSize);
+    if (!db.convertToIncrementalVacuum(&err)) {
+        qWarning() << "VACUUM failed:" << err;
+        return 1;
+    }
+    db.databaseSize(&after, &pageSize);
+    qInfo() << "Switched to auto_vacuum=INCREMENTAL," << (before - after) * pageSize / 1024 << "KiB reclaimed";
+    return 0;
+}
+
+// QtTestMaker --print-variants <directory> --test <id> [--count n] [--seed s] [--threads n] [--db <path>]
+// PDF variants with answer keys for a paper exam; headless: add -platform offscreen
+static int runPrintVariants(const QStringList &args)
+{
+    VariantPrinter::Options o;
+    o.directory = argValue(args, "--print-variants");
+    const QString testId = argValue(args, "--test");
+    if (o.directory.isEmpty() || testId.isEmpty()) {
+        qWarning() << "Usage: --print-variants <directory> --test <id> [--count n] [--seed s] [--threads n] [--db <path>]";
+        return 2;
+    }
+    if (args.contains("--count")) o.count = argValue(args, "--count").toInt();
+    o.seed = argValue(args, "--seed").toUInt();
+    o.threads = argValue(args, "--threads").toInt();
+    QString dbPath = argValue(args, "--db");
+    if (dbPath.isEmpty()) dbPath = DBManager::defaultDatabasePath();
+    QString err;
+    ExamSessionManager::QuestionBank bank;
+    if (!DBManager::instance().openDatabase(dbPath, &err)
+        || !ExamHostServer::loadBank(testId, &bank, &err)
+        || !VariantPrinter::printVariants(bank, o, nullptr, {}, &err)) {
+        qWarning() << "Printing variants failed:" << err;
+        return 1;
+    }
+    qInfo() << "Printed" << o.count << "variants to" << o.directory;
+    return 0;
+}
+
+// QtTestMaker --send-mail [--queue-results [--test <id>] [--from <iso>] [--to <iso>] [--include-archived]]
+//             [--mail-transport <url>] [--mail-from <address>] [--per-minute n] [--db <path>]
+// queues result reports and sends what is due (run from cron for retries); transport and sender
+// default to QTTESTMAKER_MAIL_TRANSPORT and QTTESTMAKER_MAIL_FROM
+static int runSendMail(const QStringList &args)
+{
+    MailQueue::Options o;
+    o.transport = argValue(args, "--mail-transport");
+    if (o.transport.isEmpty()) o.transport = qEnvironmentVariable("QTTESTMAKER_MAIL_TRANSPORT");
+    o.from = argValue(args, "--mail-from");
+    if (o.from.isEmpty()) o.from = qEnvironmentVariable("QTTESTMAKER_MAIL_FROM");
+    if (o.transport.isEmpty() || o.from.isEmpty()) {
+        qWarning() << "Usage: --send-mail [--queue-results [--test <id>] [--from <iso>] [--to <iso>] [--include-archived]]"
+                      " --mail-transport <smtp://host[:port]|smtps://...|file:///dir> --mail-from <address> [--per-minute n] [--db <path>]";
+        return 2;
+    }
+    if (args.contains("--per-minute")) o.perMinute = qMax(1, argValue(args, "--per-minute").toInt());
+    QString dbPath = argValue(args, "--db");
+    if (dbPath.isEmpty()) dbPath = DBManager::defaultDatabasePath();
+    QString err;
+    if (!DBManager::instance().openDatabase(dbPath, &err)) {
+        qWarning() << "DB Error:" << err;
+        return 1;
+    }
+    if (args.contains("--queue-results")) {
+        DBManager::ResultFilter filter;
+        filter.testId = argValue(args, "--test");
+        filter.from = argValue(args, "--from");
+        filter.to = argValue(args, "--to");
+        filter.includeArchived = args.contains("--include-archived");
+        int queued = 0, skipped = 0;
+        if (!ResultReport::queueReports(filter, &queued, &skipped, &err)) {
+            qWarning() << "Queueing reports failed:" << err;
+            return 1;
+        }
+        qInfo() << "Queued" << queued << "reports," << skipped << "results without an address";
+    }
+    int sent = 0, failed = 0, pending = 0;
+    if (!MailQueue::deliverDue(o, &sent, &failed, &err)
+        || !DBManager::instance().mailQueueCounts(&pending, &failed, &err)) {
+        qWarning() << "Sending mail failed:" << err;
+        return 1;
+    }
+    qInfo() << "Sent" << sent << "mails," << pending << "waiting," << failed << "failed in total";
+    return 0;
+}
+
+// QtTestMaker --sync-export <file.qts> [--base <path>] [--db <path>]
+// QtTestMaker --sync-apply <file.qts> [--on-conflict skip|overwrite|abort] [--db <path>]
+// QtTestMaker --new-site [--db <path>]: own result id range for a copied database
+static int runSync(const QStringList &args)
+{
+    QString dbPath = argValue(args, "--db");
+    if (dbPath.isEmpty()) dbPath = DBManager::defaultDatabasePath();
+    QString err;
+
+    if (args.contains("--new-site")) {
+        if (!DBManager::instance().openDatabase(dbPath, &err) || !DBManager::instance().assignNewSiteId(&err)) {
+            qWarning() << "DB Error:" << err;
+            return 1;
+        }
+        qInfo() << "Database" << dbPath << "now has site id" << DBManager::instance().siteId();
+        return 0;
+    }
+
+    const QString exportFile = argValue(args, "--sync-export");
+    if (!exportFile.isEmpty()) {
+        // make sure schema and site id exist before the first export
+        if (!DBManager::instance().openDatabase(dbPath, &err)) {
+            qWarning() << "DB Error:" << err;
+            return 1;
+        }
+        // a copy still has the site id of its original: their results would share ids
+        if (DBManager::instance().isSiteCopy()) {
+            qWarning().noquote() << "The database was copied or moved since its site id was assigned; run"
+                                 << "QtTestMaker --new-site --db" << dbPath << "first.";
+            return 1;
+        }
+        DBManager::instance().closeDatabase();
+        QString base = argValue(args, "--base");
+        if (base.isEmpty()) base = ChangesetSync::defaultBasePath(dbPath);
+        int changes = 0;
+        if (!ChangesetSync::exportChanges(dbPath, base, exportFile, &changes, &err)) {
+            qWarning() << "Sync export failed:" << err;
+            return 1;
+        }
+        qInfo() << "Exported" << changes << "changes to" << exportFile;
+        return 0;
+    }
+
+    const QString applyFile = argValue(args, "--sync-apply");
+    if (applyFile.isEmpty()) {
+        qWarning() << "Usage: --sync-export <file> [--base <path>] [--db <path>] | --sync-apply <file> [--on-conflict skip|overwrite|abort] [--db <path>] | --new-site [--db <path>]";
+        return 2;
+    }
+    const QString policyName = argValue(args, "--on-conflict");
+    ChangesetSync::ConflictPolicy policy = ChangesetSync::ConflictPolicy::Skip;
+    if (policyName == "overwrite") policy = ChangesetSync::ConflictPolicy::Overwrite;
+    else if (policyName == "abort") policy = ChangesetSync::ConflictPolicy::Abort;
+    else if (!policyName.isEmpty() && policyName != "skip") {
+        qWarning() << "Unknown conflict policy:" << policyName;
+        return 2;
+    }
+
+    if (!DBManager::instance().openDatabase(dbPath, &err)) {
+        qWarning() << "DB Error:" << err;
+        return 1;
+    }
+    DBManager::instance().closeDatabase();
+    ChangesetSync::ApplyStats stats;
+    if (!ChangesetSync::applyChanges(dbPath, applyFile, policy, &stats, &err)) {
+        qWarning() << "Sync apply failed:" << err;
+        return 1;
+    }
+    qInfo() << "Applied" << stats.changes << "changes," << stats.conflicts << "conflicts";
+
+    // search and similarity index are derived from questions/options
+    if (stats.questionsChanged) {
+        DBManager &db = DBManager::instance();
+        // without FTS5 in this SQLite build there is no search index to rebuild
+        if (!db.openDatabase(dbPath, &err)
+            || (db.hasSearchIndex() && !db.rebuildSearchIndex(&err))
+            || !db.rebuildSimilarityIndex(&err)) {
+            qWarning() << "Rebuilding indexes failed:" << err;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// QtTestMaker --host [name] [--port <tcp port>] [--workers n] [--wal] [--db <path>]
+// exam sessions for thin clients over a local socket and optionally TCP (computer labs)
+static int runExamHost(QCoreApplication &app)
+{
+    const QStringList args = app.arguments();
+    QString name = argValue(args, "--host");
+    if (name.isEmpty() || name.startsWith("--")) name = "qttestmaker-exam";
+    const int port = argValue(args, "--port").toInt();
+    const int workers = argValue(args, "--workers").toInt();
+    QString dbPath = argValue(args, "--db");
+    if (dbPath.isEmpty()) dbPath = DBManager::defaultDatabasePath();
+
+    QString err;
+    if (!DBManager::instance().openDatabase(dbPath, &err)) {
+        qWarning() << "DB Error:" << err;
+        return 1;
+    }
+    if (!DBManager::instance().setWriteAheadLog(args.contains("--wal"), &err)) qWarning() << "DB journal mode:" << err;
+    ExamHostServer host;
+    if (workers > 0) host.setWorkerCount(workers);
+    if (!host.listen(name, &err)) {
+        qWarning() << "Cannot listen on" << name << ":" << err;
+        return 1;
+    }
+    qInfo() << "Exam host listening on" << name;
+    if (port > 0) {
+        if (!host.listenTcp(QHostAddress::Any, quint16(port), &err)) {
+            qWarning() << "Cannot listen on TCP port" << port << ":" << err;
+            return 1;
+        }
+        qInfo() << "Exam host listening on TCP port" << port;
+    }
+    DbMaintenance maintenance;
+    QObject::connect(&host, &ExamHostServer::resultsSaved, &maintenance, &DbMaintenance::notifyActivity);
+    maintenance.start();
+    // tests edited in the teacher's editor are reloaded for the next attempts
+    DbChangeBus::instance().startWatching();
+    return app.exec();
+}
 
 int main(int argc, char *argv[])
 {
+    // batch modes run without GUI
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--export-results") == 0) {
+            QCoreApplication a(argc, argv);
+            return runExportResults(a.arguments());
+        }
+        if (qstrcmp(argv[i], "--archive-results") == 0) {
+            QCoreApplication a(argc, argv);
+            return runArchiveResults(a.arguments());
+        }
+        if (qstrcmp(argv[i], "--calibrate") == 0) {
+            QCoreApplication a(argc, argv);
+            return runCalibrate(a.arguments());
+        }
+        if (qstrcmp(argv[i], "--backup") == 0) {
+            QCoreApplication a(argc, argv);
+            return runBackup(a.arguments());
+        }
+        if (qstrcmp(argv[i], "--vacuum") == 0) {
+            QCoreApplication a(argc, argv);
+            return runVacuum(a.arguments());
+        }
+        if (qstrcmp(argv[i], "--print-variants") == 0) {
+            // text layout needs the GUI platform (fonts), no window is shown
+            QGuiApplication a(argc, argv);
+            return runPrintVariants(a.arguments());
+        }
+        if (qstrcmp(argv[i], "--send-mail") == 0) {
+            QCoreApplication a(argc, argv);
+            return runSendMail(a.arguments());
+        }
+        if (qstrcmp(argv[i], "--sync-export") == 0 || qstrcmp(argv[i], "--sync-apply") == 0
+            || qstrcmp(argv[i], "--new-site") == 0) {
+            QCoreApplication a(argc, argv);
+            return runSync(a.arguments());
+        }
+        if (qstrcmp(argv[i], "--host") == 0) {
+            QCoreApplication a(argc, argv);
+            return runExamHost(a);
+        }
+    }
+
     QApplication a(argc, argv);
 
     // detect teacher mode by presence of "-t" parameter
     QStringList args = a.arguments();
     bool teacherMode = args.contains(QStringLiteral("-t"));
 
-    MainWindow w(teacherMode);
+    // student kiosk: test from an exam package exported in teacher mode
+    QString examPackage = argValue(args, "--package");
+
+    MainWindow w(teacherMode, examPackage);
+    if (teacherMode && DBManager::instance().isOpen()) {
+        QString err;
+        if (!DBManager::instance().setWriteAheadLog(args.contains(QStringLiteral("--wal")), &err))
+            qDebug() << "DB journal mode:" << err;
+    }
     w.show();
     return a.exec();
 }
@@ -2,20 +2,48 @@
 #include "dbmanager.h"
 #include "testrunner.h"
 #include "customtextedit.h"
-
+#include "studentquestionview.h"
+#include "testlistmodel.h"
+#include "questionlistmodel.h"
+#include "questionimporter.h"
+#include "resultexporter.h"
+#include "exampackage.h"
+#include "grading.h"
+#include "backupscheduler.h"
+#include "dbmaintenance.h"
+#include "dbchangebus.h"
+#include "resultstablemodel.h"
+#include "examhostserver.h"
+#include "variantprinter.h"
+#include "mailqueue.h"
+#include "resultreport.h"
+
+#include <QListView>
 #include <QListWidget>
+#include <QScrollBar>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QProgressDialog>
+#include <QPlainTextEdit>
+#include <QInputDialog>
+#include <QFileDialog>
+#include <QItemSelectionModel>
 #include <QPushButton>
 #include <QTextEdit>
 #include <QComboBox>
 #include <QTableWidget>
+#include <QTableView>
 #include <QHeaderView>
 #include <QLineEdit>
 #include <QSpinBox>
+#include <QDoubleSpinBox>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
 #include <QSplitter>
 #include <QLabel>
 #include <QMessageBox>
+#include <QStatusBar>
+#include <QDate>
 #include <QCheckBox>
 #include <QApplication>
 #include <QUuid>
@@ -24,9 +52,13 @@
 #include <QCheckBox>
 #include <QLayoutItem>
 #include <QRandomGenerator>
+#include <QHash>
+#include <QSet>
+#include <QSignalBlocker>
+#include <QDebug>
 #include <algorithm>
 
-MainWindow::MainWindow(bool teacherMode, QWidget *parent)
+MainWindow::MainWindow(bool teacherMode, const QString &examPackagePath, QWidget *parent)
     : QMainWindow(parent), mTeacherMode(teacherMode)
 {
     // debounce timer for auto-save
@@ -37,18 +69,74 @@ MainWindow::MainWindow(bool teacherMode, QWidget *parent)
     if (mTeacherMode) buildTeacherUi();
     else buildStudentUi();
 
-    // open DB (default path). Adjust path if you use custom filename/location.
+    // name filter of the test catalog (debounced like the question search)
+    mTestFilterTimer.setSingleShot(true);
+    mTestFilterTimer.setInterval(200); // ms
+    connect(&mTestFilterTimer, &QTimer::timeout, this, &MainWindow::applyTestFilter);
+    connect(mEditTestFilter, &QLineEdit::textChanged, this, [this]() { mTestFilterTimer.start(); });
+
     QString err;
-    QString dbPath = "../../questions.db";
+    if (!mTeacherMode && !examPackagePath.isEmpty()) {
+        // kiosk: no SQLite on the read path, DB is opened only to store the result
+        if (!mExamPackage.open(examPackagePath, &err)) {
+            QMessageBox::critical(this, "Chyba balíčku testu", err);
+            return;
+        }
+        mEditTestFilter->hide();
+        mTestModel->setTests(QVector<Test>{ mExamPackage.test() });
+        if (!offerJournalResume()) selectTestRow(0);
+        return;
+    }
+
+    // open DB (default path). Adjust path if you use custom filename/location.
+    QString dbPath = DBManager::defaultDatabasePath();
     if (!DBManager::instance().openDatabase(dbPath, &err)) {
         QMessageBox::critical(this, "DB Error", err);
+    } else if (mTeacherMode) {
+        // hourly online backup while the editor is open
+        mBackup = new BackupScheduler(this);
+        mBackup->setDatabasePath(dbPath);
+        BackupScheduler::Options bo = mBackup->options(); // app data dir, keep 10, gzip
+        bo.intervalMinutes = 60;
+        mBackup->setOptions(bo);
+        connect(mBackup, &BackupScheduler::backupFinished, this, [this](bool ok, const QString &msg) {
+            statusBar()->showMessage(ok ? "Záloha uložena: " + msg : "Záloha se nezdařila: " + msg, 10000);
+        });
+
+        // queued result reports (also from Testrunner) go out while the editor is open
+        mMailQueue = new MailQueue(this);
+        MailQueue::Options mo;
+        mo.transport = qEnvironmentVariable("QTTESTMAKER_MAIL_TRANSPORT");
+        mo.from = qEnvironmentVariable("QTTESTMAKER_MAIL_FROM");
+        mMailQueue->setOptions(mo);
+        connect(mMailQueue, &MailQueue::delivered, this, [this](int sent, int failed) {
+            statusBar()->showMessage(QString("Odesláno e-mailů: %1, neúspěšných: %2").arg(sent).arg(failed), 10000);
+        });
+        if (!mo.transport.isEmpty() && !mo.from.isEmpty()) mMailQueue->start();
+
+        mMaintenance = new DbMaintenance(this);
+        connect(mMaintenance, &DbMaintenance::integrityProblem, this, [this](const QString &table, const QStringList &problems) {
+            QMessageBox::warning(this, "Kontrola databáze",
+                                 QString("Tabulka %1 je poškozená:\n%2\n\nObnovte databázi ze zálohy.")
+                                     .arg(table, problems.mid(0, 5).join("\n")));
+        });
+        mMaintenance->start();
     }
 
-    // load tests from DB
-    if (!DBManager::instance().loadTests(mTests, &err)) {
+    // first page of the test catalog, the rest is fetched on scroll
+    mTestModel->setShowStatistics(mTeacherMode);
+    if (DBManager::instance().isOpen() && !mTestModel->loadCatalog(QString(), &err)) {
         QMessageBox::warning(this, "DB load tests failed", err);
     }
-    refreshTestList();
+    if (DBManager::instance().isOpen()) {
+        // edits from another editor (or the teacher's, on a kiosk) show up without reloading
+        connect(&DbChangeBus::instance(), &DbChangeBus::changed, this, &MainWindow::onDatabaseChanged);
+        DbChangeBus::instance().startWatching();
+    }
+    if (!mTeacherMode && !mTests.isEmpty() && !offerJournalResume()) {
+        // select first test by default for student
+        selectTestRow(0);
+    }
 }
 
 QString MainWindow::currentTestId() const
@@ -61,7 +149,43 @@ QString MainWindow::currentTestId() const
 int MainWindow::currentTestIndex() const
 {
     if (!mListTests) return -1;
-    return mListTests->currentRow();
+    QModelIndex cur = mListTests->currentIndex();
+    return cur.isValid() ? cur.row() : -1;
+}
+
+int MainWindow::currentQuestionRow() const
+{
+    if (!mListQuestions) return -1;
+    QModelIndex cur = mListQuestions->currentIndex();
+    return cur.isValid() ? cur.row() : -1;
+}
+
+void MainWindow::selectTestRow(int row)
+{
+    if (!mListTests) return;
+    mListTests->setCurrentIndex(mTestModel->index(row));
+}
+
+void MainWindow::selectQuestionRow(int row)
+{
+    if (!mListQuestions) return;
+    mListQuestions->setCurrentIndex(mQuestionModel->index(row));
+}
+
+/* models for the list views; selection is tracked by row through the selection model */
+void MainWindow::setupListModels()
+{
+    mTestModel = new TestListModel(&mTests, this);
+    mListTests->setModel(mTestModel);
+    connect(mListTests->selectionModel(), &QItemSelectionModel::currentRowChanged, this,
+            [this](const QModelIndex &cur, const QModelIndex &) { onTestSelected(cur.isValid() ? cur.row() : -1); });
+
+    if (!mListQuestions) return;
+    mQuestionModel = new QuestionListModel(&mQuestions, this);
+    mListQuestions->setModel(mQuestionModel);
+    mListQuestions->setUniformItemSizes(true);
+    connect(mListQuestions->selectionModel(), &QItemSelectionModel::currentRowChanged, this,
+            [this](const QModelIndex &cur, const QModelIndex &) { onQuestionSelected(cur.isValid() ? cur.row() : -1); });
 }
 
 /* -----------------------------
@@ -73,17 +197,37 @@ void MainWindow::buildTeacherUi()
     setCentralWidget(central);
 
     // Left: tests + test metadata + questions list
-    mListTests = new QListWidget;
-    mListTests->setMaximumHeight(95);
+    mListTests = new QListView;
+    mListTests->setMaximumHeight(140);
+    mEditTestFilter = new QLineEdit;
+    mEditTestFilter->setPlaceholderText("Hledat test...");
+    mEditTestFilter->setClearButtonEnabled(true);
     mBtnAddTest = new QPushButton("Přidat test");
     mBtnRemoveTest = new QPushButton("Odstranit test");
     mEditTestName = new QLineEdit;
     mEditTestName->setPlaceholderText("Název testu");
     mEditTestDescription = new QLineEdit;
     mEditTestDescription->setPlaceholderText("Popis testu");
-    mListQuestions = new QListWidget;
+    mListQuestions = new QListView;
+    mEditSearch = new QLineEdit;
+    mEditSearch->setPlaceholderText("Hledat otázky...");
+    mEditSearch->setClearButtonEnabled(true);
+    mListSearchResults = new QListWidget;
+    mListSearchResults->setMaximumHeight(150);
+    mListSearchResults->hide();
     mBtnAddQuestion = new QPushButton("Přidat otázku");
     mBtnRemoveQuestion = new QPushButton("Odstranit otázku");
+    mBtnFindDuplicates = new QPushButton("Najít duplicitní otázky");
+    mBtnImportQuestions = new QPushButton("Importovat otázky...");
+    mBtnExportResults = new QPushButton("Exportovat výsledky...");
+    mBtnBrowseResults = new QPushButton("Výsledky...");
+    mBtnExportPackage = new QPushButton("Exportovat balíček testu...");
+    mBtnPrintVariants = new QPushButton("Tisk variant (PDF)...");
+    mBtnMailResults = new QPushButton("Rozeslat výsledky...");
+    mBtnBackupNow = new QPushButton("Zálohovat DB");
+    mBtnArchiveResults = new QPushButton("Archivovat výsledky...");
+    mBtnBlueprint = new QPushButton("Plán testu...");
+    mBtnAdaptive = new QPushButton("Adaptivní test...");
 
     // Tests list
     QHBoxLayout *testTop = new QHBoxLayout;
@@ -92,6 +236,7 @@ void MainWindow::buildTeacherUi()
 
     QVBoxLayout *leftLayout = new QVBoxLayout;
     leftLayout->addWidget(new QLabel("Testy:"));
+    leftLayout->addWidget(mEditTestFilter);
     leftLayout->addWidget(mListTests);
     leftLayout->addLayout(testTop);
     leftLayout->addWidget(mEditTestName);
@@ -99,11 +244,30 @@ void MainWindow::buildTeacherUi()
 
     // Questions list
     leftLayout->addWidget(new QLabel("Otázky:"));
+    leftLayout->addWidget(mEditSearch);
+    leftLayout->addWidget(mListSearchResults);
     leftLayout->addWidget(mListQuestions);
     QHBoxLayout *qBtns = new QHBoxLayout;
     qBtns->addWidget(mBtnAddQuestion);
     qBtns->addWidget(mBtnRemoveQuestion);
     leftLayout->addLayout(qBtns);
+    QHBoxLayout *toolBtns = new QHBoxLayout;
+    toolBtns->addWidget(mBtnImportQuestions);
+    toolBtns->addWidget(mBtnFindDuplicates);
+    toolBtns->addWidget(mBtnBlueprint);
+    toolBtns->addWidget(mBtnAdaptive);
+    leftLayout->addLayout(toolBtns);
+    QHBoxLayout *exportBtns = new QHBoxLayout;
+    exportBtns->addWidget(mBtnBrowseResults);
+    exportBtns->addWidget(mBtnExportResults);
+    exportBtns->addWidget(mBtnExportPackage);
+    exportBtns->addWidget(mBtnPrintVariants);
+    exportBtns->addWidget(mBtnMailResults);
+    leftLayout->addLayout(exportBtns);
+    QHBoxLayout *dbBtns = new QHBoxLayout;
+    dbBtns->addWidget(mBtnBackupNow);
+    dbBtns->addWidget(mBtnArchiveResults);
+    leftLayout->addLayout(dbBtns);
 
     // Number of questions in test of student(subset of all questions for the test)
     mSpinStudentCount = new QSpinBox;
@@ -128,6 +292,15 @@ void MainWindow::buildTeacherUi()
     mBtnAddAnswer = new QPushButton("Přidat možnost");
     mBtnRemoveAnswer = new QPushButton("Odstranit možnost");
     mEditExpectedText = new QLineEdit;
+    mEditQuestionTags = new QLineEdit;
+    mEditQuestionTags->setPlaceholderText("např. algebra/rovnice, geometrie");
+    mEditTemplate = new QPlainTextEdit;
+    mEditTemplate->setPlaceholderText("a = 2..12\nb = 1..10\nwhere a % b == 0\nanswer = a / b");
+    mEditTemplate->setMaximumHeight(110);
+    mEditTemplate->setToolTip("V textu otázky a možností se {a} nahradí hodnotou; u textové odpovědi je správnou odpovědí answer.\n"
+                              "Funkce: abs sqrt floor ceil round(x, míst) min max gcd");
+    mLblTemplatePreview = new QLabel;
+    mLblTemplatePreview->setWordWrap(true);
 
     QVBoxLayout *rightLayout = new QVBoxLayout;
     rightLayout->addWidget(new QLabel("Text otázky:"));
@@ -142,6 +315,11 @@ void MainWindow::buildTeacherUi()
     rightLayout->addLayout(ansBtns);
     rightLayout->addWidget(new QLabel("Očekávaný text (pro textovou odpověď):"));
     rightLayout->addWidget(mEditExpectedText);
+    rightLayout->addWidget(new QLabel("Štítky (oddělené čárkou, úrovně lomítkem):"));
+    rightLayout->addWidget(mEditQuestionTags);
+    rightLayout->addWidget(new QLabel("Parametry (šablona s proměnnými, prázdné = běžná otázka):"));
+    rightLayout->addWidget(mEditTemplate);
+    rightLayout->addWidget(mLblTemplatePreview);
     rightLayout->addStretch(1);
 
     QSplitter *split = new QSplitter;
@@ -160,18 +338,17 @@ void MainWindow::buildTeacherUi()
     // connect RemoveTest to our slot (implementaton provided)
     connect(mBtnRemoveTest, &QPushButton::clicked, this, &MainWindow::onRemoveTest);
 
-    connect(mListTests, &QListWidget::currentRowChanged, this, &MainWindow::onTestSelected);
+    setupListModels();
     connect(mEditTestName, &QLineEdit::editingFinished, this, [this](){
-        int idx = mListTests->currentRow();
+        int idx = currentTestIndex();
         if (idx < 0 || idx >= mTests.size()) return;
         mTests[idx].name = mEditTestName->text().trimmed();
         QString err;
         DBManager::instance().addOrUpdateTest(mTests[idx], &err);
-        refreshTestList();
-        mListTests->setCurrentRow(idx);
+        mTestModel->testChanged(idx);
     });
     connect(mEditTestDescription, &QLineEdit::editingFinished, this, [this](){
-        int idx = mListTests->currentRow();
+        int idx = currentTestIndex();
         if (idx < 0 || idx >= mTests.size()) return;
         mTests[idx].description = mEditTestDescription->text().trimmed();
         QString err;
@@ -184,14 +361,40 @@ void MainWindow::buildTeacherUi()
 
     connect(mBtnAddQuestion, &QPushButton::clicked, this, &MainWindow::onAddQuestion);
     connect(mBtnRemoveQuestion, &QPushButton::clicked, this, &MainWindow::onRemoveQuestion);
-    connect(mListQuestions, &QListWidget::currentRowChanged, this, &MainWindow::onQuestionSelected);
+    connect(mBtnFindDuplicates, &QPushButton::clicked, this, &MainWindow::onFindDuplicates);
+    connect(mBtnImportQuestions, &QPushButton::clicked, this, &MainWindow::onImportQuestions);
+    connect(mBtnExportResults, &QPushButton::clicked, this, &MainWindow::onExportResults);
+    connect(mBtnBrowseResults, &QPushButton::clicked, this, &MainWindow::onBrowseResults);
+    connect(mBtnExportPackage, &QPushButton::clicked, this, &MainWindow::onExportExamPackage);
+    connect(mBtnPrintVariants, &QPushButton::clicked, this, &MainWindow::onPrintVariants);
+    connect(mBtnMailResults, &QPushButton::clicked, this, &MainWindow::onMailResults);
+    connect(mBtnBackupNow, &QPushButton::clicked, this, &MainWindow::onBackupNow);
+    connect(mBtnArchiveResults, &QPushButton::clicked, this, &MainWindow::onArchiveResults);
+    connect(mBtnBlueprint, &QPushButton::clicked, this, &MainWindow::onEditBlueprint);
+    connect(mBtnAdaptive, &QPushButton::clicked, this, &MainWindow::onEditAdaptive);
     connect(mComboType, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::onTypeChanged);
     connect(mBtnAddAnswer, &QPushButton::clicked, this, &MainWindow::onAddAnswer);
     connect(mBtnRemoveAnswer, &QPushButton::clicked, this, &MainWindow::onRemoveAnswer);
 
+    // incremental search (debounced like auto-save)
+    mSearchTimer.setSingleShot(true);
+    mSearchTimer.setInterval(200); // ms
+    connect(&mSearchTimer, &QTimer::timeout, this, &MainWindow::runSearch);
+    connect(mEditSearch, &QLineEdit::textChanged, this, [this]() { mSearchTimer.start(); });
+    connect(mListSearchResults, &QListWidget::itemActivated, this, &MainWindow::onSearchHitActivated);
+    connect(mListSearchResults, &QListWidget::itemClicked, this, &MainWindow::onSearchHitActivated);
+    connect(mListSearchResults->verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int v) {
+        if (mSearchHasMore && v == mListSearchResults->verticalScrollBar()->maximum()) loadMoreSearchHits();
+    });
+
     connect(mEditQuestionText, &CustomTextEdit::editingFinished, this, &MainWindow::doAutoSaveWithRefresh);
     // auto-save triggers (debounced)
     connect(mEditExpectedText, &QLineEdit::textChanged, this, &MainWindow::scheduleAutoSave);
+    connect(mEditQuestionTags, &QLineEdit::textChanged, this, &MainWindow::scheduleAutoSave);
+    connect(mEditTemplate, &QPlainTextEdit::textChanged, this, [this]() {
+        updateTemplatePreview();
+        scheduleAutoSave();
+    });
     connect(mTblAnswers, &QTableWidget::itemChanged, this, &MainWindow::answerItemChanged);
 }
 
@@ -201,9 +404,12 @@ void MainWindow::buildStudentUi()
     setCentralWidget(central);
 
     // left: tests list
-    mListTests = new QListWidget;
+    mListTests = new QListView;
     mListTests->setSelectionMode(QAbstractItemView::SingleSelection);
-    connect(mListTests, &QListWidget::currentRowChanged, this, &MainWindow::onTestSelected);
+    mEditTestFilter = new QLineEdit;
+    mEditTestFilter->setPlaceholderText("Hledat test...");
+    mEditTestFilter->setClearButtonEnabled(true);
+    setupListModels();
 
     QVBoxLayout *leftLayout = new QVBoxLayout;
     mEditStudentEmail = new QLineEdit;
@@ -211,26 +417,24 @@ void MainWindow::buildStudentUi()
     leftLayout->addWidget(mEditStudentEmail);
 
     leftLayout->addWidget(new QLabel("Vyber test:"));
+    leftLayout->addWidget(mEditTestFilter);
     leftLayout->addWidget(mListTests);
+    mBtnStudentPractice = new QPushButton("Procvičovat");
+    mBtnStudentPractice->setToolTip("Opakování otázek vybraného testu podle toho, kdy je zapomínáte");
+    leftLayout->addWidget(mBtnStudentPractice);
 
     QWidget *leftWidget = new QWidget; leftWidget->setLayout(leftLayout);
 
     // right: student runner area
     mLblStudentProgress = new QLabel;
-    mLblStudentQuestion = new QLabel;
-    mLblStudentQuestion->setWordWrap(true);
-    mWidgetStudentAnswers = new QWidget;
-    QVBoxLayout *aw = new QVBoxLayout;
-    aw->setContentsMargins(0,0,0,0);
-    mWidgetStudentAnswers->setLayout(aw);
+    mStudentView = new StudentQuestionView;
 
     mBtnStudentNext = new QPushButton("Další");
     mBtnStudentSubmit = new QPushButton("Odevzdat");
 
     QVBoxLayout *rightLayout = new QVBoxLayout;
     rightLayout->addWidget(mLblStudentProgress);
-    rightLayout->addWidget(mLblStudentQuestion);
-    rightLayout->addWidget(mWidgetStudentAnswers);
+    rightLayout->addWidget(mStudentView);
     QHBoxLayout *btns = new QHBoxLayout;
     btns->addWidget(mBtnStudentNext);
     rightLayout->addStretch(1);
@@ -250,32 +454,7 @@ void MainWindow::buildStudentUi()
 
     connect(mBtnStudentNext, &QPushButton::clicked, this, &MainWindow::onStudentNext);
     connect(mBtnStudentSubmit, &QPushButton::clicked, this, &MainWindow::onStudentSubmit);
-}
-
-/* -----------------------------
-   Data / UI helpers
-   ----------------------------*/
-void MainWindow::refreshTestList()
-{
-    if (!mListTests) return;
-    mListTests->clear();
-for (auto &t : std::as_const(mTests)) {
-        mListTests->addItem(t.name);
-    }
-    if (!mTeacherMode && !mTests.isEmpty()) {
-        // select first test by default for student
-        mListTests->setCurrentRow(0);
-    }
-}
-
-void MainWindow::refreshQuestionList()
-{
-    mListQuestions->clear();
-    for (const Question &q : std::as_const(mQuestions)) {
-        QString label = q.text;
-        if (label.length() > 80) label = label.left(77) + "...";
-        mListQuestions->addItem(label);
-    }
+    connect(mBtnStudentPractice, &QPushButton::clicked, this, &MainWindow::onStudentPractice);
 }
 
 /* -----------------------------
@@ -292,10 +471,8 @@ void MainWindow::onAddTest()
     if (!DBManager::instance().addOrUpdateTest(t, &err)) {
         QMessageBox::warning(this, "Chyba při ukládání testu", err);
     } else {
-        mTests.append(t);
-        refreshTestList();
-        int idx = mListTests->count()-1;
-        mListTests->setCurrentRow(idx);
+        mTestModel->appendTest(t);
+        selectTestRow(mTests.size()-1);
         mEditTestName->setText(t.name);
         mEditTestDescription->setText(t.description);
     }
@@ -304,7 +481,7 @@ void MainWindow::onAddTest()
 // Implemented slot: remove currently selected test
 void MainWindow::onRemoveTest()
 {
-    int idx = mListTests->currentRow();
+    int idx = currentTestIndex();
     if (idx < 0 || idx >= mTests.size()) return;
     QString testId = mTests[idx].id;
     QString err;
@@ -312,20 +489,20 @@ void MainWindow::onRemoveTest()
         QMessageBox::warning(this, "Chyba při mazání testu z DB", err);
         return;
     }
-    mTests.removeAt(idx);
-    refreshTestList();
+    // drop selection first so that removing the row does not load a neighbouring test
+    selectTestRow(-1);
+    mTestModel->removeTest(idx);
     // clear editor if in teacher mode
     if (mTeacherMode) {
-        mListQuestions->clear();
+        mQuestionModel->clear();
         mEditTestName->clear();
         mEditTestDescription->clear();
-        mQuestions.clear();
     }
 }
 
 void MainWindow::onAddQuestion()
 {
-    int tidx = mListTests->currentRow();
+    int tidx = currentTestIndex();
     if (tidx < 0) {
         QMessageBox::warning(this, "Žádný test", "Nejprve vyberte nebo vytvořte test.");
         return;
@@ -344,14 +521,13 @@ void MainWindow::onAddQuestion()
     }
 
     // add locally and refresh
-    mQuestions.append(q);
-    refreshQuestionList();
-    mListQuestions->setCurrentRow(mQuestions.size()-1);
+    mQuestionModel->appendQuestion(q);
+    selectQuestionRow(mQuestions.size()-1);
 }
 
 void MainWindow::onRemoveQuestion()
 {
-    int row = mListQuestions->currentRow();
+    int row = currentQuestionRow();
     if (row < 0 || row >= mQuestions.size()) return;
     QString qid = mQuestions[row].id;
     QString err;
@@ -359,13 +535,17 @@ void MainWindow::onRemoveQuestion()
         QMessageBox::warning(this, "Chyba mazání otázky", err);
         return;
     }
-    mQuestions.removeAt(row);
-    refreshQuestionList();
-    if (!mQuestions.isEmpty()) mListQuestions->setCurrentRow(qMin(row, mQuestions.size()-1));
+    selectQuestionRow(-1);
+    mQuestionModel->removeQuestion(row);
+    if (!mQuestions.isEmpty()) selectQuestionRow(qMin(row, mQuestions.size()-1));
     else {
         mEditQuestionText->clear();
         mTblAnswers->setRowCount(0);
         mEditExpectedText->clear();
+        mEditQuestionTags->clear();
+        mQuestionTags.clear();
+        mEditTemplate->clear();
+        mQuestionTemplate.clear();
     }
 }
 
@@ -393,9 +573,68 @@ void MainWindow::loadQuestionIntoEditor(int index)
         mTblAnswers->setItem(r, 1, c);
     }
     mEditExpectedText->setText(q.expectedText);
+    QString err;
+    if (!DBManager::instance().questionTags(q.id, &mQuestionTags, &err)) {
+        qDebug() << "Failed to load question tags:" << err;
+        mQuestionTags.clear();
+    }
+    {
+        const QSignalBlocker blocker(mEditQuestionTags);
+        mEditQuestionTags->setText(mQuestionTags.join(", "));
+    }
+    if (!DBManager::instance().loadQuestionTemplate(q.id, &mQuestionTemplate, &err)) {
+        qDebug() << "Failed to load question template:" << err;
+        mQuestionTemplate.clear();
+    }
+    {
+        const QSignalBlocker blocker(mEditTemplate);
+        mEditTemplate->setPlainText(mQuestionTemplate);
+    }
+    updateTemplatePreview();
     onTypeChanged(static_cast<int>(q.type));
 }
 
+/* one random instance of the edited template, or the compile error */
+void MainWindow::updateTemplatePreview()
+{
+    const QString definition = mEditTemplate->toPlainText();
+    if (definition.trimmed().isEmpty()) {
+        mLblTemplatePreview->clear();
+        return;
+    }
+    QuestionTemplate tpl;
+    QString err;
+    if (!tpl.compile(definition, &err)) {
+        mLblTemplatePreview->setText("Chyba: " + err);
+        return;
+    }
+    Question q;
+    q.text = mEditQuestionText->toPlainText();
+    q.type = static_cast<QuestionType>(mComboType->currentIndex());
+    Question inst;
+    if (!tpl.instantiate(q, QRandomGenerator::global()->generate(), &inst)) {
+        mLblTemplatePreview->setText(QString("Podmínky se nepodařilo splnit ani po %1 pokusech.").arg(QuestionTemplate::MaxTries));
+        return;
+    }
+    QString preview = "Ukázka: " + inst.text.simplified();
+    if (q.type == QuestionType::TextAnswer) preview += "  →  " + inst.expectedText;
+    mLblTemplatePreview->setText(preview);
+}
+
+static QStringList parseTagList(const QString &text)
+{
+    QStringList paths;
+    for (const QString &part : text.split(',')) {
+        QStringList levels;
+        for (const QString &level : part.split('/')) {
+            if (!level.trimmed().isEmpty()) levels.append(level.trimmed());
+        }
+        if (!levels.isEmpty() && !paths.contains(levels.join('/'))) paths.append(levels.join('/'));
+    }
+    paths.sort();
+    return paths;
+}
+
 void MainWindow::onTypeChanged(int idx)
 {
     bool isChoice = (idx == 0 || idx == 1);
@@ -434,16 +673,52 @@ void MainWindow::scheduleAutoSave()
 {
     // restart timer
     mAutoSaveTimer.start();
+    if (mMaintenance) mMaintenance->notifyActivity();
 }
 
 bool MainWindow::doAutoSave()
 {
     // determine current selected question and persist to DB
-    int qidx = mListQuestions ? mListQuestions->currentRow() : -1;
+    int qidx = currentQuestionRow();
     if (mTeacherMode && qidx >= 0 && qidx < mQuestions.size()) {
         collectEditorToQuestion(qidx);
         QString err;
-        bool autosave = DBManager::instance().addOrUpdateQuestion(mQuestions[qidx], &err);
+        // unsaved edits of the test header go in the same unit of work (one commit)
+        DbTransaction tx(&err);
+        bool autosave = tx.isActive();
+        int tidx = currentTestIndex();
+        bool testEdited = false;
+        Test t;
+        if (autosave && tidx >= 0 && tidx < mTests.size()) {
+            // the list shows the new header only once the unit of work has committed
+            t = mTests[tidx];
+            const QString name = mEditTestName->text().trimmed();
+            const QString description = mEditTestDescription->text().trimmed();
+            if (t.name != name || t.description != description) {
+                t.name = name;
+                t.description = description;
+                testEdited = true;
+                autosave = DBManager::instance().addOrUpdateTest(t, &err);
+            }
+        }
+        autosave = autosave && DBManager::instance().addOrUpdateQuestion(mQuestions[qidx], &err);
+        const QStringList tags = parseTagList(mEditQuestionTags->text());
+        if (autosave && tags != mQuestionTags) {
+            autosave = DBManager::instance().setQuestionTags(mQuestions[qidx].id, tags, &err);
+        }
+        const QString definition = mEditTemplate->toPlainText().trimmed();
+        if (autosave && definition != mQuestionTemplate) {
+            autosave = DBManager::instance().setQuestionTemplate(mQuestions[qidx].id, definition, &err);
+        }
+        autosave = autosave && tx.commit(&err);
+        if (autosave) {
+            mQuestionTags = tags;
+            mQuestionTemplate = definition;
+            if (testEdited) {
+                mTests[tidx] = t;
+                mTestModel->testChanged(tidx);
+            }
+        }
         if (!autosave) {
             QMessageBox::warning(this, "Chyba při auto-ukládání otázky", err);
         }
@@ -455,18 +730,15 @@ bool MainWindow::doAutoSave()
 void MainWindow::doAutoSaveWithRefresh()
 {
     if (doAutoSave()) {
-        // refresh question list to reflect any text changes
-        refreshQuestionList();
-        int qidx = mListQuestions ? mListQuestions->currentRow() : -1;
-        if (mListQuestions )
-            mListQuestions->setCurrentRow(qidx);
+        // refresh the edited row to reflect any text changes
+        mQuestionModel->questionChanged(currentQuestionRow());
     }
 }
 
 
 void MainWindow::answerItemChanged(QTableWidgetItem *item)
 {
-    int qidx = mListQuestions ? mListQuestions->currentRow() : -1;
+    int qidx = currentQuestionRow();
     if (mTeacherMode && qidx >= 0 && qidx < mQuestions.size()) {
         QuestionType qt = static_cast<QuestionType>(mComboType->currentIndex());
         if (qt == QuestionType::SingleChoice) {
@@ -495,6 +767,793 @@ void MainWindow::answerItemChanged(QTableWidgetItem *item)
     scheduleAutoSave();
 }
 
+/* -----------------------------
+   Full-text search
+   ----------------------------*/
+static const int SearchPageSize = 50;
+
+void MainWindow::runSearch()
+{
+    mListSearchResults->clear();
+    mSearchText = mEditSearch->text().trimmed();
+    mSearchHasMore = false;
+    if (mSearchText.isEmpty()) {
+        mListSearchResults->hide();
+        return;
+    }
+    mListSearchResults->show();
+    loadMoreSearchHits();
+}
+
+void MainWindow::loadMoreSearchHits()
+{
+    QVector<DBManager::SearchHit> hits;
+    QString err;
+    if (!DBManager::instance().searchQuestions(mSearchText, QString(), mListSearchResults->count(),
+                                               SearchPageSize, hits, &err)) {
+        mSearchHasMore = false;
+        mListSearchResults->addItem(err);
+        return;
+    }
+    mSearchHasMore = (hits.size() == SearchPageSize);
+    for (const DBManager::SearchHit &h : std::as_const(hits)) {
+        QListWidgetItem *it = new QListWidgetItem(QString("%1: %2").arg(h.testName, h.snippet));
+        it->setData(Qt::UserRole, h.testId);
+        it->setData(Qt::UserRole + 1, h.questionId);
+        mListSearchResults->addItem(it);
+    }
+}
+
+void MainWindow::onSearchHitActivated(QListWidgetItem *item)
+{
+    if (!item) return;
+    QString testId = item->data(Qt::UserRole).toString();
+    QString questionId = item->data(Qt::UserRole + 1).toString();
+    if (questionId.isEmpty()) return;
+
+    if (currentTestId() != testId) {
+        int row = mTestModel->rowOfId(testId);
+        if (row < 0 && !mTestModel->nameFilter().isEmpty()) {
+            // hidden by the test filter
+            mEditTestFilter->clear();
+            applyTestFilter();
+            row = mTestModel->rowOfId(testId);
+        }
+        if (row >= 0) selectTestRow(row);
+    }
+    // question may be on a page that is not loaded yet
+    int row = mQuestionModel->rowOfId(questionId);
+    if (row >= 0) {
+        selectQuestionRow(row);
+        mListQuestions->scrollTo(mQuestionModel->index(row));
+    }
+}
+
+/* bulk import of a question bank file into the selected test */
+void MainWindow::onImportQuestions()
+{
+    int tidx = currentTestIndex();
+    if (tidx < 0 || tidx >= mTests.size()) {
+        QMessageBox::warning(this, "Žádný test", "Nejprve vyberte nebo vytvořte test.");
+        return;
+    }
+    QString path = QFileDialog::getOpenFileName(this, "Import otázek", QString(),
+                                                "Otázky (*.csv *.json *.jsonl *.xml);;Všechny soubory (*)");
+    if (path.isEmpty()) return;
+
+    QuestionImporter::Stats stats;
+    QString err;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool ok = QuestionImporter::importFile(path, mTests[tidx].id, &stats, &err);
+    QApplication::restoreOverrideCursor();
+    if (!ok) {
+        QMessageBox::warning(this, "Import se nezdařil", err);
+        return;
+    }
+
+    QString loadErr;
+    if (!mQuestionModel->loadTest(mTests[tidx].id, &loadErr)) {
+        QMessageBox::warning(this, "Chyba při načítání otázek z DB", loadErr);
+    }
+    QString msg = QString("Importováno otázek: %1\nPřeskočeno: %2").arg(stats.imported).arg(stats.skipped);
+    if (!stats.warnings.isEmpty())
+        msg += "\n\n" + stats.warnings.mid(0, 20).join("\n");
+    QMessageBox::information(this, "Import otázek", msg);
+}
+
+/* results of the selected test (or all tests) to CSV / binary file */
+void MainWindow::onExportResults()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Export výsledků", QString(),
+                                                "CSV (*.csv);;Binární sloupcový formát (*.qtr)");
+    if (path.isEmpty()) return;
+
+    DBManager::ResultFilter filter;
+    filter.testId = currentTestId();
+    filter.includeArchived = true;
+    qint64 count = 0;
+    QString err;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool ok = ResultExporter::exportResults(path, ResultExporter::formatForFile(path), filter, &count, &err);
+    QApplication::restoreOverrideCursor();
+    if (!ok) {
+        QMessageBox::warning(this, "Export se nezdařil", err);
+        return;
+    }
+    QMessageBox::information(this, "Export výsledků", QString("Exportováno výsledků: %1").arg(count));
+}
+
+/* move old results into per-term archive DBs */
+void MainWindow::onArchiveResults()
+{
+    bool ok = false;
+    QString cutoff = QInputDialog::getText(this, "Archivace výsledků", "Archivovat výsledky starší než (RRRR-MM-DD):",
+                                           QLineEdit::Normal, QDate::currentDate().addYears(-1).toString(Qt::ISODate), &ok).trimmed();
+    if (!ok) return;
+    if (!QDate::fromString(cutoff, Qt::ISODate).isValid()) {
+        QMessageBox::warning(this, "Archivace výsledků", "Neplatné datum: " + cutoff);
+        return;
+    }
+    qint64 moved = 0;
+    QString err;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    ok = DBManager::instance().archiveResults(cutoff, &moved, &err);
+    QApplication::restoreOverrideCursor();
+    if (!ok) {
+        QMessageBox::warning(this, "Archivace se nezdařila", err);
+        return;
+    }
+    QMessageBox::information(this, "Archivace výsledků",
+                             QString("Archivováno výsledků: %1\nArchivy: %2").arg(moved).arg(DBManager::instance().archiveDirectory()));
+}
+
+/* blueprint of the current test: how many questions to draw from each tag */
+void MainWindow::onEditBlueprint()
+{
+    const QString testId = currentTestId();
+    if (testId.isEmpty()) {
+        QMessageBox::information(this, "Plán testu", "Vyberte test.");
+        return;
+    }
+    QVector<DBManager::BlueprintRule> rules;
+    QVector<DBManager::Tag> tags;
+    QString err;
+    if (!DBManager::instance().loadBlueprint(testId, rules, &err) || !DBManager::instance().loadTags(tags, &err)) {
+        QMessageBox::warning(this, "Plán testu", err);
+        return;
+    }
+
+    QDialog dlg(this);
+    dlg.setWindowTitle("Plán testu");
+    QTableWidget *table = new QTableWidget(0, 2);
+    table->setHorizontalHeaderLabels({ "Štítek", "Počet" });
+    table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    table->verticalHeader()->hide();
+    auto addRow = [table](const QString &tagPath, int count) {
+        const int r = table->rowCount();
+        table->insertRow(r);
+        table->setItem(r, 0, new QTableWidgetItem(tagPath));
+        QSpinBox *spin = new QSpinBox;
+        spin->setRange(1, 1000);
+        spin->setValue(count);
+        table->setCellWidget(r, 1, spin);
+    };
+    for (const DBManager::BlueprintRule &r : std::as_const(rules)) addRow(r.tagPath, r.count);
+
+    QPushButton *btnAdd = new QPushButton("Přidat pravidlo");
+    QPushButton *btnRemove = new QPushButton("Odstranit pravidlo");
+    connect(btnAdd, &QPushButton::clicked, &dlg, [&]() {
+        addRow(QString(), 1);
+        table->editItem(table->item(table->rowCount() - 1, 0));
+    });
+    connect(btnRemove, &QPushButton::clicked, &dlg, [&]() {
+        if (table->currentRow() >= 0) table->removeRow(table->currentRow());
+    });
+
+    QStringList known;
+    for (const DBManager::Tag &t : std::as_const(tags)) known.append(t.path);
+    QLabel *hint = new QLabel("Otázky se losují nejdříve podle pravidel (štítek zahrnuje i podřízené štítky), "
+                              "zbytek do počtu otázek pro studenta náhodně z celého testu.\n"
+                              "Existující štítky: " + (known.isEmpty() ? QString("žádné") : known.join(", ")));
+    hint->setWordWrap(true);
+
+    QHBoxLayout *btns = new QHBoxLayout;
+    btns->addWidget(btnAdd);
+    btns->addWidget(btnRemove);
+    QDialogButtonBox *box = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    connect(box, &QDialogButtonBox::accepted, &dlg, &QDialog::accept);
+    connect(box, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
+    QVBoxLayout *lay = new QVBoxLayout;
+    lay->addWidget(table, 1);
+    lay->addLayout(btns);
+    lay->addWidget(hint);
+    lay->addWidget(box);
+    dlg.setLayout(lay);
+    dlg.resize(500, 400);
+    if (dlg.exec() != QDialog::Accepted) return;
+
+    rules.clear();
+    for (int r = 0; r < table->rowCount(); ++r) {
+        DBManager::BlueprintRule rule;
+        rule.tagPath = table->item(r, 0) ? table->item(r, 0)->text().trimmed() : QString();
+        rule.count = static_cast<QSpinBox *>(table->cellWidget(r, 1))->value();
+        if (!rule.tagPath.isEmpty()) rules.append(rule);
+    }
+    if (!DBManager::instance().saveBlueprint(testId, rules, &err)) {
+        QMessageBox::warning(this, "Plán testu", err);
+    }
+}
+
+/* adaptive mode of the current test and calibration of its questions from past results */
+void MainWindow::onEditAdaptive()
+{
+    const QString testId = currentTestId();
+    if (testId.isEmpty()) {
+        QMessageBox::information(this, "Adaptivní test", "Vyberte test.");
+        return;
+    }
+    DBManager::AdaptiveSettings settings;
+    QVector<DBManager::ItemParams> params;
+    QString err;
+    if (!DBManager::instance().loadAdaptiveSettings(testId, &settings, &err)
+        || !DBManager::instance().loadItemParams(testId, params, &err)) {
+        QMessageBox::warning(this, "Adaptivní test", err);
+        return;
+    }
+
+    QDialog dlg(this);
+    dlg.setWindowTitle("Adaptivní test");
+    QCheckBox *chkEnabled = new QCheckBox("Adaptivní testování (další otázka podle dosavadních odpovědí)");
+    chkEnabled->setChecked(settings.enabled);
+    QSpinBox *spinMin = new QSpinBox;
+    spinMin->setRange(1, 1000);
+    spinMin->setValue(settings.minItems);
+    QDoubleSpinBox *spinSe = new QDoubleSpinBox;
+    spinSe->setRange(0.1, 1.0);
+    spinSe->setSingleStep(0.05);
+    spinSe->setValue(settings.targetSe);
+    QLabel *info = new QLabel;
+    info->setWordWrap(true);
+    auto showInfo = [&]() {
+        info->setText(QString("Test končí, když je úroveň studenta odhadnuta s chybou nejvýše %1 "
+                              "(po nejméně %2 otázkách), nejpozději po %3 otázkách (počet otázek pro studenta).\n"
+                              "Kalibrováno otázek: %4. Nekalibrované otázky se berou jako středně těžké.")
+                          .arg(spinSe->value()).arg(spinMin->value()).arg(mSpinStudentCount->value()).arg(params.size()));
+    };
+    connect(spinMin, QOverload<int>::of(&QSpinBox::valueChanged), &dlg, showInfo);
+    connect(spinSe, QOverload<double>::of(&QDoubleSpinBox::valueChanged), &dlg, showInfo);
+    showInfo();
+
+    QPushButton *btnCalibrate = new QPushButton("Kalibrovat z výsledků");
+    connect(btnCalibrate, &QPushButton::clicked, &dlg, [&]() {
+        QString cerr;
+        int count = 0;
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        const bool ok = DBManager::instance().calibrateItems(testId, &count, &cerr)
+                        && DBManager::instance().loadItemParams(testId, params, &cerr);
+        QApplication::restoreOverrideCursor();
+        if (!ok) QMessageBox::warning(&dlg, "Kalibrace", cerr);
+        showInfo();
+    });
+
+    QHBoxLayout *form1 = new QHBoxLayout;
+    form1->addWidget(new QLabel("Nejméně otázek:"));
+    form1->addWidget(spinMin);
+    form1->addWidget(new QLabel("Cílová chyba odhadu:"));
+    form1->addWidget(spinSe);
+    QDialogButtonBox *box = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    connect(box, &QDialogButtonBox::accepted, &dlg, &QDialog::accept);
+    connect(box, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
+    QVBoxLayout *lay = new QVBoxLayout;
+    lay->addWidget(chkEnabled);
+    lay->addLayout(form1);
+    lay->addWidget(info);
+    lay->addWidget(btnCalibrate);
+    lay->addWidget(box);
+    dlg.setLayout(lay);
+    if (dlg.exec() != QDialog::Accepted) return;
+
+    settings.enabled = chkEnabled->isChecked();
+    settings.minItems = spinMin->value();
+    settings.targetSe = spinSe->value();
+    if (!DBManager::instance().saveAdaptiveSettings(testId, settings, &err)) {
+        QMessageBox::warning(this, "Adaptivní test", err);
+    }
+}
+
+/* saved results, newest first; pages are loaded while scrolling, details of the selected row on demand */
+void MainWindow::onBrowseResults()
+{
+    QDialog dlg(this);
+    dlg.setWindowTitle("Výsledky");
+
+    QComboBox *testCombo = new QComboBox;
+    testCombo->addItem("Všechny testy", QString());
+    for (const Test &t : std::as_const(mTests)) testCombo->addItem(t.name, t.id);
+    const int cur = testCombo->findData(currentTestId());
+    if (cur > 0) testCombo->setCurrentIndex(cur);
+    QLineEdit *emailEdit = new QLineEdit;
+    emailEdit->setPlaceholderText("E-mail studenta");
+    emailEdit->setClearButtonEnabled(true);
+
+    ResultsTableModel *model = new ResultsTableModel(&dlg);
+    QTableView *table = new QTableView;
+    table->setModel(model);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->setSelectionMode(QAbstractItemView::SingleSelection);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->verticalHeader()->hide();
+    // fixed row height: the view never measures rows it does not show
+    table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    table->horizontalHeader()->setStretchLastSection(true);
+    table->setColumnWidth(ResultsTableModel::TimeColumn, 130);
+    table->setColumnWidth(ResultsTableModel::StudentColumn, 220);
+    table->setColumnWidth(ResultsTableModel::TestColumn, 220);
+
+    QTableWidget *details = new QTableWidget(0, 3);
+    details->setHorizontalHeaderLabels({ "Otázka", "Odpověď", "Správně" });
+    details->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    details->verticalHeader()->hide();
+    details->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    details->setMaximumHeight(200);
+    QLabel *status = new QLabel;
+
+    auto applyFilter = [&]() {
+        DBManager::ResultFilter filter;
+        filter.testId = testCombo->currentData().toString();
+        filter.studentEmail = emailEdit->text().trimmed();
+        details->setRowCount(0);
+        QString err;
+        status->setText(model->setFilter(filter, &err) ? QString() : err);
+    };
+    connect(testCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), &dlg, applyFilter);
+    connect(emailEdit, &QLineEdit::returnPressed, &dlg, applyFilter);
+    connect(emailEdit, &QLineEdit::textChanged, &dlg, [&](const QString &text) { if (text.isEmpty()) applyFilter(); });
+    connect(table->selectionModel(), &QItemSelectionModel::currentRowChanged, &dlg, [&](const QModelIndex &index) {
+        details->setRowCount(0);
+        const DBManager::ResultRow *r = model->row(index.row());
+        if (!r) return;
+        QVector<DBManager::ResultDetailRow> rows;
+        QString err;
+        if (!DBManager::instance().loadResultDetails(r->id, rows, &err)) {
+            status->setText(err);
+            return;
+        }
+        details->setRowCount(rows.size());
+        for (int i = 0; i < rows.size(); ++i) {
+            const DBManager::ResultDetailRow &d = rows[i];
+            details->setItem(i, 0, new QTableWidgetItem(d.questionText.isEmpty() ? "(smazaná otázka)" : d.questionText.simplified()));
+            details->setItem(i, 1, new QTableWidgetItem(d.userAnswer));
+            details->setItem(i, 2, new QTableWidgetItem(d.correct ? "ano" : "ne"));
+        }
+        status->setText(QString("%1: %2 otázek").arg(r->studentEmail).arg(rows.size()));
+    });
+    applyFilter();
+
+    QHBoxLayout *filters = new QHBoxLayout;
+    filters->addWidget(testCombo, 1);
+    filters->addWidget(emailEdit, 1);
+    QDialogButtonBox *box = new QDialogButtonBox(QDialogButtonBox::Close);
+    connect(box, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
+    QVBoxLayout *lay = new QVBoxLayout;
+    lay->addLayout(filters);
+    lay->addWidget(table, 1);
+    lay->addWidget(details);
+    lay->addWidget(status);
+    lay->addWidget(box);
+    dlg.setLayout(lay);
+    dlg.resize(900, 650);
+    dlg.exec();
+}
+
+/* test catalog filtered by name; the open test (or running attempt) is not touched */
+void MainWindow::applyTestFilter()
+{
+    const QString filter = mEditTestFilter->text().trimmed();
+    if (filter == mTestModel->nameFilter() || !DBManager::instance().isOpen()) return;
+    if (mAutoSaveTimer.isActive()) {
+        mAutoSaveTimer.stop();
+        doAutoSave();
+    }
+    reloadTestCatalog(filter);
+}
+
+/* catalog from its first page, the open test stays selected */
+void MainWindow::reloadTestCatalog(const QString &filter)
+{
+    const QString testId = currentTestId();
+    QString err;
+    {
+        // the reset must not look like selecting another test
+        const QSignalBlocker blocker(mListTests->selectionModel());
+        if (!mTestModel->loadCatalog(filter, &err)) qDebug() << "Loading test catalog failed:" << err;
+        for (int i = 0; i < mTests.size(); ++i) {
+            if (mTests[i].id == testId) { selectTestRow(i); break; }
+        }
+    }
+    // the teacher's editor must not keep editing a test that is not in the list
+    if (mTeacherMode && !testId.isEmpty() && currentTestId() != testId) onTestSelected(-1);
+}
+
+/* -----------------------------
+   Changes committed by other processes (DbChangeBus)
+   ----------------------------*/
+void MainWindow::onDatabaseChanged(const QVector<DBManager::Change> &changes, bool external)
+{
+    // question counts / attempts / averages of the affected catalog rows, also after own writes
+    QSet<QString> statsOf;
+    bool allStats = false;
+    for (const DBManager::Change &c : changes) {
+        if (c.table != "questions" && c.table != "results" && c.table != "*") continue;
+        if (c.testId.isEmpty()) allStats = true;
+        else statsOf.insert(c.testId);
+    }
+    QString err;
+    if (allStats) {
+        if (!mTestModel->refreshStatistics(QString(), &err)) qDebug() << "Refreshing test statistics failed:" << err;
+    } else {
+        for (const QString &testId : std::as_const(statsOf)) {
+            if (!mTestModel->refreshStatistics(testId, &err)) qDebug() << "Refreshing test statistics failed:" << err;
+        }
+    }
+
+    // own writes are already in the models
+    if (!external) return;
+    for (const DBManager::Change &c : changes) {
+        if (c.table == "*") {
+            mergeTestsFromDb();
+            // rowids may have changed (VACUUM): the catalog cursor of later pages is stale
+            if (!mTestModel->allFetched()) reloadTestCatalog(mTestModel->nameFilter());
+            if (mTeacherMode) reloadQuestions();
+            return;
+        }
+        if (c.table == "tests") {
+            applyTestChange(c.key);
+        } else if (c.table == "questions" && mTeacherMode && !c.testId.isEmpty() && c.testId == currentTestId()) {
+            if (c.op == DBManager::Change::Reset) reloadQuestions();
+            else applyQuestionChange(c.key);
+        }
+    }
+}
+
+void MainWindow::applyTestChange(const QString &testId)
+{
+    Test t;
+    bool found = false;
+    QString err;
+    if (!DBManager::instance().loadTest(testId, &t, &found, &err)) {
+        qDebug() << "Loading changed test failed:" << err;
+        return;
+    }
+    if (found) {
+        upsertTestRow(t);
+        return;
+    }
+    for (int i = 0; i < mTests.size(); ++i) {
+        if (mTests[i].id == testId) { removeTestRow(i); break; }
+    }
+}
+
+void MainWindow::upsertTestRow(const Test &t)
+{
+    int row = -1;
+    for (int i = 0; i < mTests.size(); ++i) {
+        if (mTests[i].id == t.id) { row = i; break; }
+    }
+    if (row < 0) {
+        // not loaded yet (a later page brings it) or hidden by the name filter
+        const QString filter = mTestModel->nameFilter();
+        if (mTestModel->allFetched() && (filter.isEmpty() || t.name.contains(filter, Qt::CaseInsensitive)))
+            mTestModel->appendTest(t);
+        return;
+    }
+    mTests[row] = t;
+    mTestModel->testChanged(row);
+    if (mTeacherMode && row == currentTestIndex()) {
+        if (!mEditTestName->hasFocus()) mEditTestName->setText(t.name);
+        if (!mEditTestDescription->hasFocus()) mEditTestDescription->setText(t.description);
+        // valueChanged would write the value straight back
+        const QSignalBlocker blocker(mSpinStudentCount);
+        mSpinStudentCount->setValue(t.studentCount);
+    }
+}
+
+void MainWindow::removeTestRow(int row)
+{
+    if (row < 0 || row >= mTests.size()) return;
+    if (row == currentTestIndex()) {
+        // a running attempt is not interrupted, the test just cannot be started again
+        if (!mTeacherMode) return;
+        selectTestRow(-1);
+        mQuestionModel->clear();
+        mEditTestName->clear();
+        mEditTestDescription->clear();
+    }
+    mTestModel->removeTest(row);
+}
+
+// after a Reset: rows are updated in place, so selection and a running attempt survive
+void MainWindow::mergeTestsFromDb()
+{
+    QVector<Test> fresh;
+    QString err;
+    if (!DBManager::instance().loadTests(fresh, &err)) {
+        qDebug() << "Reloading tests failed:" << err;
+        return;
+    }
+    QSet<QString> ids;
+    for (const Test &t : std::as_const(fresh)) ids.insert(t.id);
+    for (int i = mTests.size() - 1; i >= 0; --i) {
+        if (!ids.contains(mTests[i].id)) removeTestRow(i);
+    }
+    for (const Test &t : std::as_const(fresh)) upsertTestRow(t);
+}
+
+void MainWindow::applyQuestionChange(const QString &questionId)
+{
+    Question q;
+    bool found = false;
+    QString err;
+    if (!DBManager::instance().loadQuestion(questionId, &q, &found, &err)) {
+        qDebug() << "Loading changed question failed:" << err;
+        return;
+    }
+    int row = -1;
+    for (int i = 0; i < mQuestions.size(); ++i) {
+        if (mQuestions[i].id == questionId) { row = i; break; }
+    }
+    const bool current = (row >= 0 && row == currentQuestionRow());
+
+    if (!found || q.testId != currentTestId()) {
+        if (row < 0) return;
+        if (current) selectQuestionRow(-1);
+        mQuestionModel->removeQuestion(row);
+        if (current) {
+            if (!mQuestions.isEmpty()) selectQuestionRow(qMin(row, mQuestions.size()-1));
+            else {
+                mEditQuestionText->clear();
+                mTblAnswers->setRowCount(0);
+                mEditExpectedText->clear();
+                mEditQuestionTags->clear();
+                mQuestionTags.clear();
+                mEditTemplate->clear();
+                mQuestionTemplate.clear();
+            }
+        }
+        return;
+    }
+    if (row < 0) {
+        // not loaded yet: a later page brings it
+        if (!mQuestionModel->canFetchMore(QModelIndex())) mQuestionModel->appendQuestion(q);
+        return;
+    }
+    // unsaved local edits win, the auto-save overwrites the row anyway
+    if (current && mAutoSaveTimer.isActive()) return;
+    mQuestions[row] = q;
+    mQuestionModel->questionChanged(row);
+    if (current) {
+        loadQuestionIntoEditor(row);
+        mAutoSaveTimer.stop(); // nothing was edited here, do not write the row back
+    }
+}
+
+void MainWindow::reloadQuestions()
+{
+    const QString testId = currentTestId();
+    if (testId.isEmpty()) return;
+    if (mAutoSaveTimer.isActive()) {
+        mAutoSaveTimer.stop();
+        doAutoSave();
+    }
+    int row = currentQuestionRow();
+    const QString questionId = (row >= 0 && row < mQuestions.size()) ? mQuestions[row].id : QString();
+    QString err;
+    if (!mQuestionModel->loadTest(testId, &err)) {
+        qDebug() << "Reloading questions failed:" << err;
+        return;
+    }
+    row = questionId.isEmpty() ? -1 : mQuestionModel->rowOfId(questionId);
+    if (row < 0 && !mQuestions.isEmpty()) row = 0;
+    selectQuestionRow(row);
+    if (row >= 0) loadQuestionIntoEditor(row);
+    mAutoSaveTimer.stop();
+}
+
+/* immutable exam package of the selected test for student kiosks */
+void MainWindow::onExportExamPackage()
+{
+    int tidx = currentTestIndex();
+    if (tidx < 0 || tidx >= mTests.size()) {
+        QMessageBox::warning(this, "Žádný test", "Nejprve vyberte test.");
+        return;
+    }
+    QString path = QFileDialog::getSaveFileName(this, "Export balíčku testu", mTests[tidx].name + ".qtp",
+                                                "Balíček testu (*.qtp)");
+    if (path.isEmpty()) return;
+
+    QVector<Question> questions;
+    QString err;
+    QStringList ids;
+    QHash<QString, QString> definitions;
+    bool ok = DBManager::instance().loadQuestionsForTest(mTests[tidx].id, questions, &err);
+    if (ok) {
+        for (const Question &q : std::as_const(questions)) ids.append(q.id);
+        ok = DBManager::instance().loadQuestionTemplates(ids, &definitions, &err);
+    }
+    // the package format has no templates: parametric questions get one fixed instance
+    for (Question &q : questions) {
+        auto it = definitions.constFind(q.id);
+        if (it == definitions.constEnd()) continue;
+        Question inst;
+        if (compiledTemplate(it.value()).instantiate(q, QuestionTemplate::seedFor(mTests[tidx].id, q.id), &inst)) q = inst;
+    }
+    if (!ok || !ExamPackage::write(path, mTests[tidx], questions, &err)) {
+        QMessageBox::warning(this, "Export balíčku se nezdařil", err);
+        return;
+    }
+    QMessageBox::information(this, "Export balíčku",
+                             QString("Balíček s %1 otázkami uložen.\nStudent: QtTestMaker --package \"%2\"")
+                                 .arg(questions.size()).arg(path));
+}
+
+/* paper exam: N variants drawn like host attempts, rendered to PDF on all cores */
+void MainWindow::onPrintVariants()
+{
+    int tidx = currentTestIndex();
+    if (tidx < 0 || tidx >= mTests.size()) {
+        QMessageBox::warning(this, "Žádný test", "Nejprve vyberte test.");
+        return;
+    }
+    if (mPrinter && mPrinter->isRunning()) {
+        statusBar()->showMessage("Tisk variant právě probíhá...", 5000);
+        return;
+    }
+    bool ok = false;
+    VariantPrinter::Options o;
+    o.count = QInputDialog::getInt(this, "Tisk variant", "Počet variant:", 30, 1, 100000, 1, &ok);
+    if (!ok) return;
+    o.directory = QFileDialog::getExistingDirectory(this, "Složka pro PDF variant");
+    if (o.directory.isEmpty()) return;
+
+    ExamSessionManager::QuestionBank bank;
+    QString err;
+    if (!ExamHostServer::loadBank(mTests[tidx].id, &bank, &err)) {
+        QMessageBox::warning(this, "Tisk variant se nezdařil", err);
+        return;
+    }
+    if (!mPrinter) mPrinter = new VariantPrinter(this);
+    auto *dlg = new QProgressDialog("Vytvářím PDF variant...", "Zrušit", 0, o.count, this);
+    dlg->setAttribute(Qt::WA_DeleteOnClose);
+    dlg->setMinimumDuration(500);
+    connect(dlg, &QProgressDialog::canceled, mPrinter, &VariantPrinter::cancel);
+    connect(mPrinter, &VariantPrinter::progress, dlg, &QProgressDialog::setValue);
+    connect(mPrinter, &VariantPrinter::finished, dlg, [this, dlg, o](bool ok, const QString &msg) {
+        dlg->close();
+        if (ok) QMessageBox::information(this, "Tisk variant", QString("%1 variant s klíči uloženo do\n%2").arg(o.count).arg(msg));
+        else QMessageBox::warning(this, "Tisk variant se nezdařil", msg);
+    });
+    mPrinter->start(bank, o);
+}
+
+/* result reports of the selected test (or all tests) into the mail queue */
+void MainWindow::onMailResults()
+{
+    if (!mMailQueue) return;
+    int tidx = currentTestIndex();
+    MailQueue::Options o = mMailQueue->options();
+
+    QDialog dlg(this);
+    dlg.setWindowTitle("Rozeslat výsledky e-mailem");
+    auto *form = new QVBoxLayout(&dlg);
+    auto *transportEdit = new QLineEdit(o.transport);
+    transportEdit->setPlaceholderText("smtp://server:25, smtps://uzivatel@server, file:///slozka");
+    auto *fromEdit = new QLineEdit(o.from);
+    fromEdit->setPlaceholderText("skola@example.cz");
+    auto *rateSpin = new QSpinBox;
+    rateSpin->setRange(1, 1000);
+    rateSpin->setValue(o.perMinute);
+    auto *onlyTest = new QCheckBox(tidx >= 0 && tidx < mTests.size()
+                                       ? QString("Jen test \"%1\"").arg(mTests[tidx].name) : QString("Jen vybraný test"));
+    onlyTest->setEnabled(tidx >= 0 && tidx < mTests.size());
+    onlyTest->setChecked(onlyTest->isEnabled());
+    form->addWidget(new QLabel("Odesílání (heslo SMTP lze zadat v QTTESTMAKER_SMTP_PASSWORD):"));
+    form->addWidget(transportEdit);
+    form->addWidget(new QLabel("Odesílatel:"));
+    form->addWidget(fromEdit);
+    form->addWidget(new QLabel("Nejvýše e-mailů za minutu:"));
+    form->addWidget(rateSpin);
+    form->addWidget(onlyTest);
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    form->addWidget(buttons);
+    connect(buttons, &QDialogButtonBox::accepted, &dlg, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
+    if (dlg.exec() != QDialog::Accepted) return;
+
+    QString err;
+    o.transport = transportEdit->text().trimmed();
+    o.from = fromEdit->text().trimmed();
+    o.perMinute = rateSpin->value();
+    if (!MailTransport::create(o.transport, o.from, &err)) {
+        QMessageBox::warning(this, "Rozeslání výsledků", err);
+        return;
+    }
+    DBManager::ResultFilter filter;
+    if (onlyTest->isChecked()) filter.testId = mTests[tidx].id;
+    int queued = 0, skipped = 0, pending = 0, failed = 0;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const bool ok = ResultReport::queueReports(filter, &queued, &skipped, &err)
+                    && DBManager::instance().mailQueueCounts(&pending, &failed, &err);
+    QApplication::restoreOverrideCursor();
+    if (!ok) {
+        QMessageBox::warning(this, "Rozeslání výsledků", err);
+        return;
+    }
+    mMailQueue->stop();
+    mMailQueue->setOptions(o);
+    mMailQueue->start();
+    QMessageBox::information(this, "Rozeslání výsledků",
+                             QString("Nově zařazeno %1 výsledků (%2 bez e-mailu).\nVe frontě čeká %3 e-mailů, "
+                                     "odesílají se na pozadí, dokud je editor otevřený.")
+                                 .arg(queued).arg(skipped).arg(pending));
+}
+
+void MainWindow::onBackupNow()
+{
+    if (!mBackup) return;
+    if (mBackup->isRunning()) {
+        statusBar()->showMessage("Záloha právě probíhá...", 5000);
+        return;
+    }
+    statusBar()->showMessage("Zálohuji databázi...");
+    mBackup->backupNow();
+}
+
+/* near-duplicate report for the selected test or the whole DB */
+void MainWindow::onFindDuplicates()
+{
+    QStringList scopes;
+    QString testId = currentTestId();
+    if (!testId.isEmpty()) scopes << "Vybraný test";
+    scopes << "Celá databáze";
+    bool ok = false;
+    QString scope = QInputDialog::getItem(this, "Duplicitní otázky", "Prohledat:", scopes, 0, false, &ok);
+    if (!ok) return;
+    if (scope != "Vybraný test") testId.clear();
+
+    QVector<DBManager::DuplicateGroup> groups;
+    QString err;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool found = DBManager::instance().findDuplicates(testId, 0.8, groups, &err);
+    QApplication::restoreOverrideCursor();
+    if (!found) {
+        QMessageBox::warning(this, "Chyba při hledání duplicit", err);
+        return;
+    }
+
+    QString report;
+    if (groups.isEmpty()) report = "Nebyly nalezeny žádné podobné otázky.";
+    for (int i = 0; i < groups.size(); ++i) {
+        const DBManager::DuplicateGroup &g = groups[i];
+        report += QString("Skupina %1 (podobnost alespoň %2 %):\n").arg(i+1).arg(qRound(g.similarity * 100));
+        for (const DBManager::DuplicateItem &it : g.items)
+            report += QString("  [%1] %2\n").arg(it.testName, it.text.simplified());
+        report += "\n";
+    }
+
+    QDialog dlg(this);
+    dlg.setWindowTitle("Duplicitní otázky");
+    QPlainTextEdit *text = new QPlainTextEdit(report);
+    text->setReadOnly(true);
+    QDialogButtonBox *box = new QDialogButtonBox(QDialogButtonBox::Close);
+    connect(box, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
+    QVBoxLayout *lay = new QVBoxLayout;
+    lay->addWidget(text);
+    lay->addWidget(box);
+    dlg.setLayout(lay);
+    dlg.resize(700, 500);
+    dlg.exec();
+}
+
 /* collect editor fields into question model */
 void MainWindow::collectEditorToQuestion(int index)
 {
@@ -525,8 +1584,7 @@ void MainWindow::onTestSelected(int idx)
         if (idx < 0 || idx >= mTests.size()) {
             mEditTestName->clear();
             mEditTestDescription->clear();
-            mQuestions.clear();
-            refreshQuestionList();
+            mQuestionModel->clear();
             return;
         }
         const Test &t = mTests[idx];
@@ -540,142 +1598,376 @@ void MainWindow::onTestSelected(int idx)
             mSpinStudentCount->setValue(10);
         }
 
-        // load questions for this test from DB
+        // load first page of questions for this test from DB, the rest is fetched on scroll
         QString err;
-        QVector<Question> loadedQuestions;
-        if (!DBManager::instance().loadQuestionsForTest(t.id, loadedQuestions, &err)) {
+        if (!mQuestionModel->loadTest(t.id, &err)) {
             QMessageBox::warning(this, "Chyba při načítání otázek z DB", err);
-            mQuestions.clear();
-        } else {
-            mQuestions = std::move(loadedQuestions);
         }
-        refreshQuestionList();
-        if (!mQuestions.isEmpty()) mListQuestions->setCurrentRow(0);
+        if (!mQuestions.isEmpty()) selectQuestionRow(0);
         return;
     }
 
     // Student mode: when selecting a test, load questions and start test inline
+    if (mRestoringSession) return; // state comes from the journal
+    setPracticeMode(false);
+    // switching to another test abandons the running attempt
+    mJournal.finish();
     if (idx < 0 || idx >= mTests.size()) {
         mStudentQuestions.clear();
         mStudentAnswers.clear();
+        mStudentOptionOrder.clear();
         mLblStudentProgress->clear();
-        mLblStudentQuestion->clear();
-        QLayout *l = mWidgetStudentAnswers->layout();
-        QLayoutItem *it;
-        while ((it = l->takeAt(0)) != nullptr) {
-            if (it->widget()) it->widget()->deleteLater();
-            delete it;
-        }
+        mStudentView->clear();
+        mStudentTestId.clear();
+        mAdaptiveMode = false;
+        mAdaptiveItems.clear();
         return;
     }
 
     QString tid = mTests[idx].id;
+    mStudentTestId = tid;
     QString err;
-    if (!DBManager::instance().loadQuestionsForTest(tid, mStudentQuestions, &err)) {
+    bool adaptive = false;
+    if (!prepareAdaptiveAttempt(tid, mTests[idx].studentCount, &adaptive, &err)) {
         QMessageBox::warning(this, "Chyba při načítání otázek", err);
         return;
     }
-
-    // prepare randomized subset
-    std::shuffle(mStudentQuestions.begin(), mStudentQuestions.end(), *QRandomGenerator::global());
-
-    int count = mTests[idx].studentCount;
-
-    if (mStudentQuestions.size() > count) {
-        mStudentQuestions.resize(count);
+    mStudentAnswers.clear();
+    mStudentOptionOrder.clear();
+    mStudentAttemptKey.clear();
+    if (adaptive) {
+        // first question at the prior mean, the next ones follow the answers
+        mStudentQuestions.clear();
+        appendAdaptiveQuestion();
+    } else if (!drawStudentQuestions(tid, mTests[idx].studentCount, mStudentQuestions, &err)) {
+        // prepare randomized subset
+        QMessageBox::warning(this, "Chyba při načítání otázek", err);
+        return;
     }
     mStudentCurrentIndex = 0;
-    mStudentAnswers.clear();
     mStudentAnswers.resize(mStudentQuestions.size());
+    mStudentOptionOrder.resize(mStudentQuestions.size());
+    mStudentView->clear();
+
+    // size the widget pool once for the whole test, navigation then only rebinds
+    int maxOptions = 0;
+    for (const Question &q : std::as_const(mAdaptiveMode ? mAdaptiveBank : mStudentQuestions))
+        maxOptions = qMax(maxOptions, static_cast<int>(q.options.size()));
+    mStudentView->reserve(maxOptions);
     // show first question
     if (!mStudentQuestions.isEmpty()) {
+        QStringList ids;
+        for (const Question &q : std::as_const(mStudentQuestions)) ids.append(q.id);
+        if (!mJournal.begin(tid, mEditStudentEmail->text().trimmed(), ids, &err))
+            qDebug() << "Answer journal not available:" << err;
+        mStudentAttemptKey = mJournal.isActive() ? mJournal.sessionId() : QUuid::createUuid().toString(QUuid::WithoutBraces);
+        instantiateStudentQuestions(0);
         showStudentQuestion(0);
     }
 }
 
+bool MainWindow::drawStudentQuestions(const QString &testId, int count, QVector<Question> &out, QString *err)
+{
+    if (mExamPackage.isOpen()) {
+        // packages carry no blueprint, draw uniformly
+        out = mExamPackage.questions();
+        std::shuffle(out.begin(), out.end(), *QRandomGenerator::global());
+        if (out.size() > count) out.resize(count);
+        return true;
+    }
+    // only the drawn questions are loaded, following the test blueprint
+    QStringList ids;
+    if (!DBManager::instance().drawQuestionIds(testId, count, &ids, err)) return false;
+    return DBManager::instance().loadQuestionsByIds(ids, out, err);
+}
+
+bool MainWindow::loadStudentQuestions(const QStringList &ids, QVector<Question> &out, QString *err)
+{
+    if (!mExamPackage.isOpen()) return DBManager::instance().loadQuestionsByIds(ids, out, err);
+    QHash<QString, int> byId;
+    const QVector<Question> &bank = mExamPackage.questions();
+    for (int i = 0; i < bank.size(); ++i) byId.insert(bank[i].id, i);
+    out.clear();
+    out.reserve(ids.size());
+    for (const QString &id : ids) {
+        auto it = byId.constFind(id);
+        if (it != byId.constEnd()) out.append(bank[it.value()]);
+    }
+    return true;
+}
+
+/* adaptive settings of the test -> item bank and engine for a new adaptive attempt */
+bool MainWindow::prepareAdaptiveAttempt(const QString &testId, int maxItems, bool *adaptive, QString *err)
+{
+    *adaptive = false;
+    mAdaptiveMode = false;
+    mAdaptiveItems.clear();
+    mAdaptiveBank.clear();
+    // packages carry no item parameters
+    if (mExamPackage.isOpen()) return true;
+    DBManager::AdaptiveSettings settings;
+    if (!DBManager::instance().loadAdaptiveSettings(testId, &settings, err)) return false;
+    if (!settings.enabled) return true;
+
+    QVector<DBManager::ItemParams> calibrated;
+    if (!DBManager::instance().loadQuestionsForTest(testId, mAdaptiveBank, err)
+        || !DBManager::instance().loadItemParams(testId, calibrated, err)) {
+        return false;
+    }
+    QHash<QString, int> indexOf;
+    for (int i = 0; i < mAdaptiveBank.size(); ++i) indexOf.insert(mAdaptiveBank[i].id, i);
+    // questions without calibration are treated as of average difficulty
+    QVector<AdaptiveEngine::ItemParams> params(mAdaptiveBank.size());
+    for (const DBManager::ItemParams &p : std::as_const(calibrated)) {
+        auto it = indexOf.constFind(p.questionId);
+        if (it == indexOf.constEnd()) continue;
+        params[it.value()].a = p.a;
+        params[it.value()].b = p.b;
+    }
+    mAdaptive.setItems(std::move(params));
+    mAdaptiveStop.minItems = settings.minItems;
+    mAdaptiveStop.maxItems = maxItems;
+    mAdaptiveStop.targetSe = settings.targetSe;
+    mAdaptiveMode = true;
+    *adaptive = true;
+    return true;
+}
+
+/* next question of an adaptive attempt; false when the bank is used up */
+bool MainWindow::appendAdaptiveQuestion()
+{
+    const int item = mAdaptive.nextItem();
+    if (item < 0) return false;
+    mAdaptiveItems.append(item);
+    mStudentQuestions.append(mAdaptiveBank[item]);
+    mStudentAnswers.resize(mStudentQuestions.size());
+    mStudentOptionOrder.resize(mStudentQuestions.size());
+    mJournal.recordQuestion(mStudentQuestions.size() - 1, mAdaptiveBank[item].id);
+    // the first question is filled in once the attempt (and its key) exists
+    if (!mStudentAttemptKey.isEmpty()) instantiateStudentQuestions(mStudentQuestions.size() - 1);
+    return true;
+}
+
+const QuestionTemplate &MainWindow::compiledTemplate(const QString &definition)
+{
+    auto it = mTemplateCache.find(definition);
+    if (it == mTemplateCache.end()) {
+        QuestionTemplate tpl;
+        QString err;
+        if (!tpl.compile(definition, &err)) qDebug() << "Question template not usable:" << err;
+        it = mTemplateCache.insert(definition, tpl);
+    }
+    return it.value();
+}
+
+/* parametric questions get the values of this attempt; the key is recomputed the same way */
+void MainWindow::instantiateStudentQuestions(int from)
+{
+    // packages contain instances already
+    if (mExamPackage.isOpen() || from < 0 || from >= mStudentQuestions.size()) return;
+    QStringList ids;
+    for (int i = from; i < mStudentQuestions.size(); ++i) ids.append(mStudentQuestions[i].id);
+    QHash<QString, QString> definitions;
+    QString err;
+    if (!DBManager::instance().loadQuestionTemplates(ids, &definitions, &err)) {
+        qDebug() << "Failed to load question templates:" << err;
+        return;
+    }
+    if (definitions.isEmpty()) return;
+    for (int i = from; i < mStudentQuestions.size(); ++i) {
+        auto it = definitions.constFind(mStudentQuestions[i].id);
+        if (it == definitions.constEnd()) continue;
+        const QuestionTemplate &tpl = compiledTemplate(it.value());
+        Question inst;
+        if (tpl.isValid() && tpl.instantiate(mStudentQuestions[i], QuestionTemplate::seedFor(mStudentAttemptKey, mStudentQuestions[i].id), &inst))
+            mStudentQuestions[i] = inst;
+    }
+}
+
+/* updates the ability estimate with answer index (an empty answer counts as wrong) */
+void MainWindow::recordAdaptiveAnswer(int index)
+{
+    if (index < 0 || index >= mAdaptiveItems.size()) return;
+    mAdaptive.record(mAdaptiveItems[index], Grading::isCorrect(mStudentQuestions[index], mStudentAnswers.value(index)));
+}
+
+/* unfinished attempt found in the journal directory -> ask whether to continue it */
+bool MainWindow::offerJournalResume()
+{
+    const QVector<AnswerJournal::Session> pending = AnswerJournal::pendingSessions();
+    for (const AnswerJournal::Session &s : pending) {
+        if (s.answeredCount == 0) {
+            AnswerJournal::discard(s); // nothing to lose
+            continue;
+        }
+        const int idx = mTestModel->rowOfId(s.testId);
+        if (idx < 0) continue; // attempt of a test not offered here (e.g. other package)
+
+        const auto btn = QMessageBox::question(this, "Nedokončený test",
+            QString("Byl nalezen nedokončený test \"%1\" (%2, zodpovězeno %3 z %4 otázek).\nPokračovat v něm?")
+                .arg(mTests[idx].name, s.started.toLocalTime().toString("d.M.yyyy H:mm"))
+                .arg(s.answeredCount).arg(s.questionIds.size()));
+        if (btn != QMessageBox::Yes) {
+            AnswerJournal::discard(s);
+            continue;
+        }
+        if (resumeStudentSession(s)) return true;
+        QMessageBox::warning(this, "Nedokončený test", "Test se nepodařilo obnovit, otázky se od té doby změnily.");
+        AnswerJournal::discard(s);
+    }
+    return false;
+}
+
+bool MainWindow::resumeStudentSession(const AnswerJournal::Session &s)
+{
+    const int idx = mTestModel->rowOfId(s.testId);
+    if (idx < 0) return false;
+
+    QVector<Question> drawn;
+    QString err;
+    if (!loadStudentQuestions(s.questionIds, drawn, &err)) return false;
+    // journal indices must stay valid, so every drawn question has to still exist
+    if (drawn.size() != s.questionIds.size()) return false;
+    if (drawn.isEmpty()) return false;
+    bool adaptive = false;
+    if (!prepareAdaptiveAttempt(s.testId, mTests[idx].studentCount, &adaptive, &err)) return false;
+    if (adaptive) {
+        QHash<QString, int> indexOf;
+        for (int i = 0; i < mAdaptiveBank.size(); ++i) indexOf.insert(mAdaptiveBank[i].id, i);
+        for (const Question &q : std::as_const(drawn)) {
+            auto it = indexOf.constFind(q.id);
+            if (it == indexOf.constEnd()) return false;
+            mAdaptiveItems.append(it.value());
+        }
+    }
+    if (!mJournal.resume(s, &err)) return false;
+
+    mRestoringSession = true;
+    selectTestRow(idx);
+    mRestoringSession = false;
+    mStudentTestId = s.testId;
+
+    mStudentQuestions = std::move(drawn);
+    mStudentAttemptKey = s.sessionId;
+    instantiateStudentQuestions(0);
+    mStudentAnswers = s.answers;
+    mStudentOptionOrder.clear();
+    mStudentOptionOrder.resize(mStudentQuestions.size());
+    // replay the answers given so far into the ability estimate
+    for (int i = 0; i < mAdaptiveItems.size(); ++i) {
+        if (i + 1 < mAdaptiveItems.size() || !mStudentAnswers.value(i).isEmpty()) recordAdaptiveAnswer(i);
+    }
+    mStudentView->clear();
+    int maxOptions = 0;
+    for (const Question &q : std::as_const(mAdaptiveMode ? mAdaptiveBank : mStudentQuestions))
+        maxOptions = qMax(maxOptions, static_cast<int>(q.options.size()));
+    mStudentView->reserve(maxOptions);
+    if (!s.email.isEmpty()) mEditStudentEmail->setText(s.email);
+
+    // continue at the first unanswered question
+    int first = 0;
+    while (first + 1 < mStudentAnswers.size() && !mStudentAnswers[first].isEmpty()) ++first;
+    showStudentQuestion(first);
+    return true;
+}
+
 void MainWindow::showStudentQuestion(int index)
 {
     if (index < 0 || index >= mStudentQuestions.size()) return;
     mStudentCurrentIndex = index;
     const Question &q = mStudentQuestions[index];
-    mLblStudentProgress->setText(QString("Otázka %1 / %2").arg(index+1).arg(mStudentQuestions.size()));
-    mLblStudentQuestion->setText(q.text);
+    if (mAdaptiveMode)
+        mLblStudentProgress->setText(QString("Otázka %1 (nejvýše %2)").arg(index+1).arg(qMin(mAdaptiveStop.maxItems, mAdaptive.itemCount())));
+    else
+        mLblStudentProgress->setText(QString("Otázka %1 / %2").arg(index+1).arg(mStudentQuestions.size()));
 
-    // clear previous answer widgets
-    QLayout *lay = mWidgetStudentAnswers->layout();
-    QLayoutItem *child;
-    while ((child = lay->takeAt(0)) != nullptr) {
-        if (child->widget()) child->widget()->deleteLater();
-        delete child;
+    // swaps in the prefetched page when available
+    mStudentView->showQuestion(index, q, studentOptionOrder(index), studentSelection(index), mStudentAnswers.value(index));
+
+    // prepare the following question once the current one is painted
+    if (index + 1 < mStudentQuestions.size()) {
+        QTimer::singleShot(0, this, [this, index]() { prefetchStudentQuestion(index + 1); });
     }
-    mCurrentAnswerWidgets.clear();
+}
 
-    // get stored student answer for this index
-    QString stored = mStudentAnswers.value(index);
+void MainWindow::prefetchStudentQuestion(int index)
+{
+    // test may have been switched or navigation moved on meanwhile
+    if (index < 0 || index >= mStudentQuestions.size() || index == mStudentCurrentIndex) return;
+    if (mStudentView->isPrepared(index)) return;
+    mStudentView->prepare(index, mStudentQuestions[index], studentOptionOrder(index),
+                          studentSelection(index), mStudentAnswers.value(index));
+}
 
-    if (q.type == QuestionType::TextAnswer) {
-        QLineEdit *le = new QLineEdit;
-        if (!stored.isEmpty()) le->setText(stored);
-        lay->addWidget(le);
-        mCurrentAnswerWidgets.append(le);
-    } else {
+const QVector<int> &MainWindow::studentOptionOrder(int index)
+{
+    if (mStudentOptionOrder.size() != mStudentQuestions.size())
+        mStudentOptionOrder.resize(mStudentQuestions.size());
+    QVector<int> &indices = mStudentOptionOrder[index];
+    const Question &q = mStudentQuestions[index];
+    if (q.type != QuestionType::TextAnswer && indices.size() != q.options.size()) {
         int m = q.options.size();
-        QVector<int> indices;
+        indices.clear();
+        indices.reserve(m);
         for (int i=0;i<m;++i)
             indices.append(i);
         std::shuffle(indices.begin(), indices.end(), *QRandomGenerator::global());
+    }
+    return indices;
+}
 
-        if (q.type == QuestionType::SingleChoice) {
-            QButtonGroup *grp = new QButtonGroup(this);
-            grp->setExclusive(true);
-            for (int i = 0; i < m; ++i) {
-                int origIdx = indices[i];
-                QRadioButton *rb = new QRadioButton(q.options[origIdx].text);
-                if (!stored.isEmpty() && stored == q.options[origIdx].text) rb->setChecked(true);
-                lay->addWidget(rb);
-                grp->addButton(rb, origIdx);
-                mCurrentAnswerWidgets.append(rb);
-            }
-        } else {
-            QStringList presel = stored.split(";@", Qt::SkipEmptyParts);
-            for (int i = 0; i < m; ++i) {
-                int origIdx = indices[i];
-                QCheckBox *cb = new QCheckBox(q.options[origIdx].text);
-                for (const QString &s : std::as_const(presel))
-                    if (s.trimmed() == q.options[origIdx].text) cb->setChecked(true);
-                lay->addWidget(cb);
-                mCurrentAnswerWidgets.append(cb);
-            }
-        }
+/* previously stored answer of question index as list of chosen option texts */
+QStringList MainWindow::studentSelection(int index) const
+{
+    const Question &q = mStudentQuestions[index];
+    QString stored = mStudentAnswers.value(index);
+    QStringList presel;
+    if (q.type == QuestionType::SingleChoice) {
+        if (!stored.isEmpty()) presel.append(stored);
+    } else if (q.type == QuestionType::MultipleChoice) {
+        presel = stored.split(";@", Qt::SkipEmptyParts);
+        for (QString &s : presel) s = s.trimmed();
+    }
+    return presel;
+}
+
+/* store answer shown in the pool into mStudentAnswers */
+void MainWindow::saveStudentAnswer(int index)
+{
+    if (index < 0 || index >= mStudentQuestions.size()) return;
+    const Question &curQ = mStudentQuestions[index];
+    QString answer;
+    if (curQ.type == QuestionType::TextAnswer) {
+        answer = mStudentView->textAnswer();
+    } else if (curQ.type == QuestionType::SingleChoice) {
+        answer = mStudentView->selectedOptionTexts().value(0);
+    } else {
+        answer = mStudentView->selectedOptionTexts().join(";@ ");
     }
+    if (answer == mStudentAnswers[index]) return;
+    mStudentAnswers[index] = answer;
+    mJournal.recordAnswer(index, curQ.id, answer);
 }
 
 /* Student navigation */
 void MainWindow::onStudentNext()
 {
+    if (mPracticeMode) {
+        answerPracticeQuestion();
+        return;
+    }
     if (mStudentCurrentIndex < 0 || mStudentCurrentIndex >= mStudentQuestions.size()) return;
 
     // save current answer into m_studentAnswers
-    const Question &curQ = mStudentQuestions[mStudentCurrentIndex];
-    if (curQ.type == QuestionType::TextAnswer) {
-        QLineEdit *le = qobject_cast<QLineEdit*>(mCurrentAnswerWidgets.isEmpty() ? nullptr : mCurrentAnswerWidgets.first());
-        mStudentAnswers[mStudentCurrentIndex] = le ? le->text().trimmed() : QString();
-    } else if (curQ.type == QuestionType::SingleChoice) {
-        QString chosen;
-        for (QWidget *w : std::as_const(mCurrentAnswerWidgets)) {
-            QRadioButton *rb = qobject_cast<QRadioButton*>(w);
-            if (!rb) continue;
-            if (rb->isChecked()) { chosen = rb->text(); break; }
-        }
-        mStudentAnswers[mStudentCurrentIndex] = chosen;
-    } else {
-        QStringList sel;
-        for (QWidget *w : std::as_const(mCurrentAnswerWidgets)) {
-            QCheckBox *cb = qobject_cast<QCheckBox*>(w);
-            if (!cb) continue;
-            if (cb->isChecked()) sel.append(cb->text());
+    saveStudentAnswer(mStudentCurrentIndex);
+
+    if (mAdaptiveMode && mStudentCurrentIndex + 1 == mStudentQuestions.size()) {
+        // the next question depends on this answer
+        if (mAdaptive.administeredCount() <= mStudentCurrentIndex) recordAdaptiveAnswer(mStudentCurrentIndex);
+        if (mAdaptive.finished(mAdaptiveStop) || !appendAdaptiveQuestion()) {
+            QMessageBox::information(this, "Konec", "Test je u konce. Klikněte Odevzdat pro vyhodnocení.");
+            return;
         }
-        mStudentAnswers[mStudentCurrentIndex] = sel.join(";@ ");
     }
 
     if (mStudentCurrentIndex + 1 < mStudentQuestions.size()) {
@@ -688,89 +1980,180 @@ void MainWindow::onStudentNext()
 /* Student submit: evaluate and save result */
 void MainWindow::onStudentSubmit()
 {
-    // save current answer
-    if (mStudentCurrentIndex >=0 && mStudentCurrentIndex < mStudentQuestions.size()) {
-        const Question &curQ = mStudentQuestions[mStudentCurrentIndex];
-        if (curQ.type == QuestionType::TextAnswer) {
-            QLineEdit *le = qobject_cast<QLineEdit*>(mCurrentAnswerWidgets.isEmpty() ? nullptr : mCurrentAnswerWidgets.first());
-            mStudentAnswers[mStudentCurrentIndex] = le ? le->text().trimmed() : QString();
-        } else if (curQ.type == QuestionType::SingleChoice) {
-            QString chosen;
-            for (QWidget *w : std::as_const(mCurrentAnswerWidgets)) {
-                QRadioButton *rb = qobject_cast<QRadioButton*>(w);
-                if (!rb) continue;
-                if (rb->isChecked()) { chosen = rb->text(); break; }
-            }
-            mStudentAnswers[mStudentCurrentIndex] = chosen;
-        } else {
-            QStringList sel;
-            for (QWidget *w : std::as_const(mCurrentAnswerWidgets)) {
-                QCheckBox *cb = qobject_cast<QCheckBox*>(w);
-                if (!cb) continue;
-                if (cb->isChecked()) sel.append(cb->text());
-            }
-            mStudentAnswers[mStudentCurrentIndex] = sel.join(";@ ");
-        }
+    if (mPracticeMode) {
+        setPracticeMode(false);
+        QMessageBox::information(this, "Procvičování",
+                                 QString("Procvičování ukončeno.\nZodpovězeno: %1, správně: %2").arg(mPracticeAnswered).arg(mPracticeCorrect));
+        onStudentStartTest();
+        return;
     }
+    // save current answer
+    saveStudentAnswer(mStudentCurrentIndex);
+    if (mAdaptiveMode && mAdaptive.administeredCount() <= mStudentCurrentIndex) recordAdaptiveAnswer(mStudentCurrentIndex);
 
     // Evaluate
-    double totalScore = 0.0;
     QVector<DBManager::ResultDetail> details;
-    for (int i = 0; i < mStudentQuestions.size(); ++i) {
-        const Question &q = mStudentQuestions[i];
-        bool correct = false;
-        QString ua = mStudentAnswers.value(i);
-        if (q.type == QuestionType::TextAnswer) {
-            QString given = ua.trimmed();
-            QString expected = q.expectedText.trimmed(); // original expected from DB
-            if (!expected.isEmpty()) {
-                if (QString::compare(given, expected, Qt::CaseInsensitive) == 0) correct = true;
-            } else {
-                // no expected answer provided -> cannot auto-evaluate; leave correct = false
-                correct = false;
-            }
-            if (correct) totalScore += 1.0;
-        } else if (q.type == QuestionType::SingleChoice) {
-            QString correctText;
-            for (const Answer &a : q.options) if (a.correct) { correctText = a.text; break; }
-            if (!correctText.isEmpty() && ua == correctText) {
-                correct = true;
-                totalScore += 1.0;
-            }
-        } else { // multiple
-            QStringList correctTexts;
-            for (const Answer &a : q.options)
-                if (a.correct)
-                    correctTexts.append(a.text);
-
-            QStringList sel = ua.split(";@", Qt::SkipEmptyParts);
-            auto normalize = [](QStringList l){
-                for (QString &s : l) s = s.trimmed();
-                std::sort(l.begin(), l.end());
-                return l;
-            };
-            if (normalize(correctTexts) == normalize(sel)) {
-                correct = true;
-                totalScore += 1.0;
-            }
+    double totalScore = Grading::gradeAttempt(mStudentQuestions, mStudentAnswers, &details);
+
+    QString email = mEditStudentEmail ? mEditStudentEmail->text().trimmed() : QString();
+    QString err;
+    // save result with test id (the test row may be hidden by the filter meanwhile)
+    QString tid = mStudentTestId;
+    if (!DBManager::instance().isOpen() && !DBManager::instance().openDatabase(DBManager::defaultDatabasePath(), &err)) {
+        QMessageBox::warning(this, "Chyba ukládání výsledku", err);
+    } else if (!DBManager::instance().saveResult(email, tid, totalScore, mStudentQuestions.size(), details, &err)) {
+        QMessageBox::warning(this, "Chyba ukládání výsledku", err);
+    } else {
+        mJournal.finish();
+        QString msg = QString("Skore: %1 / %2\nVýsledek uložen.").arg(totalScore).arg(mStudentQuestions.size());
+        if (mAdaptiveMode) {
+            msg += QString("\nOdhad úrovně: %1 ± %2").arg(mAdaptive.theta(), 0, 'f', 2).arg(mAdaptive.standardError(), 0, 'f', 2);
         }
+        QMessageBox::information(this, "Výsledek", msg);
+    }
+}
 
-        DBManager::ResultDetail rd;
-        rd.questionId = q.id;
-        rd.correct = correct;
-        rd.userAnswer = ua;
-        details.append(rd);
+/* Practice mode over the selected test: questions come by due time of the student's memory state */
+void MainWindow::onStudentPractice()
+{
+    const int idx = currentTestIndex();
+    if (idx < 0 || idx >= mTests.size()) {
+        QMessageBox::information(this, "Procvičování", "Vyberte test.");
+        return;
+    }
+    const QString email = mEditStudentEmail->text().trimmed();
+    if (email.isEmpty()) {
+        QMessageBox::information(this, "Procvičování", "Zadejte e-mail, podle něj se pamatuje, co už umíte.");
+        return;
+    }
+    if (mExamPackage.isOpen()) {
+        QMessageBox::information(this, "Procvičování", "Procvičování není v balíčku testu k dispozici.");
+        return;
+    }
+    // loads ids and states only: two index range scans, questions are read one at a time
+    const QString tid = mTests[idx].id;
+    QStringList ids;
+    QString err;
+    if (!DBManager::instance().loadQuestionIds(tid, &ids, &err)
+        || !DBManager::instance().loadSrsStates(email, tid, mPracticeStates, &err)) {
+        QMessageBox::warning(this, "Procvičování", err);
+        return;
+    }
+    QSet<QString> known;
+    QVector<qint64> due;
+    due.reserve(mPracticeStates.size());
+    for (const DBManager::SrsState &s : std::as_const(mPracticeStates)) {
+        known.insert(s.questionId);
+        due.append(s.due);
+    }
+    mPractice.build(due);
+    mPracticeNewIds.clear();
+    for (const QString &id : std::as_const(ids)) {
+        if (!known.contains(id)) mPracticeNewIds.append(id);
     }
 
-    QString email = mEditStudentEmail ? mEditStudentEmail->text().trimmed() : QString();
+    // the running attempt is abandoned
+    mJournal.finish();
+    mStudentTestId = tid;
+    mPracticeEmail = email;
+    mPracticeNextNew = 0;
+    mPracticeAnswered = 0;
+    mPracticeCorrect = 0;
+    setPracticeMode(true);
+    servePracticeQuestion();
+}
+
+void MainWindow::setPracticeMode(bool on)
+{
+    if (mPracticeMode == on) return;
+    mPracticeMode = on;
+    mPracticeItem = -1;
+    mBtnStudentNext->setText(on ? "Odpovědět" : "Další");
+    mBtnStudentSubmit->setText(on ? "Ukončit procvičování" : "Odevzdat");
+    if (on) {
+        mAdaptiveMode = false;
+        mAdaptiveItems.clear();
+    }
+}
+
+void MainWindow::servePracticeQuestion()
+{
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    for (;;) {
+        int item = mPractice.top();
+        if (item < 0 || mPractice.dueOf(item) > now) {
+            // nothing due: introduce a question never practised
+            if (mPracticeNextNew >= mPracticeNewIds.size() || mPracticeNextNew >= PracticeNewPerSession) {
+                QString msg = QString("Pro teď je hotovo.\nZodpovězeno: %1, správně: %2").arg(mPracticeAnswered).arg(mPracticeCorrect);
+                if (item >= 0) {
+                    msg += "\nDalší opakování: " + QDateTime::fromSecsSinceEpoch(mPractice.dueOf(item)).toString("d.M.yyyy H:mm");
+                }
+                setPracticeMode(false);
+                QMessageBox::information(this, "Procvičování", msg);
+                onStudentStartTest();
+                return;
+            }
+            DBManager::SrsState s;
+            s.questionId = mPracticeNewIds[mPracticeNextNew++];
+            s.due = now;
+            mPracticeStates.append(s);
+            item = mPractice.add(now);
+        }
+        Question q;
+        bool found = false;
+        QString err;
+        if (!DBManager::instance().loadQuestion(mPracticeStates[item].questionId, &q, &found, &err)) {
+            setPracticeMode(false);
+            QMessageBox::warning(this, "Procvičování", err);
+            return;
+        }
+        if (!found) {
+            mPractice.remove(item); // deleted meanwhile
+            continue;
+        }
+        mPracticeItem = item;
+        mStudentQuestions = { q };
+        // new values each time the question comes back
+        mStudentAttemptKey = QUuid::createUuid().toString(QUuid::WithoutBraces);
+        instantiateStudentQuestions(0);
+        mStudentAnswers = QVector<QString>(1);
+        mStudentOptionOrder.clear();
+        mStudentOptionOrder.resize(1);
+        mStudentView->clear();
+        mStudentView->reserve(q.options.size());
+        showStudentQuestion(0);
+        mLblStudentProgress->setText(QString("Procvičování: zodpovězeno %1, správně %2").arg(mPracticeAnswered).arg(mPracticeCorrect));
+        return;
+    }
+}
+
+void MainWindow::answerPracticeQuestion()
+{
+    if (mPracticeItem < 0 || mStudentQuestions.isEmpty()) return;
+    saveStudentAnswer(0);
+    const Question &q = mStudentQuestions[0];
+    const bool correct = Grading::isCorrect(q, mStudentAnswers[0]);
+    DBManager::SrsState &s = mPracticeStates[mPracticeItem];
+    PracticeScheduler::review(&s, correct, QDateTime::currentSecsSinceEpoch());
     QString err;
-    // save result with test id
-    QString tid = currentTestId();
-    if (!DBManager::instance().saveResult(email, tid, totalScore, mStudentQuestions.size(), details, &err)) {
-        QMessageBox::warning(this, "Chyba ukládání výsledku", err);
+    if (!DBManager::instance().saveSrsState(mPracticeEmail, mStudentTestId, s, &err)) {
+        QMessageBox::warning(this, "Procvičování", err);
+        return;
+    }
+    mPractice.reschedule(mPracticeItem, s.due);
+    ++mPracticeAnswered;
+    if (correct) ++mPracticeCorrect;
+
+    QString expected;
+    if (q.type == QuestionType::TextAnswer) {
+        expected = q.expectedText;
     } else {
-        QMessageBox::information(this, "Výsledek", QString("Skore: %1 / %2\nVýsledek uložen.").arg(totalScore).arg(mStudentQuestions.size()));
+        QStringList right;
+        for (const Answer &a : q.options) if (a.correct) right.append(a.text);
+        expected = right.join(", ");
     }
+    statusBar()->showMessage(correct ? QString("Správně.") : QString("Špatně, správně je: %1").arg(expected), 8000);
+    servePracticeQuestion();
 }
 
 /* Optional slot used to start test programmatically (kept because header declares it) */
@@ -799,7 +2182,7 @@ void MainWindow::saveCurrentTestToDb1(int i)
         qDebug() << "Chyba při ukládání testu:" << err;
         // případně zobrazit uživateli
     } else {
-        refreshTestList(); // nebo jiná aktualizace UI pokud je potřeba
+        mTestModel->testChanged(idx); // nebo jiná aktualizace UI pokud je potřeba
     }
 }
 
@@ -818,7 +2201,6 @@ void MainWindow::saveCurrentTestToDb()
         qDebug() << "Chyba při ukládání testu:" << err;
         // případně zobrazit uživateli
     } else {
-        refreshTestList(); // nebo jiná aktualizace UI pokud je potřeba
-        refreshQuestionList();
+        mTestModel->testChanged(idx); // nebo jiná aktualizace UI pokud je potřeba
     }
 }
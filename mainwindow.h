@@ -5,9 +5,17 @@
 #include <QVector>
 #include <QTimer>
 #include "models.h"
+#include "exampackage.h"
+#include "answerjournal.h"
+#include "dbmanager.h"
+#include "adaptiveengine.h"
+#include "practicescheduler.h"
+#include "questiontemplate.h"
 
 class CustomTextEdit;
+class QListView;
 class QListWidget;
+class QListWidgetItem;
 class QPushButton;
 class QTextEdit;
 class QComboBox;
@@ -15,15 +23,24 @@ class QTableWidget;
 class QTableWidgetItem;
 class QHeaderView;
 class QLineEdit;
+class QPlainTextEdit;
 class QSpinBox;
 class QLabel;
 class QStackedWidget;
+class StudentQuestionView;
+class TestListModel;
+class QuestionListModel;
+class BackupScheduler;
+class VariantPrinter;
+class MailQueue;
+class DbMaintenance;
 
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 public:
-    explicit MainWindow(bool teacherMode = false, QWidget *parent = nullptr);
+    // examPackagePath: student kiosk mode, the test is read from a mapped exam package
+    explicit MainWindow(bool teacherMode = false, const QString &examPackagePath = QString(), QWidget *parent = nullptr);
 
 private slots:
     // common
@@ -40,6 +57,24 @@ private slots:
     void onRemoveAnswer();
 
     void answerItemChanged(QTableWidgetItem *item);
+    // full-text search in teacher editor
+    void runSearch();
+    void loadMoreSearchHits();
+    void onSearchHitActivated(QListWidgetItem *item);
+    void onFindDuplicates();
+    void onImportQuestions();
+    void onExportResults();
+    void onBrowseResults();
+    void onExportExamPackage();
+    void onPrintVariants();
+    void onMailResults();
+    void onBackupNow();
+    void onArchiveResults();
+    void onEditBlueprint();
+    void onEditAdaptive();
+    void applyTestFilter();
+    // tests / questions changed by another process (DbChangeBus)
+    void onDatabaseChanged(const QVector<DBManager::Change> &changes, bool external);
     // auto-save
     void scheduleAutoSave();
     bool doAutoSave();
@@ -49,6 +84,7 @@ private slots:
     void onStudentStartTest();
     void onStudentNext();
     void onStudentSubmit();
+    void onStudentPractice();
 
     void saveCurrentTestToDb();
     void saveCurrentTestToDb1(int i);
@@ -56,13 +92,43 @@ private slots:
 private:
     void buildTeacherUi();
     void buildStudentUi();
-    void refreshTestList();
-    void refreshQuestionList();
+    void setupListModels();
+    int currentQuestionRow() const;
+    void selectTestRow(int row);
+    void applyTestChange(const QString &testId);
+    void upsertTestRow(const Test &t);
+    void removeTestRow(int row);
+    void mergeTestsFromDb();
+    void reloadTestCatalog(const QString &filter);
+    void applyQuestionChange(const QString &questionId);
+    void reloadQuestions();
+    void selectQuestionRow(int row);
     void loadQuestionIntoEditor(int index);
     void collectEditorToQuestion(int index);
 
     // new helper for student UI
     void showStudentQuestion(int index);
+    void saveStudentAnswer(int index);
+    // prepare the next question in the hidden page while the student reads the current one
+    void prefetchStudentQuestion(int index);
+    bool drawStudentQuestions(const QString &testId, int count, QVector<Question> &out, QString *err);
+    bool loadStudentQuestions(const QStringList &ids, QVector<Question> &out, QString *err);
+    // adaptive tests: loads bank and IRT parameters when the test has adaptive settings
+    bool prepareAdaptiveAttempt(const QString &testId, int maxItems, bool *adaptive, QString *err);
+    bool appendAdaptiveQuestion();
+    void recordAdaptiveAnswer(int index);
+    // fills in parametric questions of mStudentQuestions from index from on
+    void instantiateStudentQuestions(int from);
+    const QuestionTemplate &compiledTemplate(const QString &definition);
+    void updateTemplatePreview();
+    // practice mode: next due question of the selected test, answers update the memory state
+    void servePracticeQuestion();
+    void answerPracticeQuestion();
+    void setPracticeMode(bool on);
+    bool offerJournalResume();
+    bool resumeStudentSession(const AnswerJournal::Session &s);
+    const QVector<int> &studentOptionOrder(int index);
+    QStringList studentSelection(int index) const;
 
     // data
     bool mTeacherMode;
@@ -70,24 +136,77 @@ private:
     QVector<Question> mQuestions; // in teacher mode: questions for selected test
     QVector<Question> mStudentQuestions; // in student mode: current test questions
     QVector<QString> mStudentAnswers; // per-student answers (parallel to m_studentQuestions)
+    QVector<QVector<int>> mStudentOptionOrder; // shuffled option order, created on first use
+    ExamPackage mExamPackage; // open in kiosk mode; mStudentQuestions strings point into it
     int mStudentCurrentIndex = 0;
+    AnswerJournal mJournal; // answers of the running attempt, survives a crash
+    bool mRestoringSession = false;
+    QString mStudentTestId; // test of the running attempt (its row may be filtered out)
+    QString mStudentAttemptKey; // seeds parametric questions of the attempt (journal session id)
+    QHash<QString, QuestionTemplate> mTemplateCache; // compiled templates by definition text
+    // adaptive attempt: whole bank in memory, questions appended one by one as answered
+    bool mAdaptiveMode = false;
+    AdaptiveEngine mAdaptive;
+    AdaptiveEngine::StopRule mAdaptiveStop;
+    QVector<Question> mAdaptiveBank;
+    QVector<int> mAdaptiveItems; // bank index of each asked question (parallel to mStudentQuestions)
+    // practice mode: scheduler items are questions with a memory state, new questions are
+    // introduced one at a time when nothing is due
+    static const int PracticeNewPerSession = 20;
+    bool mPracticeMode = false;
+    PracticeScheduler mPractice;
+    QVector<DBManager::SrsState> mPracticeStates; // scheduler item -> state
+    QStringList mPracticeNewIds;                  // questions never practised, in bank order
+    int mPracticeNextNew = 0;
+    int mPracticeItem = -1;                       // item shown
+    int mPracticeAnswered = 0;
+    int mPracticeCorrect = 0;
+    QString mPracticeEmail;
+
+    // list models over mTests / mQuestions (row-level updates, lazy paging of questions)
+    TestListModel *mTestModel = nullptr;
+    QuestionListModel *mQuestionModel = nullptr;
 
     // AUTO SAVE timer (debounce)
     QTimer mAutoSaveTimer;
 
     // Teacher widgets
     //tests widgets
-    QListWidget *mListTests; // also used in student mode as test selector
+    QListView *mListTests = nullptr; // also used in student mode as test selector
+    QLineEdit *mEditTestFilter = nullptr;
+    QTimer mTestFilterTimer; // debounce of the test name filter
     QLineEdit *mEditTestName;
     QLineEdit *mEditTestDescription;
     QPushButton *mBtnAddTest;
     QPushButton *mBtnRemoveTest;
 
     // questions widgets
-    QListWidget *mListQuestions;
+    QListView *mListQuestions = nullptr;
     CustomTextEdit *mEditQuestionText;
     QPushButton *mBtnAddQuestion;
     QPushButton *mBtnRemoveQuestion;
+    QPushButton *mBtnFindDuplicates;
+    QPushButton *mBtnImportQuestions;
+    QPushButton *mBtnExportResults;
+    QPushButton *mBtnBrowseResults;
+    QPushButton *mBtnExportPackage;
+    QPushButton *mBtnPrintVariants;
+    QPushButton *mBtnMailResults;
+    QPushButton *mBtnBackupNow;
+    QPushButton *mBtnArchiveResults;
+    QPushButton *mBtnBlueprint;
+    QPushButton *mBtnAdaptive;
+    BackupScheduler *mBackup = nullptr; // periodic online backup in teacher mode
+    VariantPrinter *mPrinter = nullptr;   // PDF variants for paper exams, created on first use
+    MailQueue *mMailQueue = nullptr;      // sends queued result reports while the editor is open
+    DbMaintenance *mMaintenance = nullptr; // optimize / vacuum / checks when the editor is idle
+
+    // search widgets
+    QLineEdit *mEditSearch;
+    QListWidget *mListSearchResults;
+    QTimer mSearchTimer; // debounce of incremental search
+    QString mSearchText; // text of the shown results
+    bool mSearchHasMore = false;
 
     // answer editor widgets
     QComboBox *mComboType;
@@ -95,19 +214,21 @@ private:
     QPushButton *mBtnAddAnswer;
     QPushButton *mBtnRemoveAnswer;
     QLineEdit *mEditExpectedText;
+    QLineEdit *mEditQuestionTags;
+    QPlainTextEdit *mEditTemplate;
+    QLabel *mLblTemplatePreview;
+    QString mQuestionTemplate; // template of the question in the editor as stored in DB
+    QStringList mQuestionTags; // tags of the question in the editor as stored in DB
 
     // Student widgets (right side)
     QLabel *mLblStudentProgress;
-    QLabel *mLblStudentQuestion;
-    QWidget *mWidgetStudentAnswers; // placeholder layout for dynamic widgets
+    StudentQuestionView *mStudentView; // question text + pooled answer widgets (double buffered)
     QPushButton *mBtnStudentNext;
     QPushButton *mBtnStudentSubmit;
+    QPushButton *mBtnStudentPractice;
     QLineEdit *mEditStudentEmail;
     QSpinBox *mSpinStudentCount;
 
-    // helper to build answer widgets (used for both modes)
-    QList<QWidget*> mCurrentAnswerWidgets;
-
     // track current selected test id (for teacher/student)
     QString currentTestId() const;
     int currentTestIndex() const;
@@ -33,6 +33,7 @@ struct Question {
     QuestionType type = QuestionType::SingleChoice;
     QVector<Answer> options; // for choice questions
     QString expectedText;    // for exact text answers
+    bool numericKey = false; // expectedText computed by a QuestionTemplate, also matched as a number
 };
 
 #endif // MODELS_H
@@ -0,0 +1,104 @@
+#include "practicescheduler.h"
+
+void PracticeScheduler::review(DBManager::SrsState *s, bool correct, qint64 now)
+{
+    if (correct) {
+        if (s->reps == 0) s->interval = 1.0;
+        else if (s->reps == 1) s->interval = 6.0;
+        else s->interval *= s->ease;
+        ++s->reps;
+        s->due = now + qint64(s->interval * 86400.0);
+    } else {
+        s->reps = 0;
+        ++s->lapses;
+        s->ease = qMax(MinEase, s->ease - EasePenalty);
+        s->interval = 0.0;
+        s->due = now + RelearnSeconds;
+    }
+    s->lastReview = now;
+}
+
+void PracticeScheduler::clear()
+{
+    mHeap.clear();
+    mPos.clear();
+    mDue.clear();
+}
+
+void PracticeScheduler::build(const QVector<qint64> &due)
+{
+    mDue = due;
+    const int n = mDue.size();
+    mHeap.resize(n);
+    mPos.resize(n);
+    for (int i = 0; i < n; ++i) {
+        mHeap[i] = i;
+        mPos[i] = i;
+    }
+    for (int pos = n / 2 - 1; pos >= 0; --pos) siftDown(pos);
+}
+
+int PracticeScheduler::add(qint64 due)
+{
+    const int item = mDue.size();
+    mDue.append(due);
+    mPos.append(mHeap.size());
+    mHeap.append(item);
+    siftUp(mHeap.size() - 1);
+    return item;
+}
+
+void PracticeScheduler::reschedule(int item, qint64 due)
+{
+    const int pos = mPos.value(item, -1);
+    if (pos < 0) return;
+    const qint64 old = mDue[item];
+    mDue[item] = due;
+    if (due < old) siftUp(pos);
+    else siftDown(pos);
+}
+
+void PracticeScheduler::remove(int item)
+{
+    const int pos = mPos.value(item, -1);
+    if (pos < 0) return;
+    const int last = mHeap.takeLast();
+    mPos[item] = -1;
+    if (last == item) return;
+    place(pos, last);
+    siftUp(pos);
+    siftDown(mPos[last]);
+}
+
+void PracticeScheduler::place(int pos, int item)
+{
+    mHeap[pos] = item;
+    mPos[item] = pos;
+}
+
+void PracticeScheduler::siftUp(int pos)
+{
+    const int item = mHeap[pos];
+    while (pos > 0) {
+        const int parent = (pos - 1) / 2;
+        if (!before(item, mHeap[parent])) break;
+        place(pos, mHeap[parent]);
+        pos = parent;
+    }
+    place(pos, item);
+}
+
+void PracticeScheduler::siftDown(int pos)
+{
+    const int n = mHeap.size();
+    const int item = mHeap[pos];
+    for (;;) {
+        int child = 2 * pos + 1;
+        if (child >= n) break;
+        if (child + 1 < n && before(mHeap[child + 1], mHeap[child])) ++child;
+        if (!before(mHeap[child], item)) break;
+        place(pos, mHeap[child]);
+        pos = child;
+    }
+    place(pos, item);
+}
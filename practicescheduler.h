@@ -0,0 +1,49 @@
+#ifndef PRACTICESCHEDULER_H
+#define PRACTICESCHEDULER_H
+
+#include <QVector>
+#include "dbmanager.h"
+
+// Spaced-repetition queue of one student over one test bank.
+//
+// Items (0..n-1, assigned by add/build) are kept in a binary min-heap by due
+// time with a position index, so the next item is top() in O(1) and an answer
+// reschedules it in O(log n) without searching. Memory state per question
+// follows SM-2 with a binary grade: every correct answer multiplies the
+// interval by the ease factor (1 and 6 days for the first two), a wrong answer
+// lowers the ease and brings the question back after RelearnSeconds.
+class PracticeScheduler
+{
+public:
+    static const int RelearnSeconds = 600;
+    static constexpr double MinEase = 1.3;
+    static constexpr double EasePenalty = 0.2;
+
+    // new state of a question after an answer at time now (seconds since epoch)
+    static void review(DBManager::SrsState *s, bool correct, qint64 now);
+
+    void clear();
+    // items 0..due.size()-1 at once, O(n)
+    void build(const QVector<qint64> &due);
+    // returns the index of the new item
+    int add(qint64 due);
+    void reschedule(int item, qint64 due);
+    void remove(int item);
+
+    // item due first (ties in item order), -1 when empty
+    int top() const { return mHeap.isEmpty() ? -1 : mHeap.first(); }
+    qint64 dueOf(int item) const { return mDue[item]; }
+    int size() const { return mHeap.size(); }
+
+private:
+    bool before(int x, int y) const { return mDue[x] < mDue[y] || (mDue[x] == mDue[y] && x < y); }
+    void place(int pos, int item);
+    void siftUp(int pos);
+    void siftDown(int pos);
+
+    QVector<int> mHeap;   // items
+    QVector<int> mPos;    // item -> position in mHeap, -1 = removed
+    QVector<qint64> mDue; // item -> due time
+};
+
+#endif // PRACTICESCHEDULER_H
@@ -0,0 +1,397 @@
+#include "questionimporter.h"
+#include "dbmanager.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QXmlStreamReader>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QUuid>
+#include <QDebug>
+
+namespace {
+
+// bounded hand-over of parsed batches from the parser thread to the writer
+class BatchQueue
+{
+public:
+    enum PopResult { Batch, Finished, Aborted };
+
+    explicit BatchQueue(int capacity) : mCapacity(capacity) {}
+
+    // blocks while the queue is full; false when the import was aborted
+    bool push(QVector<Question> batch)
+    {
+        QMutexLocker lock(&mMutex);
+        while (mQueue.size() >= mCapacity && !mAborted) mNotFull.wait(&mMutex);
+        if (mAborted) return false;
+        mQueue.enqueue(std::move(batch));
+        mNotEmpty.wakeOne();
+        return true;
+    }
+
+    PopResult pop(QVector<Question> &batch)
+    {
+        QMutexLocker lock(&mMutex);
+        while (mQueue.isEmpty() && !mFinished && !mAborted) mNotEmpty.wait(&mMutex);
+        if (mAborted) return Aborted;
+        if (mQueue.isEmpty()) return Finished;
+        batch = mQueue.dequeue();
+        mNotFull.wakeOne();
+        return Batch;
+    }
+
+    void finish()
+    {
+        QMutexLocker lock(&mMutex);
+        mFinished = true;
+        mNotEmpty.wakeAll();
+    }
+
+    void abort()
+    {
+        QMutexLocker lock(&mMutex);
+        mAborted = true;
+        mNotFull.wakeAll();
+        mNotEmpty.wakeAll();
+    }
+
+private:
+    QMutex mMutex;
+    QWaitCondition mNotFull;
+    QWaitCondition mNotEmpty;
+    QQueue<QVector<Question>> mQueue;
+    int mCapacity;
+    bool mFinished = false;
+    bool mAborted = false;
+};
+
+// validates parsed records and groups them into batches (parser thread side)
+class RecordSink
+{
+public:
+    RecordSink(BatchQueue *queue, const QString &testId) : mQueue(queue), mTestId(testId) {}
+
+    // false when the import was aborted and parsing should stop
+    bool add(Question q, int line)
+    {
+        q.text = q.text.trimmed();
+        if (q.text.isEmpty()) { skip(line, "chybí text otázky"); return true; }
+        if (q.type == QuestionType::TextAnswer) {
+            q.options.clear();
+        } else {
+            int correct = 0;
+            for (const Answer &a : std::as_const(q.options)) if (a.correct) ++correct;
+            if (q.options.isEmpty()) { skip(line, "otázka nemá žádné možnosti"); return true; }
+            if (correct == 0) { skip(line, "žádná možnost není označena jako správná"); return true; }
+            if (q.type == QuestionType::SingleChoice && correct > 1) {
+                skip(line, "otázka s jednou správnou odpovědí má více správných možností");
+                return true;
+            }
+        }
+        q.id = QUuid::createUuid().toString();
+        q.testId = mTestId;
+        mBatch.append(std::move(q));
+        if (mBatch.size() >= QuestionImporter::BatchSize) return flush();
+        return true;
+    }
+
+    void skip(int line, const QString &why)
+    {
+        ++skipped;
+        if (warnings.size() < QuestionImporter::MaxWarnings)
+            warnings.append(QString("záznam na řádku %1: %2").arg(line).arg(why));
+    }
+
+    bool flush()
+    {
+        if (mBatch.isEmpty()) return true;
+        QVector<Question> batch;
+        batch.swap(mBatch);
+        mBatch.reserve(QuestionImporter::BatchSize);
+        return mQueue->push(std::move(batch));
+    }
+
+    int skipped = 0;
+    QStringList warnings;
+    QString fatalError; // parsing cannot continue, nothing is imported
+
+private:
+    BatchQueue *mQueue;
+    QString mTestId;
+    QVector<Question> mBatch;
+};
+
+bool parseType(const QString &s, QuestionType *type)
+{
+    const QString t = s.trimmed().toLower();
+    if (t == "0" || t == "single" || t == "jedna") { *type = QuestionType::SingleChoice; return true; }
+    if (t == "1" || t == "multiple" || t == "vice" || t == "více") { *type = QuestionType::MultipleChoice; return true; }
+    if (t == "2" || t == "text") { *type = QuestionType::TextAnswer; return true; }
+    return false;
+}
+
+bool parseBool(const QString &s)
+{
+    const QString t = s.trimmed().toLower();
+    return t == "1" || t == "true" || t == "ano" || t == "yes" || t == "x" || t == "*";
+}
+
+/* ---------- CSV ---------- */
+
+// one record; quoted fields may contain separators, "" and line breaks
+bool readCsvRecord(QTextStream &in, QChar sep, QStringList &fields, int &lineNo)
+{
+    fields.clear();
+    if (in.atEnd()) return false;
+    QString field;
+    bool inQuotes = false;
+    QString line = in.readLine();
+    ++lineNo;
+    for (;;) {
+        for (int i = 0; i < line.size(); ++i) {
+            const QChar c = line[i];
+            if (inQuotes) {
+                if (c == '"') {
+                    if (i + 1 < line.size() && line[i+1] == '"') { field += '"'; ++i; }
+                    else inQuotes = false;
+                } else {
+                    field += c;
+                }
+            } else if (c == '"') {
+                inQuotes = true;
+            } else if (c == sep) {
+                fields.append(field);
+                field.clear();
+            } else {
+                field += c;
+            }
+        }
+        if (!inQuotes || in.atEnd()) break;
+        field += '\n';
+        line = in.readLine();
+        ++lineNo;
+    }
+    fields.append(field);
+    return true;
+}
+
+void parseCsv(QFile &file, RecordSink &sink)
+{
+    // Czech spreadsheets export with ';', others with ','
+    const QByteArray head = file.peek(4096);
+    const QByteArray firstLine = head.left(head.indexOf('\n'));
+    const QChar sep = firstLine.count(';') > firstLine.count(',') ? QChar(';') : QChar(',');
+
+    QTextStream in(&file);
+    QStringList fields;
+    int lineNo = 0;
+    bool first = true;
+    while (readCsvRecord(in, sep, fields, lineNo)) {
+        const int recordLine = lineNo;
+        if (fields.size() == 1 && fields[0].trimmed().isEmpty()) continue;
+        if (first) {
+            first = false;
+            const QString h = fields[0].trimmed().toLower();
+            if (h == "type" || h == "typ") continue; // header
+        }
+        Question q;
+        if (!parseType(fields.value(0), &q.type)) {
+            sink.skip(recordLine, QString("neznámý typ otázky '%1'").arg(fields.value(0)));
+            continue;
+        }
+        q.text = fields.value(1);
+        q.expectedText = fields.value(2).trimmed();
+        for (int i = 3; i < fields.size(); i += 2) {
+            Answer a;
+            a.text = fields[i].trimmed();
+            a.correct = parseBool(fields.value(i + 1));
+            if (!a.text.isEmpty()) q.options.append(a);
+        }
+        if (!sink.add(std::move(q), recordLine)) return;
+    }
+}
+
+/* ---------- JSON ---------- */
+
+bool questionFromJson(const QJsonObject &o, Question *q, QString *why)
+{
+    const QJsonValue type = o.value("type");
+    if (type.isDouble()) {
+        if (!parseType(QString::number(type.toInt()), &q->type)) { *why = "neznámý typ otázky"; return false; }
+    } else if (!parseType(type.toString("single"), &q->type)) {
+        *why = QString("neznámý typ otázky '%1'").arg(type.toString());
+        return false;
+    }
+    q->text = o.value("text").toString();
+    q->expectedText = o.value(o.contains("expected_text") ? "expected_text" : "expected").toString().trimmed();
+    const QJsonArray options = o.value("options").toArray();
+    for (const QJsonValue &v : options) {
+        Answer a;
+        if (v.isObject()) {
+            const QJsonObject ao = v.toObject();
+            a.text = ao.value("text").toString().trimmed();
+            const QJsonValue c = ao.value("correct");
+            a.correct = c.isBool() ? c.toBool() : parseBool(c.toVariant().toString());
+        } else {
+            a.text = v.toString().trimmed();
+        }
+        if (!a.text.isEmpty()) q->options.append(a);
+    }
+    return true;
+}
+
+// Splits the byte stream into top-level objects without loading the whole file,
+// so both a JSON array of objects and JSON Lines are handled.
+void parseJson(QFile &file, RecordSink &sink)
+{
+    QByteArray obj;
+    int depth = 0;
+    bool inString = false;
+    bool escape = false;
+    int lineNo = 1;
+    int objLine = 1;
+    char buf[64 * 1024];
+    qint64 n;
+    while ((n = file.read(buf, sizeof(buf))) > 0) {
+        for (qint64 i = 0; i < n; ++i) {
+            const char c = buf[i];
+            if (c == '\n') ++lineNo;
+            if (depth > 0) obj.append(c);
+            if (inString) {
+                if (escape) escape = false;
+                else if (c == '\\') escape = true;
+                else if (c == '"') inString = false;
+                continue;
+            }
+            if (c == '"') {
+                inString = (depth > 0);
+            } else if (c == '{') {
+                if (depth == 0) { obj = "{"; objLine = lineNo; }
+                ++depth;
+            } else if (c == '}' && depth > 0) {
+                if (--depth > 0) continue;
+                QJsonParseError pe;
+                const QJsonDocument doc = QJsonDocument::fromJson(obj, &pe);
+                obj.clear();
+                Question q;
+                QString why;
+                if (pe.error != QJsonParseError::NoError) {
+                    sink.skip(objLine, pe.errorString());
+                } else if (!questionFromJson(doc.object(), &q, &why)) {
+                    sink.skip(objLine, why);
+                } else if (!sink.add(std::move(q), objLine)) {
+                    return;
+                }
+            }
+        }
+    }
+    if (depth > 0) sink.skip(objLine, "neukončený JSON objekt");
+}
+
+/* ---------- XML ---------- */
+
+void parseXml(QFile &file, RecordSink &sink)
+{
+    QXmlStreamReader xml(&file);
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (!xml.isStartElement()) continue;
+        if (xml.name() != QLatin1String("item") && xml.name() != QLatin1String("question")) continue;
+
+        const int line = static_cast<int>(xml.lineNumber());
+        Question q;
+        const QString typeStr = xml.attributes().value("type").toString();
+        const bool typeOk = parseType(typeStr.isEmpty() ? QString("single") : typeStr, &q.type);
+        while (xml.readNextStartElement()) {
+            if (xml.name() == QLatin1String("text")) {
+                q.text = xml.readElementText();
+            } else if (xml.name() == QLatin1String("option")) {
+                Answer a;
+                a.correct = parseBool(xml.attributes().value("correct").toString());
+                a.text = xml.readElementText().trimmed();
+                if (!a.text.isEmpty()) q.options.append(a);
+            } else if (xml.name() == QLatin1String("expected") || xml.name() == QLatin1String("expected_text")) {
+                q.expectedText = xml.readElementText().trimmed();
+            } else {
+                xml.skipCurrentElement();
+            }
+        }
+        if (!typeOk) {
+            sink.skip(line, QString("neznámý typ otázky '%1'").arg(typeStr));
+            continue;
+        }
+        if (!sink.add(std::move(q), line)) return;
+    }
+    if (xml.hasError()) {
+        sink.fatalError = QString("Chyba XML na řádku %1: %2").arg(xml.lineNumber()).arg(xml.errorString());
+    }
+}
+
+} // namespace
+
+bool QuestionImporter::formatForFile(const QString &path, Format *format)
+{
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "csv" || suffix == "txt") { *format = Format::Csv; return true; }
+    if (suffix == "json" || suffix == "jsonl") { *format = Format::Json; return true; }
+    if (suffix == "xml" || suffix == "qti") { *format = Format::Xml; return true; }
+    return false;
+}
+
+bool QuestionImporter::importFile(const QString &path, const QString &testId, Stats *stats, QString *err)
+{
+    Format format;
+    if (!formatForFile(path, &format)) {
+        if (err) *err = "Nepodporovaný formát souboru (očekáváno CSV, JSON nebo XML).";
+        return false;
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (err) *err = file.errorString();
+        return false;
+    }
+
+    BatchQueue queue(4);
+    RecordSink sink(&queue, testId);
+
+    // parser thread: file -> validated batches
+    QThread *parser = QThread::create([&]() {
+        switch (format) {
+        case Format::Csv: parseCsv(file, sink); break;
+        case Format::Json: parseJson(file, sink); break;
+        case Format::Xml: parseXml(file, sink); break;
+        }
+        if (!sink.fatalError.isEmpty()) { queue.abort(); return; }
+        sink.flush();
+        queue.finish();
+    });
+    parser->start();
+
+    // writer (this thread owns the DB connection): batches -> one transaction
+    int imported = 0;
+    bool ok = DBManager::instance().importQuestions([&](QVector<Question> &batch, QString *batchErr) {
+        switch (queue.pop(batch)) {
+        case BatchQueue::Batch: return true;
+        case BatchQueue::Finished: batch.clear(); return true;
+        case BatchQueue::Aborted: break;
+        }
+        if (batchErr) *batchErr = sink.fatalError;
+        return false;
+    }, &imported, err);
+    if (!ok) queue.abort();
+    parser->wait();
+    delete parser;
+
+    if (stats) {
+        stats->imported = ok ? imported : 0;
+        stats->skipped = sink.skipped;
+        stats->warnings = sink.warnings;
+    }
+    return ok;
+}
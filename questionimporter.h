@@ -0,0 +1,42 @@
+#ifndef QUESTIONIMPORTER_H
+#define QUESTIONIMPORTER_H
+
+#include <QString>
+#include <QStringList>
+#include "models.h"
+
+// Bulk import of question banks.
+// The file is parsed on a worker thread which hands validated questions in
+// batches to the writer (calling thread, owner of the DB connection); all
+// questions are inserted with reused prepared statements in one transaction.
+//
+// Supported formats:
+//  - CSV (',' or ';' separated, optional header):
+//      type, text, expected_text, option1, correct1, option2, correct2, ...
+//    type is single/multiple/text (or 0/1/2), correct is 1/0, true/false, ano/ne
+//  - JSON: array of objects or one object per line (JSON Lines)
+//      {"type": "single", "text": "...", "expected_text": "...",
+//       "options": [{"text": "...", "correct": true}, ...]}
+//  - XML (simplified QTI-like):
+//      <items><item type="single"><text>...</text>
+//        <option correct="true">...</option><expected>...</expected></item></items>
+class QuestionImporter
+{
+public:
+    enum class Format { Csv, Json, Xml };
+
+    struct Stats {
+        int imported = 0;
+        int skipped = 0;
+        QStringList warnings; // per-record problems (skipped records), at most MaxWarnings
+    };
+    static const int MaxWarnings = 100;
+    static const int BatchSize = 500;
+
+    static bool formatForFile(const QString &path, Format *format);
+
+    // import all questions of the file into test testId; on error nothing is written
+    static bool importFile(const QString &path, const QString &testId, Stats *stats, QString *err = nullptr);
+};
+
+#endif // QUESTIONIMPORTER_H
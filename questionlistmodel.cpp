@@ -0,0 +1,135 @@
+#include "questionlistmodel.h"
+#include "dbmanager.h"
+#include <QDebug>
+
+QuestionListModel::QuestionListModel(QVector<Question> *questions, QObject *parent)
+    : QAbstractListModel(parent), mQuestions(questions)
+{
+}
+
+int QuestionListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return mQuestions->size();
+}
+
+QVariant QuestionListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= mQuestions->size()) return QVariant();
+    const Question &q = mQuestions->at(index.row());
+    if (role == Qt::DisplayRole) {
+        QString label = q.text;
+        if (label.length() > 80) label = label.left(77) + "...";
+        return label;
+    }
+    if (role == Qt::ToolTipRole) return q.text;
+    return QVariant();
+}
+
+bool QuestionListModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return false;
+    return !mAllFetched;
+}
+
+void QuestionListModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || mAllFetched) return;
+    QString err;
+    if (!fetchPage(&err)) {
+        qDebug() << "Loading questions page failed:" << err;
+        mAllFetched = true; // do not retry in a loop from the view
+    }
+}
+
+bool QuestionListModel::fetchPage(QString *err)
+{
+    QVector<Question> page;
+    qint64 lastRowId = mLastRowId;
+    if (!DBManager::instance().loadQuestionsPage(mTestId, mLastRowId, PageSize, page, &lastRowId, err))
+        return false;
+    mLastRowId = lastRowId;
+    if (page.size() < PageSize) mAllFetched = true;
+    if (page.isEmpty()) return true;
+
+    int first = mQuestions->size();
+    beginInsertRows(QModelIndex(), first, first + page.size() - 1);
+    mQuestions->append(page);
+    endInsertRows();
+    return true;
+}
+
+bool QuestionListModel::loadTest(const QString &testId, QString *err)
+{
+    beginResetModel();
+    mQuestions->clear();
+    mTestId = testId;
+    mLastRowId = 0;
+    mAllFetched = false;
+    endResetModel();
+    return fetchPage(err);
+}
+
+void QuestionListModel::clear()
+{
+    beginResetModel();
+    mQuestions->clear();
+    mTestId.clear();
+    mLastRowId = 0;
+    mAllFetched = true;
+    endResetModel();
+}
+
+bool QuestionListModel::fetchAll(QString *err)
+{
+    while (!mAllFetched) {
+        if (!fetchPage(err)) return false;
+    }
+    return true;
+}
+
+void QuestionListModel::appendQuestion(const Question &q)
+{
+    // a new question gets the highest rowid; later pages would return it again
+    QString err;
+    if (!fetchAll(&err)) qDebug() << "Loading remaining questions failed:" << err;
+    mAllFetched = true;
+
+    int row = mQuestions->size();
+    beginInsertRows(QModelIndex(), row, row);
+    mQuestions->append(q);
+    endInsertRows();
+}
+
+void QuestionListModel::removeQuestion(int row)
+{
+    if (row < 0 || row >= mQuestions->size()) return;
+    beginRemoveRows(QModelIndex(), row, row);
+    mQuestions->removeAt(row);
+    endRemoveRows();
+}
+
+void QuestionListModel::questionChanged(int row)
+{
+    if (row < 0 || row >= mQuestions->size()) return;
+    QModelIndex idx = index(row);
+    emit dataChanged(idx, idx);
+}
+
+int QuestionListModel::rowOfId(const QString &questionId)
+{
+    int from = 0;
+    for (;;) {
+        for (int i = from; i < mQuestions->size(); ++i) {
+            if (mQuestions->at(i).id == questionId) return i;
+        }
+        if (mAllFetched) return -1;
+        from = mQuestions->size();
+        QString err;
+        if (!fetchPage(&err)) {
+            qDebug() << "Loading questions page failed:" << err;
+            mAllFetched = true;
+            return -1;
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef QUESTIONLISTMODEL_H
+#define QUESTIONLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include "models.h"
+
+// List model over the questions vector owned by MainWindow (mQuestions).
+// Questions of a test are loaded from DBManager page by page (fetchMore),
+// edits are reported per row so the view keeps its selection.
+class QuestionListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    static const int PageSize = 200;
+
+    explicit QuestionListModel(QVector<Question> *questions, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    // replace content by the first page of questions of the test
+    bool loadTest(const QString &testId, QString *err = nullptr);
+    void clear();
+    // load all remaining pages (needed before appending new rows at the end)
+    bool fetchAll(QString *err = nullptr);
+
+    void appendQuestion(const Question &q);
+    void removeQuestion(int row);
+    // call after mQuestions[row] was modified in place
+    void questionChanged(int row);
+
+    // row of question with given id, pages are fetched until it is found; -1 if not present
+    int rowOfId(const QString &questionId);
+
+private:
+    bool fetchPage(QString *err);
+
+    QVector<Question> *mQuestions;
+    QString mTestId;
+    qint64 mLastRowId = 0; // keyset cursor (questions.rowid of last loaded row)
+    bool mAllFetched = true;
+};
+
+#endif // QUESTIONLISTMODEL_H
@@ -0,0 +1,472 @@
+#include "questiontemplate.h"
+#include <QRandomGenerator>
+#include <QVarLengthArray>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+/* recursive descent parser emitting postfix code */
+class QuestionTemplate::Parser
+{
+public:
+    Parser(const QString &text, const QStringList &names, Expr *out)
+        : mText(text), mNames(names), mOut(out) {}
+
+    bool parse(QString *err)
+    {
+        mOut->code.clear();
+        mOut->consts.clear();
+        mOut->maxStack = 0;
+        mDepth = 0;
+        if (!parseOr()) return fail(err);
+        skipSpace();
+        if (mPos < mText.size()) {
+            mError = QString("neočekávaný znak '%1'").arg(mText[mPos]);
+            return fail(err);
+        }
+        return true;
+    }
+
+private:
+    bool fail(QString *err)
+    {
+        if (err) *err = mError.isEmpty() ? QString("chybný výraz") : mError;
+        return false;
+    }
+    void skipSpace()
+    {
+        while (mPos < mText.size() && mText[mPos].isSpace()) ++mPos;
+    }
+    bool accept(const char *token)
+    {
+        skipSpace();
+        const QLatin1String t(token);
+        if (!QStringView(mText).mid(mPos).startsWith(t)) return false;
+        // "<" must not take the first half of "<=" (nor "!" of "!=")
+        if (t.size() == 1 && std::strchr("<>!", token[0]) && mPos + 1 < mText.size() && mText[mPos + 1] == '=')
+            return false;
+        mPos += t.size();
+        return true;
+    }
+    void put(Op op, int arg = 0, int argc = 0)
+    {
+        Instr in;
+        in.op = op;
+        in.argc = quint8(argc);
+        in.arg = arg;
+        mOut->code.append(in);
+        // stack effect
+        if (op == PushConst || op == PushVar) ++mDepth;
+        else if (op == Call) mDepth -= argc - 1;
+        else if (op != Neg && op != Not) --mDepth;
+        mOut->maxStack = qMax(mOut->maxStack, mDepth);
+    }
+
+    bool parseOr()
+    {
+        if (!parseAnd()) return false;
+        while (accept("||")) {
+            if (!parseAnd()) return false;
+            put(Or);
+        }
+        return true;
+    }
+    bool parseAnd()
+    {
+        if (!parseCmp()) return false;
+        while (accept("&&")) {
+            if (!parseCmp()) return false;
+            put(And);
+        }
+        return true;
+    }
+    bool parseCmp()
+    {
+        if (!parseAdd()) return false;
+        static const struct { const char *tok; Op op; } ops[] = {
+            { "<=", Le }, { ">=", Ge }, { "==", Eq }, { "!=", Ne }, { "<", Lt }, { ">", Gt }
+        };
+        for (const auto &o : ops) {
+            if (accept(o.tok)) {
+                if (!parseAdd()) return false;
+                put(o.op);
+                break;
+            }
+        }
+        return true;
+    }
+    bool parseAdd()
+    {
+        if (!parseMul()) return false;
+        for (;;) {
+            if (accept("+")) {
+                if (!parseMul()) return false;
+                put(Add);
+            } else if (accept("-")) {
+                if (!parseMul()) return false;
+                put(Sub);
+            } else {
+                return true;
+            }
+        }
+    }
+    bool parseMul()
+    {
+        if (!parseUnary()) return false;
+        for (;;) {
+            Op op;
+            if (accept("*")) op = Mul;
+            else if (accept("/")) op = Div;
+            else if (accept("%")) op = Mod;
+            else return true;
+            if (!parseUnary()) return false;
+            put(op);
+        }
+    }
+    bool parseUnary()
+    {
+        if (accept("-")) {
+            if (!parseUnary()) return false;
+            put(Neg);
+            return true;
+        }
+        if (accept("!")) {
+            if (!parseUnary()) return false;
+            put(Not);
+            return true;
+        }
+        return parsePow();
+    }
+    bool parsePow()
+    {
+        if (!parsePrimary()) return false;
+        if (accept("^")) {
+            // right associative, binds tighter than unary minus on the left: -2^2 = -4
+            if (!parseUnary()) return false;
+            put(Pow);
+        }
+        return true;
+    }
+    bool parsePrimary()
+    {
+        skipSpace();
+        if (mPos >= mText.size()) {
+            mError = "neúplný výraz";
+            return false;
+        }
+        if (accept("(")) {
+            if (!parseOr()) return false;
+            if (!accept(")")) {
+                mError = "chybí ')'";
+                return false;
+            }
+            return true;
+        }
+        const QChar c = mText[mPos];
+        if (c.isDigit() || c == '.') {
+            int end = mPos;
+            while (end < mText.size() && (mText[end].isDigit() || mText[end] == '.')) ++end;
+            bool ok = false;
+            const double v = mText.mid(mPos, end - mPos).toDouble(&ok);
+            if (!ok) {
+                mError = "chybné číslo " + mText.mid(mPos, end - mPos);
+                return false;
+            }
+            mPos = end;
+            mOut->consts.append(v);
+            put(PushConst, mOut->consts.size() - 1);
+            return true;
+        }
+        if (c.isLetter() || c == '_') {
+            int end = mPos;
+            while (end < mText.size() && (mText[end].isLetterOrNumber() || mText[end] == '_')) ++end;
+            const QString name = mText.mid(mPos, end - mPos);
+            mPos = end;
+            if (accept("(")) return parseCall(name);
+            const int slot = mNames.indexOf(name);
+            if (slot < 0) {
+                mError = "neznámý název " + name;
+                return false;
+            }
+            put(PushVar, slot);
+            return true;
+        }
+        mError = QString("neočekávaný znak '%1'").arg(c);
+        return false;
+    }
+    bool parseCall(const QString &name)
+    {
+        static const struct { const char *name; Func f; int minArgs; int maxArgs; } funcs[] = {
+            { "abs", FAbs, 1, 1 }, { "sqrt", FSqrt, 1, 1 }, { "floor", FFloor, 1, 1 }, { "ceil", FCeil, 1, 1 },
+            { "round", FRound, 1, 2 }, { "min", FMin, 2, 2 }, { "max", FMax, 2, 2 }, { "gcd", FGcd, 2, 2 }
+        };
+        int argc = 0;
+        if (!accept(")")) {
+            do {
+                if (!parseOr()) return false;
+                ++argc;
+            } while (accept(","));
+            if (!accept(")")) {
+                mError = "chybí ')' za argumenty " + name;
+                return false;
+            }
+        }
+        for (const auto &f : funcs) {
+            if (name != QLatin1String(f.name)) continue;
+            if (argc < f.minArgs || argc > f.maxArgs) {
+                mError = QString("špatný počet argumentů funkce %1").arg(name);
+                return false;
+            }
+            put(Call, f.f, argc);
+            return true;
+        }
+        mError = "neznámá funkce " + name;
+        return false;
+    }
+
+    const QString &mText;
+    const QStringList &mNames;
+    Expr *mOut;
+    int mPos = 0;
+    int mDepth = 0;
+    QString mError;
+};
+
+double QuestionTemplate::Expr::eval(const double *vars, double *stack) const
+{
+    int sp = 0;
+    for (const Instr &in : code) {
+        switch (in.op) {
+        case PushConst: stack[sp++] = consts[in.arg]; break;
+        case PushVar: stack[sp++] = vars[in.arg]; break;
+        case Neg: stack[sp - 1] = -stack[sp - 1]; break;
+        case Not: stack[sp - 1] = stack[sp - 1] == 0.0 ? 1.0 : 0.0; break;
+        case Call: {
+            sp -= in.argc;
+            double *a = stack + sp;
+            double r = 0.0;
+            switch (Func(in.arg)) {
+            case FAbs: r = std::fabs(a[0]); break;
+            case FSqrt: r = std::sqrt(a[0]); break;
+            case FFloor: r = std::floor(a[0]); break;
+            case FCeil: r = std::ceil(a[0]); break;
+            case FRound: {
+                const double scale = in.argc > 1 ? std::pow(10.0, std::round(a[1])) : 1.0;
+                r = std::round(a[0] * scale) / scale;
+                break;
+            }
+            case FMin: r = qMin(a[0], a[1]); break;
+            case FMax: r = qMax(a[0], a[1]); break;
+            case FGcd: r = double(std::gcd(qint64(std::llround(a[0])), qint64(std::llround(a[1])))); break;
+            }
+            stack[sp++] = r;
+            break;
+        }
+        default: {
+            const double y = stack[--sp];
+            double &x = stack[sp - 1];
+            switch (in.op) {
+            case Add: x = x + y; break;
+            case Sub: x = x - y; break;
+            case Mul: x = x * y; break;
+            case Div: x = x / y; break;
+            case Mod: x = std::fmod(x, y); break;
+            case Pow: x = std::pow(x, y); break;
+            case Lt: x = x < y; break;
+            case Le: x = x <= y; break;
+            case Gt: x = x > y; break;
+            case Ge: x = x >= y; break;
+            case Eq: x = std::fabs(x - y) <= 1e-9 * qMax(1.0, qMax(std::fabs(x), std::fabs(y))); break;
+            case Ne: x = std::fabs(x - y) > 1e-9 * qMax(1.0, qMax(std::fabs(x), std::fabs(y))); break;
+            case And: x = (x != 0.0 && y != 0.0); break;
+            case Or: x = (x != 0.0 || y != 0.0); break;
+            default: break;
+            }
+        }
+        }
+    }
+    return sp > 0 ? stack[sp - 1] : 0.0;
+}
+
+bool QuestionTemplate::compileExpr(const QString &text, Expr *out, QString *err) const
+{
+    Parser p(text, mNames, out);
+    return p.parse(err);
+}
+
+bool QuestionTemplate::compile(const QString &definition, QString *err)
+{
+    mNames.clear();
+    mVars.clear();
+    mConstraints.clear();
+    mAnswer = -1;
+    mMaxStack = 0;
+
+    const QStringList lines = definition.split('\n');
+    for (int ln = 0; ln < lines.size(); ++ln) {
+        QString line = lines[ln];
+        const int hash = line.indexOf('#');
+        if (hash >= 0) line.truncate(hash);
+        line = line.trimmed();
+        if (line.isEmpty()) continue;
+        QString e;
+        auto lineError = [&](const QString &msg) {
+            if (err) *err = QString("Řádek %1: %2").arg(ln + 1).arg(msg);
+            mAnswer = -1;
+            return false;
+        };
+
+        if (line.startsWith("where ")) {
+            Expr c;
+            if (!compileExpr(line.mid(6), &c, &e)) return lineError(e);
+            mMaxStack = qMax(mMaxStack, c.maxStack);
+            mConstraints.append(c);
+            continue;
+        }
+        const int eq = line.indexOf('=');
+        if (eq <= 0 || line.mid(eq, 2) == "==") return lineError("očekáváno 'název = výraz' nebo 'where podmínka'");
+        const QString name = line.left(eq).trimmed();
+        if (name.isEmpty() || !(name[0].isLetter() || name[0] == '_')
+            || !std::all_of(name.begin(), name.end(), [](QChar ch) { return ch.isLetterOrNumber() || ch == '_'; })) {
+            return lineError("neplatný název " + name);
+        }
+        if (mNames.contains(name)) return lineError("název " + name + " už je definován");
+        QString rhs = line.mid(eq + 1).trimmed();
+
+        Var v;
+        const int range = rhs.indexOf("..");
+        if (range >= 0) {
+            v.random = true;
+            QString hi = rhs.mid(range + 2);
+            const int step = hi.indexOf(" step ");
+            if (step >= 0) {
+                v.hasStep = true;
+                if (!compileExpr(hi.mid(step + 6), &v.step, &e)) return lineError(e);
+                hi.truncate(step);
+            }
+            if (!compileExpr(rhs.left(range), &v.value, &e)) return lineError(e);
+            if (!compileExpr(hi, &v.hi, &e)) return lineError(e);
+        } else if (!compileExpr(rhs, &v.value, &e)) {
+            return lineError(e);
+        }
+        v.slot = mNames.size();
+        mMaxStack = qMax(mMaxStack, qMax(v.value.maxStack, qMax(v.hi.maxStack, v.step.maxStack)));
+        mNames.append(name);
+        mVars.append(v);
+        if (name == "answer") {
+            if (v.random) return lineError("answer musí být vypočtená hodnota");
+            mAnswer = v.slot;
+        }
+    }
+    if (mAnswer < 0) {
+        if (err) *err = "Chybí řádek 'answer = výraz'.";
+        return false;
+    }
+    return true;
+}
+
+bool QuestionTemplate::evaluate(quint32 seed, QVector<double> *values) const
+{
+    if (!isValid()) return false;
+    values->resize(mNames.size());
+    double *vars = values->data();
+    QVarLengthArray<double, 32> stack(qMax(1, mMaxStack));
+    QRandomGenerator rng(seed);
+    for (int attempt = 0; attempt < MaxTries; ++attempt) {
+        bool ok = true;
+        for (const Var &v : mVars) {
+            if (!v.random) {
+                vars[v.slot] = v.value.eval(vars, stack.data());
+                continue;
+            }
+            const double lo = v.value.eval(vars, stack.data());
+            const double hi = v.hi.eval(vars, stack.data());
+            const double step = v.hasStep ? v.step.eval(vars, stack.data()) : 1.0;
+            const double n = std::floor((hi - lo) / step + 1e-9) + 1.0;
+            if (!(step > 0.0) || !(n >= 1.0) || n > 4294967295.0) {
+                ok = false;
+                break;
+            }
+            // lo + k*step, rounded so that 0.1-steps do not print as 0.30000000000000004
+            const double k = double(rng.bounded(quint32(n)));
+            vars[v.slot] = std::round((lo + k * step) * 1e9) / 1e9;
+        }
+        if (!ok) continue;
+        for (const Expr &c : mConstraints) {
+            if (c.eval(vars, stack.data()) == 0.0) {
+                ok = false;
+                break;
+            }
+        }
+        if (ok && std::isfinite(vars[mAnswer])) return true;
+    }
+    return false;
+}
+
+QString QuestionTemplate::formatNumber(double v)
+{
+    const double r = std::round(v);
+    if (std::fabs(v - r) <= 1e-9 * qMax(1.0, std::fabs(v)) && std::fabs(r) < 1e15) return QString::number(qint64(r));
+    return QString::number(v, 'g', 12);
+}
+
+QString QuestionTemplate::fill(const QString &text, const QVector<double> &values) const
+{
+    if (!text.contains('{')) return text;
+    QString out;
+    out.reserve(text.size() + 16);
+    int pos = 0;
+    while (pos < text.size()) {
+        const int open = text.indexOf('{', pos);
+        const int close = open >= 0 ? text.indexOf('}', open + 1) : -1;
+        if (close < 0) break;
+        const int slot = mNames.indexOf(text.mid(open + 1, close - open - 1).trimmed());
+        out += QStringView(text).mid(pos, open - pos);
+        if (slot >= 0) out += formatNumber(values[slot]);
+        else out += QStringView(text).mid(open, close - open + 1); // not a placeholder
+        pos = close + 1;
+    }
+    out += QStringView(text).mid(pos);
+    return out;
+}
+
+bool QuestionTemplate::instantiate(const Question &q, quint32 seed, Question *out) const
+{
+    *out = q;
+    QVector<double> values;
+    if (!evaluate(seed, &values)) return false;
+    out->text = fill(q.text, values);
+    for (Answer &a : out->options) a.text = fill(a.text, values);
+    if (q.type == QuestionType::TextAnswer) {
+        out->expectedText = formatNumber(values[mAnswer]);
+        out->numericKey = true;
+    }
+    return true;
+}
+
+quint32 QuestionTemplate::seedFor(quint32 attemptSeed, const QString &questionId)
+{
+    // FNV-1a over the attempt seed and the question id
+    quint32 h = 2166136261u;
+    for (int i = 0; i < 4; ++i) {
+        h ^= (attemptSeed >> (8 * i)) & 0xFF;
+        h *= 16777619u;
+    }
+    for (QChar c : questionId) {
+        h ^= c.unicode();
+        h *= 16777619u;
+    }
+    return h;
+}
+
+quint32 QuestionTemplate::seedFor(const QString &attemptKey, const QString &questionId)
+{
+    quint32 h = 2166136261u;
+    for (QChar c : attemptKey) {
+        h ^= c.unicode();
+        h *= 16777619u;
+    }
+    return seedFor(h, questionId);
+}
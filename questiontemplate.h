@@ -0,0 +1,82 @@
+#ifndef QUESTIONTEMPLATE_H
+#define QUESTIONTEMPLATE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "models.h"
+
+// Parametric question: the question (and option) texts contain placeholders
+// {name}, the definition says how the values are drawn and how the answer is
+// computed. One statement per line, '#' starts a comment:
+//
+//   a = 2..12              random integer from the range
+//   b = 0.5..2.5 step 0.5  random value on a grid (bounds may use earlier names)
+//   c = a * b              computed value
+//   where a % b != 0       constraint, values are drawn again until all hold
+//   answer = round(c / 3, 2)
+//
+// Expressions: numbers, names, + - * / % ^, comparisons, && || !, and the
+// functions abs sqrt floor ceil round(x[, digits]) min max gcd. Every expression
+// is compiled once into bytecode for a small stack machine, so instantiating a
+// question is a few hundred instructions. Instances are fully determined by the
+// seed: the exam host and the student window derive it from the attempt, and
+// grading recomputes the key from the same seed.
+class QuestionTemplate
+{
+public:
+    static const int MaxTries = 1000; // draws before the constraints are given up
+
+    bool compile(const QString &definition, QString *err = nullptr);
+    bool isValid() const { return mAnswer >= 0; }
+    QStringList names() const { return mNames; }
+
+    // values of all names (answer last); false when no draw met the constraints
+    bool evaluate(quint32 seed, QVector<double> *values) const;
+    // q with placeholders filled in and the computed answer as expectedText
+    // (text answers) or as the value of {answer} in option texts
+    bool instantiate(const Question &q, quint32 seed, Question *out) const;
+
+    // per-question seed of an attempt (stable, not qHash: it must survive restarts)
+    static quint32 seedFor(quint32 attemptSeed, const QString &questionId);
+    static quint32 seedFor(const QString &attemptKey, const QString &questionId);
+    static QString formatNumber(double v);
+
+private:
+    enum Op : quint8 {
+        PushConst, PushVar, Neg, Not, Add, Sub, Mul, Div, Mod, Pow,
+        Lt, Le, Gt, Ge, Eq, Ne, And, Or, Call
+    };
+    enum Func : quint8 { FAbs, FSqrt, FFloor, FCeil, FRound, FMin, FMax, FGcd };
+    struct Instr {
+        Op op;
+        quint8 argc; // Call
+        qint32 arg;  // constant index / variable slot / function
+    };
+    struct Expr {
+        QVector<Instr> code;
+        QVector<double> consts;
+        int maxStack = 0;
+        double eval(const double *vars, double *stack) const;
+    };
+    struct Var {
+        int slot = 0;
+        bool random = false;
+        Expr value; // computed value, or lower bound of a random one
+        Expr hi;
+        Expr step;
+        bool hasStep = false;
+    };
+    class Parser;
+
+    bool compileExpr(const QString &text, Expr *out, QString *err) const;
+    QString fill(const QString &text, const QVector<double> &values) const;
+
+    QStringList mNames;         // slot -> name
+    QVector<Var> mVars;         // in definition order
+    QVector<Expr> mConstraints;
+    int mAnswer = -1;           // slot of "answer"
+    int mMaxStack = 0;
+};
+
+#endif // QUESTIONTEMPLATE_H
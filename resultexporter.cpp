@@ -0,0 +1,144 @@
+#include "resultexporter.h"
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QDateTime>
+#include <QBuffer>
+#include <QtEndian>
+
+namespace {
+
+QByteArray csvField(const QString &s)
+{
+    QByteArray f = s.toUtf8();
+    if (f.contains(',') || f.contains('"') || f.contains('\n') || f.contains('\r')) {
+        f.replace("\"", "\"\"");
+        f = '"' + f + '"';
+    }
+    return f;
+}
+
+bool writeCsvPage(QSaveFile &out, const QVector<DBManager::ResultRecord> &page)
+{
+    QByteArray buf;
+    for (const DBManager::ResultRecord &r : page) {
+        QByteArray head = QByteArray::number(r.id) + ',' + csvField(r.studentEmail) + ',' + csvField(r.testId) + ','
+                          + csvField(r.timestamp) + ',' + QByteArray::number(r.score) + ','
+                          + QByteArray::number(r.total) + ',';
+        if (r.details.isEmpty()) {
+            buf += head + ",,\n";
+            continue;
+        }
+        for (const DBManager::ResultDetail &d : r.details) {
+            buf += head + csvField(d.questionId) + ',' + (d.correct ? "1" : "0") + ',' + csvField(d.userAnswer) + '\n';
+        }
+    }
+    return out.write(buf) == buf.size();
+}
+
+// offsets + one UTF-8 blob, readers can slice strings without parsing
+void writeStringColumn(QDataStream &ds, const QStringList &values)
+{
+    QByteArray blob;
+    for (const QString &v : values) {
+        blob += v.toUtf8();
+        ds << quint32(blob.size());
+    }
+    ds << quint32(blob.size());
+    ds.writeRawData(blob.constData(), blob.size());
+}
+
+bool writeBinaryChunk(QSaveFile &out, const QVector<DBManager::ResultRecord> &page)
+{
+    QByteArray raw;
+    QBuffer buffer(&raw);
+    buffer.open(QIODevice::WriteOnly);
+    QDataStream ds(&buffer);
+    ds.setByteOrder(QDataStream::LittleEndian);
+    ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
+
+    ds << quint32(page.size());
+    QStringList emails, testIds;
+    for (const DBManager::ResultRecord &r : page) ds << qint64(r.id);
+    for (const DBManager::ResultRecord &r : page) { emails << r.studentEmail; testIds << r.testId; }
+    writeStringColumn(ds, emails);
+    writeStringColumn(ds, testIds);
+    for (const DBManager::ResultRecord &r : page)
+        ds << qint64(QDateTime::fromString(r.timestamp, Qt::ISODate).toMSecsSinceEpoch());
+    for (const DBManager::ResultRecord &r : page) ds << r.score;
+    for (const DBManager::ResultRecord &r : page) ds << qint32(r.total);
+
+    quint32 detailCount = 0;
+    for (const DBManager::ResultRecord &r : page) detailCount += r.details.size();
+    ds << detailCount;
+    QStringList questionIds, answers;
+    for (const DBManager::ResultRecord &r : page) {
+        for (const DBManager::ResultDetail &d : r.details) {
+            ds << qint64(r.id);
+            questionIds << d.questionId;
+            answers << d.userAnswer;
+        }
+    }
+    writeStringColumn(ds, questionIds);
+    for (const DBManager::ResultRecord &r : page)
+        for (const DBManager::ResultDetail &d : r.details) ds << quint8(d.correct ? 1 : 0);
+    writeStringColumn(ds, answers);
+    buffer.close();
+
+    const QByteArray packed = qCompress(raw);
+    QByteArray len(4, Qt::Uninitialized);
+    qToLittleEndian<quint32>(packed.size(), len.data());
+    return out.write(len) == 4 && out.write(packed) == packed.size();
+}
+
+} // namespace
+
+ResultExporter::Format ResultExporter::formatForFile(const QString &path)
+{
+    return QFileInfo(path).suffix().toLower() == "csv" ? Format::Csv : Format::Binary;
+}
+
+bool ResultExporter::exportResults(const QString &path, Format format, const DBManager::ResultFilter &filter,
+                                   qint64 *exportedResults, QString *err)
+{
+    if (exportedResults) *exportedResults = 0;
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        if (err) *err = out.errorString();
+        return false;
+    }
+
+    bool ok = true;
+    if (format == Format::Csv) {
+        ok = out.write("\xEF\xBB\xBF" "result_id,student_email,test_id,timestamp,score,total,question_id,correct,user_answer\n") > 0;
+    } else {
+        QByteArray header("QTMRES01", 8);
+        QByteArray version(4, Qt::Uninitialized);
+        qToLittleEndian<quint32>(1, version.data());
+        ok = out.write(header + version) == 12;
+    }
+
+    qint64 count = 0;
+    DBManager::ResultCursor cursor; // walks the working DB and then the archives
+    QVector<DBManager::ResultRecord> page;
+    while (ok) {
+        if (!DBManager::instance().loadResultsPage(filter, &cursor, PageSize, page, err)) {
+            out.cancelWriting();
+            return false;
+        }
+        if (page.isEmpty()) break;
+        ok = (format == Format::Csv) ? writeCsvPage(out, page) : writeBinaryChunk(out, page);
+        count += page.size();
+    }
+    if (ok && format == Format::Binary) {
+        QByteArray end(4, '\0');
+        ok = out.write(end) == 4;
+    }
+    if (!ok || !out.commit()) {
+        if (err) *err = out.errorString();
+        out.cancelWriting();
+        return false;
+    }
+    if (exportedResults) *exportedResults = count;
+    return true;
+}
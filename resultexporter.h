@@ -0,0 +1,34 @@
+#ifndef RESULTEXPORTER_H
+#define RESULTEXPORTER_H
+
+#include <QString>
+#include "dbmanager.h"
+
+// Streams results joined with result_details into a file.
+// Rows are read with keyset pagination on results.id (store by store when
+// filter.includeArchived is set), so memory use is bounded
+// by one page regardless of the number of exported results.
+//
+// CSV: UTF-8 with BOM, one line per result detail:
+//   result_id,student_email,test_id,timestamp,score,total,question_id,correct,user_answer
+//
+// Binary (.qtr), little endian:
+//   header   "QTMRES01" (8 bytes), quint32 format version (1)
+//   chunks   quint32 length + qCompress()ed chunk, length 0 terminates the file
+//   chunk    quint32 n; results columns: qint64 id[n], str email[n], str test_id[n],
+//            qint64 timestamp_ms[n], double score[n], qint32 total[n];
+//            quint32 m; detail columns: qint64 result_id[m], str question_id[m],
+//            quint8 correct[m], str user_answer[m]
+//   str col  quint32 end offsets[count] followed by quint32 blob size and UTF-8 blob
+class ResultExporter
+{
+public:
+    enum class Format { Csv, Binary };
+    static const int PageSize = 2000;
+
+    static Format formatForFile(const QString &path);
+    static bool exportResults(const QString &path, Format format, const DBManager::ResultFilter &filter,
+                              qint64 *exportedResults = nullptr, QString *err = nullptr);
+};
+
+#endif // RESULTEXPORTER_H
@@ -0,0 +1,101 @@
+#include "resultreport.h"
+#include "grading.h"
+#include "mailqueue.h"
+#include <QThreadPool>
+#include <QDateTime>
+#include <atomic>
+
+DBManager::OutgoingMail ResultReport::render(const DBManager::ResultRecord &r, const TestInfo &test)
+{
+    DBManager::OutgoingMail m;
+    m.resultId = r.id;
+    m.recipient = r.studentEmail.trimmed();
+    m.subject = "Výsledek testu: " + test.name;
+
+    QString body;
+    body.reserve(256 + 160 * r.details.size());
+    body += "Dobrý den,\n\n";
+    body += QString("výsledek testu \"%1\"").arg(test.name);
+    const QDateTime when = QDateTime::fromString(r.timestamp, Qt::ISODate);
+    if (when.isValid()) body += " ze dne " + when.toLocalTime().toString("d. M. yyyy H:mm");
+    body += ":\n";
+    const int percent = r.total > 0 ? qRound(100.0 * r.score / r.total) : 0;
+    body += QString("Skóre: %1 / %2 (%3 %)\n\n").arg(r.score).arg(r.total).arg(percent);
+    for (int i = 0; i < r.details.size(); ++i) {
+        const DBManager::ResultDetail &d = r.details[i];
+        auto it = test.questions.constFind(d.questionId);
+        const bool known = it != test.questions.constEnd();
+        QString text = known ? it->text.simplified() : QString("(otázka byla mezitím smazána)");
+        if (text.size() > 200) text = text.left(199) + QChar(0x2026);
+        QString answer = d.userAnswer;
+        if (known && it->type == QuestionType::MultipleChoice) answer = Grading::splitChoices(answer).join(", ");
+        body += QString("%1. %2\n   %3, odpověď: %4\n\n")
+                    .arg(i + 1)
+                    .arg(text, d.correct ? "správně" : "špatně", answer.isEmpty() ? "(bez odpovědi)" : answer);
+    }
+    body += "Tato zpráva byla vytvořena automaticky, neodpovídejte na ni.\n";
+    m.body = body;
+    return m;
+}
+
+bool ResultReport::queueReports(const DBManager::ResultFilter &filter, int *queued, int *skipped, QString *err)
+{
+    if (queued) *queued = 0;
+    if (skipped) *skipped = 0;
+    DBManager &db = DBManager::instance();
+    QHash<QString, TestInfo> tests;
+    QThreadPool pool;
+    DBManager::ResultCursor cursor;
+    QVector<DBManager::ResultRecord> page;
+    QVector<DBManager::ResultRecord> next;
+    if (!db.loadResultsPage(filter, &cursor, PageSize, page, err)) return false;
+
+    while (!page.isEmpty()) {
+        // tests of this page are loaded before the workers start reading the cache
+        for (const DBManager::ResultRecord &r : std::as_const(page)) {
+            if (tests.contains(r.testId)) continue;
+            TestInfo info;
+            Test t;
+            bool found = false;
+            QVector<Question> questions;
+            if (!db.loadTest(r.testId, &t, &found, err) || !db.loadQuestionsForTest(r.testId, questions, err))
+                return false;
+            info.name = found ? t.name : r.testId;
+            for (const Question &q : std::as_const(questions)) info.questions.insert(q.id, q);
+            tests.insert(r.testId, info);
+        }
+
+        QVector<DBManager::OutgoingMail> mails(page.size());
+        std::atomic<int> nextIndex{0};
+        auto work = [&]() {
+            for (;;) {
+                const int i = nextIndex++;
+                if (i >= page.size()) return;
+                mails[i] = render(page[i], *std::as_const(tests).constFind(page[i].testId));
+            }
+        };
+        const int workers = qMin(pool.maxThreadCount(), int(page.size()));
+        for (int w = 0; w < workers; ++w) pool.start(work);
+        // the next page is read while this one renders
+        const bool ok = db.loadResultsPage(filter, &cursor, PageSize, next, err);
+        pool.waitForDone();
+        if (!ok) return false;
+
+        // students without a (usable) address get no report
+        QVector<DBManager::OutgoingMail> valid;
+        valid.reserve(mails.size());
+        for (DBManager::OutgoingMail &m : mails) {
+            if (!MailTransport::isValidAddress(m.recipient)) {
+                if (skipped) ++*skipped;
+                continue;
+            }
+            valid.append(std::move(m));
+        }
+        int n = 0;
+        if (!db.enqueueMails(valid, &n, err)) return false;
+        if (queued) *queued += n;
+        page = std::move(next);
+        next.clear();
+    }
+    return true;
+}
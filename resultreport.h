@@ -0,0 +1,32 @@
+#ifndef RESULTREPORT_H
+#define RESULTREPORT_H
+
+#include <QHash>
+#include <QString>
+#include "dbmanager.h"
+
+// Per-student result reports sent by e-mail through the mail queue.
+//
+// queueReports() pages through the results like ResultExporter. While the DB
+// thread reads the next page, the reports of the current one are rendered on
+// a thread pool; each page is then queued in one transaction. Results that
+// already have a report in the queue are skipped, so the job can be repeated
+// after new results come in.
+class ResultReport
+{
+public:
+    static const int PageSize = 500;
+
+    struct TestInfo {
+        QString name;
+        QHash<QString, Question> questions; // by id
+    };
+
+    // mail for one result (plain text, Czech)
+    static DBManager::OutgoingMail render(const DBManager::ResultRecord &r, const TestInfo &test);
+    // queued = new reports in the queue, skipped = results without a usable address
+    static bool queueReports(const DBManager::ResultFilter &filter, int *queued = nullptr, int *skipped = nullptr,
+                             QString *err = nullptr);
+};
+
+#endif // RESULTREPORT_H
@@ -0,0 +1,109 @@
+#include "resultstablemodel.h"
+#include <QDateTime>
+#include <QDebug>
+
+ResultsTableModel::ResultsTableModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+int ResultsTableModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return mRows.size();
+}
+
+int ResultsTableModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return ColumnCount;
+}
+
+QVariant ResultsTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= mRows.size()) return QVariant();
+    const DBManager::ResultRow &r = mRows.at(index.row());
+    if (role == Qt::DisplayRole) {
+        switch (index.column()) {
+        case TimeColumn:
+            // stored as UTC ISO text, only the visible rows get converted
+            return QDateTime::fromString(r.timestamp, Qt::ISODate).toLocalTime().toString("d.M.yyyy H:mm");
+        case StudentColumn:
+            return r.studentEmail;
+        case TestColumn:
+            return r.testName.isEmpty() ? r.testId : r.testName;
+        case ScoreColumn:
+            return QString("%1 / %2").arg(r.score).arg(r.total);
+        case PercentColumn:
+            return r.total > 0 ? QString("%1 %").arg(r.score * 100.0 / r.total, 0, 'f', 0) : QString();
+        }
+    }
+    if (role == Qt::TextAlignmentRole && (index.column() == ScoreColumn || index.column() == PercentColumn))
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    return QVariant();
+}
+
+QVariant ResultsTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return QVariant();
+    switch (section) {
+    case TimeColumn: return "Čas";
+    case StudentColumn: return "Student";
+    case TestColumn: return "Test";
+    case ScoreColumn: return "Skóre";
+    case PercentColumn: return "%";
+    }
+    return QVariant();
+}
+
+bool ResultsTableModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return false;
+    return !mAllFetched;
+}
+
+void ResultsTableModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || mAllFetched) return;
+    QString err;
+    if (!fetchPage(&err)) {
+        qDebug() << "Loading results page failed:" << err;
+        mAllFetched = true; // do not retry in a loop from the view
+    }
+}
+
+bool ResultsTableModel::fetchPage(QString *err)
+{
+    QVector<DBManager::ResultRow> page;
+    if (!DBManager::instance().browseResults(mFilter, &mKey, PageSize, page, err)) return false;
+    if (page.size() < PageSize) mAllFetched = true;
+    if (page.isEmpty()) return true;
+    for (DBManager::ResultRow &r : page) {
+        auto it = mTestNames.constFind(r.testId);
+        if (it == mTestNames.constEnd()) it = mTestNames.insert(r.testId, r.testName);
+        r.testId = it.key();
+        r.testName = it.value();
+    }
+
+    int first = mRows.size();
+    beginInsertRows(QModelIndex(), first, first + page.size() - 1);
+    mRows.append(page);
+    endInsertRows();
+    return true;
+}
+
+bool ResultsTableModel::setFilter(const DBManager::ResultFilter &filter, QString *err)
+{
+    beginResetModel();
+    mRows.clear();
+    mFilter = filter;
+    mKey = DBManager::ResultKey();
+    mAllFetched = false;
+    endResetModel();
+    return fetchPage(err);
+}
+
+const DBManager::ResultRow *ResultsTableModel::row(int row) const
+{
+    return (row >= 0 && row < mRows.size()) ? &mRows.at(row) : nullptr;
+}
@@ -0,0 +1,42 @@
+#ifndef RESULTSTABLEMODEL_H
+#define RESULTSTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include <QHash>
+#include "dbmanager.h"
+
+// Table of saved results (newest first) for the teacher's results browser.
+// Rows are fetched from DBManager::browseResults page by page as the view scrolls
+// (keyset on timestamp and id), so even a very large results table opens at once.
+class ResultsTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    static const int PageSize = 200;
+    enum Column { TimeColumn, StudentColumn, TestColumn, ScoreColumn, PercentColumn, ColumnCount };
+
+    explicit ResultsTableModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    // replace content by the first page of results matching the filter
+    bool setFilter(const DBManager::ResultFilter &filter, QString *err = nullptr);
+    const DBManager::ResultRow *row(int row) const;
+
+private:
+    bool fetchPage(QString *err);
+
+    QVector<DBManager::ResultRow> mRows;
+    DBManager::ResultFilter mFilter;
+    DBManager::ResultKey mKey; // position after the last loaded row
+    QHash<QString, QString> mTestNames; // one shared copy of each test id / name for all rows
+    bool mAllFetched = true;
+};
+
+#endif // RESULTSTABLEMODEL_H
@@ -0,0 +1,109 @@
+#include "similarityindex.h"
+#include <QtEndian>
+#include <limits>
+
+// splitmix64 finalizer, used to derive independent hash functions from one base hash
+static quint64 mix64(quint64 x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// FNV-1a over UTF-16 code units (stable across runs and Qt versions)
+static quint64 fnv1a(const QString &s)
+{
+    quint64 h = 0xCBF29CE484222325ULL;
+    for (QChar c : s) {
+        h ^= c.unicode();
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+QStringList SimilarityIndex::normalizedWords(const QString &text)
+{
+    // lower case, strip diacritics, keep letters and digits only
+    const QString decomposed = text.toLower().normalized(QString::NormalizationForm_D);
+    QString cleaned;
+    cleaned.reserve(decomposed.size());
+    for (QChar c : decomposed) {
+        if (c.isMark()) continue;
+        cleaned.append(c.isLetterOrNumber() ? c : QChar(' '));
+    }
+    return cleaned.split(' ', Qt::SkipEmptyParts);
+}
+
+QVector<quint32> SimilarityIndex::signature(const Question &q)
+{
+    QVector<quint64> shingles;
+    const QStringList words = normalizedWords(q.text);
+    if (words.size() < 3) {
+        for (const QString &w : words) shingles.append(fnv1a(w));
+    } else {
+        for (int i = 0; i + 2 < words.size(); ++i)
+            shingles.append(fnv1a(words[i] + ' ' + words[i+1] + ' ' + words[i+2]));
+    }
+    for (const Answer &a : q.options)
+        shingles.append(fnv1a("\x01" + normalizedWords(a.text).join(' ')));
+    if (q.type == QuestionType::TextAnswer && !q.expectedText.isEmpty())
+        shingles.append(fnv1a("\x02" + normalizedWords(q.expectedText).join(' ')));
+
+    // nothing to compare (empty question) -> empty signature, never a duplicate
+    if (shingles.isEmpty()) return QVector<quint32>();
+
+    QVector<quint32> sig(NumHashes, std::numeric_limits<quint32>::max());
+    for (quint64 base : std::as_const(shingles)) {
+        quint64 h = base;
+        for (int i = 0; i < NumHashes; ++i) {
+            h = mix64(h);
+            quint32 v = static_cast<quint32>(h);
+            if (v < sig[i]) sig[i] = v;
+        }
+    }
+    return sig;
+}
+
+QVector<qint64> SimilarityIndex::bandKeys(const QVector<quint32> &sig)
+{
+    QVector<qint64> keys;
+    if (sig.size() != NumHashes) return keys;
+    keys.reserve(NumBands);
+    for (int b = 0; b < NumBands; ++b) {
+        quint64 h = 0xCBF29CE484222325ULL;
+        for (int r = 0; r < RowsPerBand; ++r) {
+            h ^= sig.value(b * RowsPerBand + r);
+            h *= 0x100000001B3ULL;
+        }
+        // band number in the top byte keeps keys of different bands apart
+        quint64 key = (static_cast<quint64>(b) << 56) | (mix64(h) & 0x00FFFFFFFFFFFFFFULL);
+        keys.append(static_cast<qint64>(key));
+    }
+    return keys;
+}
+
+double SimilarityIndex::similarity(const QVector<quint32> &a, const QVector<quint32> &b)
+{
+    if (a.size() != NumHashes || b.size() != NumHashes) return 0.0;
+    int same = 0;
+    for (int i = 0; i < NumHashes; ++i)
+        if (a[i] == b[i]) ++same;
+    return static_cast<double>(same) / NumHashes;
+}
+
+QByteArray SimilarityIndex::toBlob(const QVector<quint32> &sig)
+{
+    QByteArray blob(sig.size() * 4, Qt::Uninitialized);
+    for (int i = 0; i < sig.size(); ++i)
+        qToLittleEndian<quint32>(sig[i], blob.data() + i * 4);
+    return blob;
+}
+
+QVector<quint32> SimilarityIndex::fromBlob(const QByteArray &blob)
+{
+    QVector<quint32> sig(blob.size() / 4);
+    for (int i = 0; i < sig.size(); ++i)
+        sig[i] = qFromLittleEndian<quint32>(blob.constData() + i * 4);
+    return sig;
+}
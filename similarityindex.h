@@ -0,0 +1,34 @@
+#ifndef SIMILARITYINDEX_H
+#define SIMILARITYINDEX_H
+
+#include <QVector>
+#include <QByteArray>
+#include <QStringList>
+#include "models.h"
+
+// MinHash signatures + LSH band keys for near-duplicate question detection.
+// Question text is shingled into word 3-grams, every option text is one more
+// shingle (so the option order does not matter). Hashes are computed by our
+// own functions (not qHash) because signatures are stored in the DB.
+class SimilarityIndex
+{
+public:
+    static const int NumHashes = 64;
+    static const int NumBands = 16;
+    static const int RowsPerBand = NumHashes / NumBands;
+
+    // empty when the question has no text to compare
+    static QVector<quint32> signature(const Question &q);
+    // one key per band; questions sharing a key are duplicate candidates
+    static QVector<qint64> bandKeys(const QVector<quint32> &sig);
+    // estimated Jaccard similarity of the shingle sets
+    static double similarity(const QVector<quint32> &a, const QVector<quint32> &b);
+
+    static QByteArray toBlob(const QVector<quint32> &sig);
+    static QVector<quint32> fromBlob(const QByteArray &blob);
+
+private:
+    static QStringList normalizedWords(const QString &text);
+};
+
+#endif // SIMILARITYINDEX_H
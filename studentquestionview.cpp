@@ -0,0 +1,85 @@
+#include "studentquestionview.h"
+#include "answerwidgetpool.h"
+#include <QLabel>
+#include <QVBoxLayout>
+
+StudentQuestionView::StudentQuestionView(QWidget *parent)
+    : QStackedWidget(parent)
+{
+    for (Page &p : mPages) {
+        p.widget = new QWidget;
+        p.label = new QLabel;
+        p.label->setWordWrap(true);
+        p.pool = new AnswerWidgetPool;
+        QVBoxLayout *lay = new QVBoxLayout;
+        lay->setContentsMargins(0,0,0,0);
+        lay->addWidget(p.label);
+        lay->addWidget(p.pool);
+        lay->addStretch(1);
+        p.widget->setLayout(lay);
+        addWidget(p.widget);
+    }
+    setCurrentIndex(mFront);
+}
+
+void StudentQuestionView::reserve(int maxOptions)
+{
+    for (Page &p : mPages) p.pool->reserve(maxOptions);
+}
+
+void StudentQuestionView::bindPage(Page &p, int index, const Question &q, const QVector<int> &order,
+                                   const QStringList &selected, const QString &text)
+{
+    p.label->setText(q.text);
+    p.pool->bind(q, order, selected, text);
+    p.index = index;
+}
+
+void StudentQuestionView::prepare(int index, const Question &q, const QVector<int> &order,
+                                  const QStringList &selected, const QString &text)
+{
+    Page &p = back();
+    bindPage(p, index, q, order, selected, text);
+    // QStackedLayout only resizes the current page; give the hidden one the same
+    // geometry and lay it out now, so the word-wrapped text is not laid out on swap
+    p.widget->setGeometry(front().widget->geometry());
+    if (p.widget->layout()) p.widget->layout()->activate();
+    p.label->heightForWidth(p.label->width());
+}
+
+bool StudentQuestionView::isPrepared(int index) const
+{
+    return index >= 0 && back().index == index;
+}
+
+void StudentQuestionView::showQuestion(int index, const Question &q, const QVector<int> &order,
+                                       const QStringList &selected, const QString &text)
+{
+    if (isPrepared(index)) {
+        mFront = 1 - mFront;
+        setCurrentIndex(mFront);
+    } else {
+        bindPage(front(), index, q, order, selected, text);
+    }
+    // the old page content is stale now
+    back().index = -1;
+}
+
+void StudentQuestionView::clear()
+{
+    for (Page &p : mPages) {
+        p.label->clear();
+        p.pool->clear();
+        p.index = -1;
+    }
+}
+
+QString StudentQuestionView::textAnswer() const
+{
+    return front().pool->textAnswer();
+}
+
+QStringList StudentQuestionView::selectedOptionTexts() const
+{
+    return front().pool->selectedOptionTexts();
+}
@@ -0,0 +1,56 @@
+#ifndef STUDENTQUESTIONVIEW_H
+#define STUDENTQUESTIONVIEW_H
+
+#include <QStackedWidget>
+#include <QVector>
+#include <QStringList>
+#include "models.h"
+
+class QLabel;
+class AnswerWidgetPool;
+
+// Question text + answer controls shown to the student.
+// Two pages are kept: the visible one and a hidden one into which the next
+// question is prepared (bound and laid out) ahead of time. Navigation to the
+// prepared question is then only a page swap.
+class StudentQuestionView : public QStackedWidget
+{
+    Q_OBJECT
+public:
+    explicit StudentQuestionView(QWidget *parent = nullptr);
+
+    void reserve(int maxOptions);
+
+    // bind question index into the hidden page and lay it out
+    void prepare(int index, const Question &q, const QVector<int> &order,
+                 const QStringList &selected = QStringList(), const QString &text = QString());
+    bool isPrepared(int index) const;
+
+    // show question index; uses the prepared page if it matches, otherwise binds directly
+    void showQuestion(int index, const Question &q, const QVector<int> &order,
+                      const QStringList &selected = QStringList(), const QString &text = QString());
+    void clear();
+
+    // answer state of the visible question
+    QString textAnswer() const;
+    QStringList selectedOptionTexts() const;
+
+private:
+    struct Page {
+        QWidget *widget = nullptr;
+        QLabel *label = nullptr;
+        AnswerWidgetPool *pool = nullptr;
+        int index = -1; // index of the bound question, -1 if none
+    };
+    void bindPage(Page &p, int index, const Question &q, const QVector<int> &order,
+                  const QStringList &selected, const QString &text);
+    Page &front() { return mPages[mFront]; }
+    const Page &front() const { return mPages[mFront]; }
+    Page &back() { return mPages[1 - mFront]; }
+    const Page &back() const { return mPages[1 - mFront]; }
+
+    Page mPages[2];
+    int mFront = 0;
+};
+
+#endif // STUDENTQUESTIONVIEW_H
@@ -0,0 +1,164 @@
+#include "testlistmodel.h"
+#include <QHash>
+#include <QDebug>
+
+TestListModel::TestListModel(QVector<Test> *tests, QObject *parent)
+    : QAbstractListModel(parent), mTests(tests)
+{
+}
+
+int TestListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return mTests->size();
+}
+
+QVariant TestListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= mTests->size()) return QVariant();
+    const Test &t = mTests->at(index.row());
+    const DBManager::TestStatistics &s = mStats.at(index.row());
+    if (role == Qt::DisplayRole) {
+        if (!mShowStatistics) return t.name;
+        QString line = QString("%1 otázek · %2 pokusů").arg(s.questionCount).arg(s.attemptCount);
+        if (s.averagePercent >= 0) line += QString(" · průměr %1 %").arg(s.averagePercent, 0, 'f', 0);
+        return t.name + "\n" + line;
+    }
+    if (role == Qt::ToolTipRole) {
+        QString tip = t.description;
+        if (s.questionCount > 0) {
+            if (!tip.isEmpty()) tip += "\n";
+            tip += QString("Otázek v testu: %1").arg(qMin(t.studentCount, s.questionCount));
+        }
+        return tip;
+    }
+    return QVariant();
+}
+
+bool TestListModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return false;
+    return !mAllFetched;
+}
+
+void TestListModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || mAllFetched) return;
+    QString err;
+    if (!fetchPage(&err)) {
+        qDebug() << "Loading test catalog page failed:" << err;
+        mAllFetched = true; // do not retry in a loop from the view
+    }
+}
+
+bool TestListModel::fetchPage(QString *err)
+{
+    DBManager::CatalogQuery query;
+    query.nameFilter = mNameFilter;
+    query.afterRowId = mLastRowId;
+    query.limit = PageSize;
+    QVector<DBManager::CatalogEntry> page;
+    if (!DBManager::instance().loadTestCatalog(query, page, err)) return false;
+    if (page.size() < PageSize) mAllFetched = true;
+    if (page.isEmpty()) return true;
+    mLastRowId = page.last().rowId;
+
+    int first = mTests->size();
+    beginInsertRows(QModelIndex(), first, first + page.size() - 1);
+    for (const DBManager::CatalogEntry &e : std::as_const(page)) {
+        mTests->append(e.test);
+        mStats.append(e.stats);
+    }
+    endInsertRows();
+    return true;
+}
+
+bool TestListModel::loadCatalog(const QString &nameFilter, QString *err)
+{
+    beginResetModel();
+    mTests->clear();
+    mStats.clear();
+    mNameFilter = nameFilter;
+    mLastRowId = 0;
+    mAllFetched = false;
+    endResetModel();
+    return fetchPage(err);
+}
+
+void TestListModel::setTests(QVector<Test> tests)
+{
+    beginResetModel();
+    *mTests = std::move(tests);
+    mStats = QVector<DBManager::TestStatistics>(mTests->size());
+    mNameFilter.clear();
+    mAllFetched = true;
+    endResetModel();
+}
+
+void TestListModel::appendTest(const Test &t)
+{
+    // a new test gets the highest rowid; the last page may already bring it
+    if (rowOfId(t.id) >= 0) return;
+    int row = mTests->size();
+    beginInsertRows(QModelIndex(), row, row);
+    mTests->append(t);
+    mStats.append(DBManager::TestStatistics());
+    endInsertRows();
+}
+
+void TestListModel::removeTest(int row)
+{
+    if (row < 0 || row >= mTests->size()) return;
+    beginRemoveRows(QModelIndex(), row, row);
+    mTests->removeAt(row);
+    mStats.removeAt(row);
+    endRemoveRows();
+}
+
+void TestListModel::testChanged(int row)
+{
+    if (row < 0 || row >= mTests->size()) return;
+    QModelIndex idx = index(row);
+    emit dataChanged(idx, idx);
+}
+
+bool TestListModel::refreshStatistics(const QString &testId, QString *err)
+{
+    if (mTests->isEmpty()) return true;
+    DBManager::CatalogQuery query;
+    query.testId = testId;
+    if (testId.isEmpty()) {
+        query.nameFilter = mNameFilter;
+        query.limit = mTests->size();
+    }
+    QVector<DBManager::CatalogEntry> entries;
+    if (!DBManager::instance().loadTestCatalog(query, entries, err)) return false;
+
+    QHash<QString, int> rowById;
+    for (int i = 0; i < mTests->size(); ++i) rowById.insert(mTests->at(i).id, i);
+    for (const DBManager::CatalogEntry &e : std::as_const(entries)) {
+        const int row = rowById.value(e.test.id, -1);
+        if (row < 0) continue;
+        mStats[row] = e.stats;
+        testChanged(row);
+    }
+    return true;
+}
+
+int TestListModel::rowOfId(const QString &testId)
+{
+    int from = 0;
+    for (;;) {
+        for (int i = from; i < mTests->size(); ++i) {
+            if (mTests->at(i).id == testId) return i;
+        }
+        if (mAllFetched) return -1;
+        from = mTests->size();
+        QString err;
+        if (!fetchPage(&err)) {
+            qDebug() << "Loading test catalog page failed:" << err;
+            mAllFetched = true;
+            return -1;
+        }
+    }
+}
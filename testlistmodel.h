@@ -0,0 +1,56 @@
+#ifndef TESTLISTMODEL_H
+#define TESTLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include "models.h"
+#include "dbmanager.h"
+
+// List model over the tests vector owned by MainWindow (mTests).
+// All modifications go through the model so that views get row-level
+// signals instead of being cleared and repopulated.
+// Tests come from the DBManager test catalog page by page (fetchMore), optionally
+// filtered by name, together with their question / attempt counts (kept parallel to mTests).
+class TestListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    static const int PageSize = 200;
+
+    explicit TestListModel(QVector<Test> *tests, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    // teacher list: attempts and average score under the name
+    void setShowStatistics(bool show) { mShowStatistics = show; }
+    // replace content by the first catalog page; nameFilter empty = all tests
+    bool loadCatalog(const QString &nameFilter = QString(), QString *err = nullptr);
+    QString nameFilter() const { return mNameFilter; }
+    bool allFetched() const { return mAllFetched; }
+    // fixed list without statistics (exam package)
+    void setTests(QVector<Test> tests);
+    void appendTest(const Test &t);
+    void removeTest(int row);
+    // call after mTests[row] was modified in place
+    void testChanged(int row);
+    // reload aggregates after questions / results of the test changed; testId empty = all rows
+    bool refreshStatistics(const QString &testId, QString *err = nullptr);
+
+    // row of test with given id, pages are fetched until it is found; -1 if not present
+    int rowOfId(const QString &testId);
+
+private:
+    bool fetchPage(QString *err);
+
+    QVector<Test> *mTests;
+    QVector<DBManager::TestStatistics> mStats; // parallel to *mTests
+    QString mNameFilter;
+    qint64 mLastRowId = 0; // keyset cursor (tests.rowid of last loaded row)
+    bool mAllFetched = true;
+    bool mShowStatistics = false;
+};
+
+#endif // TESTLISTMODEL_H
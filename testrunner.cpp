@@ -1,18 +1,18 @@
 #include "testrunner.h"
+#include "answerwidgetpool.h"
+#include "grading.h"
+#include "resultreport.h"
+#include "mailqueue.h"
 #include <QLabel>
 #include <QPushButton>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
-#include <QRadioButton>
-#include <QCheckBox>
 #include <QLineEdit>
-#include <QButtonGroup>
 #include <QMessageBox>
 #include <QRandomGenerator>
 #include <algorithm>
-#include <QDesktopServices>
-#include <QUrl>
-#include <QUrlQuery>
+#include <QDateTime>
+#include <QDebug>
 
 Testrunner::Testrunner(QWidget *parent)
     : QDialog(parent)
@@ -23,17 +23,14 @@ Testrunner::Testrunner(QWidget *parent)
     mLblProgress = new QLabel;
     mLblQuestion = new QLabel;
     mLblQuestion->setWordWrap(true);
-    mAnswerWidget = new QWidget;
-    QVBoxLayout *aw = new QVBoxLayout;
-    aw->setContentsMargins(0,0,0,0);
-    mAnswerWidget->setLayout(aw);
+    mAnswerPool = new AnswerWidgetPool;
 
     mBtnNext = new QPushButton("Další");
     mBtnSubmit = new QPushButton("Odevzdat test");
 
     mEditStudentEmail = new QLineEdit;
     mEditStudentEmail->setPlaceholderText("Zadejte svůj e-mail pro zaslání výsledků (volitelné)");
-    mBtnSendEmail = new QPushButton("Odeslat výsledky emailem (otevře pošt. klient)");
+    mBtnSendEmail = new QPushButton("Odeslat výsledky e-mailem");
 
     QHBoxLayout *btns = new QHBoxLayout;
     btns->addWidget(mBtnNext);
@@ -41,7 +38,7 @@ Testrunner::Testrunner(QWidget *parent)
 
     main->addWidget(mLblProgress);
     main->addWidget(mLblQuestion);
-    main->addWidget(mAnswerWidget);
+    main->addWidget(mAnswerPool);
     main->addLayout(btns);
     main->addWidget(mEditStudentEmail);
     main->addWidget(mBtnSendEmail);
@@ -98,6 +95,12 @@ void Testrunner::startTest()
     mUserAnswers.clear();
     mUserAnswers.resize(mTestQuestions.size());
     mCurrentIndex = 0;
+
+    QStringList ids;
+    for (const Question &q : std::as_const(mTestQuestions)) ids.append(q.id);
+    QString err;
+    if (!mJournal.begin(mTestId, mEditStudentEmail->text().trimmed(), ids, &err))
+        qDebug() << "Answer journal not available:" << err;
     showCurrentQuestion();
     exec();
 }
@@ -112,71 +115,40 @@ void Testrunner::prepareRandomTest()
     for (int i = 0; i < total; ++i) idx.append(i);
     std::shuffle(idx.begin(), idx.end(), *QRandomGenerator::global());
     mTestQuestions.clear();
-    for (int i = 0; i < n; ++i) mTestQuestions.append(mAllQuestions[idx[i]]);
+    int maxOptions = 0;
+    for (int i = 0; i < n; ++i) {
+        mTestQuestions.append(mAllQuestions[idx[i]]);
+        maxOptions = qMax(maxOptions, static_cast<int>(mTestQuestions.last().options.size()));
+    }
+    // widgets for the largest question are created up front
+    mAnswerPool->reserve(maxOptions);
 }
 
 void Testrunner::showCurrentQuestion()
 {
-    // clear previous answer widgets
-    QLayout *lay = mAnswerWidget->layout();
-    QLayoutItem *child;
-    while ((child = lay->takeAt(0)) != nullptr) {
-        if (child->widget()) {
-            child->widget()->deleteLater();
-        }
-        delete child;
+    if (mCurrentIndex < 0 || mCurrentIndex >= mTestQuestions.size()) {
+        mAnswerPool->clear();
+        return;
     }
-    mCurrentAnswerWidgets.clear();
-
-    if (mCurrentIndex < 0 || mCurrentIndex >= mTestQuestions.size()) return;
 
     const Question &q = mTestQuestions[mCurrentIndex];
     mLblProgress->setText(QString("Otázka %1 / %2").arg(mCurrentIndex+1).arg(mTestQuestions.size()));
     mLblQuestion->setText(q.text);
 
+    // restore previous if exists
+    const StoredAnswer &sa = mUserAnswers[mCurrentIndex];
     if (q.type == QuestionType::TextAnswer) {
-        QLineEdit *le = new QLineEdit;
-        // restore previous if exists
-        const StoredAnswer &sa = mUserAnswers[mCurrentIndex];
-        if (!sa.textAnswer.isEmpty()) le->setText(sa.textAnswer);
-        lay->addWidget(le);
-        mCurrentAnswerWidgets.append(le);
-    } else {
-        // shuffle options
-        int m = q.options.size();
-        QVector<int> indices;
-        for (int i=0;i<m;++i) indices.append(i);
-        std::shuffle(indices.begin(), indices.end(), *QRandomGenerator::global());
-
-        if (q.type == QuestionType::SingleChoice) {
-            QButtonGroup *grp = new QButtonGroup(this);
-            grp->setExclusive(true);
-            for (int i = 0; i < m; ++i) {
-                int origIdx = indices[i];
-                QRadioButton *rb = new QRadioButton(q.options[origIdx].text);
-                lay->addWidget(rb);
-                grp->addButton(rb, origIdx);
-                mCurrentAnswerWidgets.append(rb);
-                // restore selection if present
-                const StoredAnswer &sa = mUserAnswers[mCurrentIndex];
-                if (!sa.selectedOptionsTexts.isEmpty()) {
-                    if (sa.selectedOptionsTexts.contains(q.options[origIdx].text)) rb->setChecked(true);
-                }
-            }
-        } else { // multiple
-            for (int i = 0; i < m; ++i) {
-                int origIdx = indices[i];
-                QCheckBox *cb = new QCheckBox(q.options[origIdx].text);
-                lay->addWidget(cb);
-                mCurrentAnswerWidgets.append(cb);
-                // restore selection if present
-                const StoredAnswer &sa = mUserAnswers[mCurrentIndex];
-                if (!sa.selectedOptionsTexts.isEmpty()) {
-                    if (sa.selectedOptionsTexts.contains(q.options[origIdx].text)) cb->setChecked(true);
-                }
-            }
-        }
+        mAnswerPool->bind(q, QVector<int>(), QStringList(), sa.textAnswer);
+        return;
     }
+
+    // shuffle options
+    int m = q.options.size();
+    QVector<int> indices;
+    indices.reserve(m);
+    for (int i=0;i<m;++i) indices.append(i);
+    std::shuffle(indices.begin(), indices.end(), *QRandomGenerator::global());
+    mAnswerPool->bind(q, indices, sa.selectedOptionsTexts);
 }
 
 void Testrunner::saveCurrentAnswerForIndex(int index)
@@ -187,32 +159,17 @@ void Testrunner::saveCurrentAnswerForIndex(int index)
     const Question &q = mTestQuestions[index];
 
     if (q.type == QuestionType::TextAnswer) {
-        if (!mCurrentAnswerWidgets.isEmpty()) {
-            QLineEdit *le = qobject_cast<QLineEdit*>(mCurrentAnswerWidgets.first());
-            if (le) sa.textAnswer = le->text().trimmed();
-        }
-    } else if (q.type == QuestionType::SingleChoice) {
-        for (const QWidget *w : std::as_const(mCurrentAnswerWidgets)) {
-            const QRadioButton *rb = qobject_cast<const QRadioButton*>(w);
-
-            if (!rb) {
-                continue;
-            }
-
-            if (rb->isChecked()) {
-                sa.selectedOptionsTexts.append(rb->text());
-            }
-        }
-    } else { // multiple
-        for (const QWidget *w : std::as_const(mCurrentAnswerWidgets)) {
-            const QCheckBox *cb = qobject_cast<const QCheckBox*>(w);
-            if (!cb)
-                continue;
-            if (cb->isChecked())
-                sa.selectedOptionsTexts.append(cb->text());
-        }
+        sa.textAnswer = mAnswerPool->textAnswer();
+    } else {
+        sa.selectedOptionsTexts = mAnswerPool->selectedOptionTexts();
     }
 
+    // journal only real changes; same string form as the embedded student runner
+    const StoredAnswer &prev = mUserAnswers[index];
+    if (prev.textAnswer != sa.textAnswer || prev.selectedOptionsTexts != sa.selectedOptionsTexts) {
+        mJournal.recordAnswer(index, sa.questionId, q.type == QuestionType::TextAnswer
+                                                        ? sa.textAnswer : sa.selectedOptionsTexts.join(";@ "));
+    }
     mUserAnswers[index] = sa;
 }
 
@@ -246,6 +203,7 @@ void Testrunner::onSubmit()
     if (!DBManager::instance().saveResult(email, mTestId, score, mTestQuestions.size(), details, &err)) {
         QMessageBox::warning(this, "Chyba ukládání výsledku", err);
     } else {
+        mJournal.finish();
         QMessageBox::information(this, "Uloženo", "Výsledek byl uložen do databáze.");
     }
 
@@ -254,81 +212,39 @@ void Testrunner::onSubmit()
 
 double Testrunner::evaluateAndReturnScore(QVector<DBManager::ResultDetail> &outDetails)
 {
-    double totalScore = 0.0;
-    outDetails.clear();
+    // choices are graded in the stored string form (texts joined by ";@ ")
+    QVector<QString> answers;
+    answers.reserve(mUserAnswers.size());
     for (int i = 0; i < mTestQuestions.size(); ++i) {
-        const Question &q = mTestQuestions[i];
         const StoredAnswer &sa = mUserAnswers[i];
-        bool correct = false;
-        QString ua; // description of user answer
-
-        if (q.type == QuestionType::TextAnswer) {
-            QString given = sa.textAnswer.trimmed();
-            QString expected = q.expectedText.trimmed();
-            ua = given;
-            if (QString::compare(given, expected, Qt::CaseInsensitive) == 0 && !expected.isEmpty()) {
-                correct = true;
-            }
-        } else if (q.type == QuestionType::SingleChoice) {
-            // find which selected text is correct
-            ua = sa.selectedOptionsTexts.join(";@ ");
-            for (int oi = 0; oi < q.options.size(); ++oi) {
-                const Answer &a = q.options[oi];
-                if (a.correct) {
-                    if (sa.selectedOptionsTexts.contains(a.text)) correct = true;
-                    break;
-                }
-            }
-        } else if (q.type == QuestionType::MultipleChoice) {
-            // require exact match of selected set == correct set
-            QStringList correctTexts;
-            for (const Answer &a : q.options) if (a.correct) correctTexts.append(a.text);
-            QStringList sel = sa.selectedOptionsTexts;
-            ua = sel.join(";@ ");
-            // compare as sets
-            auto normalize = [](QStringList l) {
-                for (QString &s : l) s = s.trimmed();
-                std::sort(l.begin(), l.end());
-                return l;
-            };
-            QStringList nl = normalize(correctTexts);
-            QStringList ns = normalize(sel);
-            correct = (nl == ns);
-        }
-
-        if (correct) totalScore += 1.0;
-
-        DBManager::ResultDetail rd;
-        rd.questionId = q.id;
-        rd.correct = correct;
-        rd.userAnswer = ua;
-        outDetails.append(rd);
+        answers.append(mTestQuestions[i].type == QuestionType::TextAnswer
+                           ? sa.textAnswer.trimmed() : sa.selectedOptionsTexts.join(";@ "));
     }
-    return totalScore;
+    return Grading::gradeAttempt(mTestQuestions, answers, &outDetails);
 }
 
 void Testrunner::onSendEmail()
 {
-    // Build mailto URL with subject and body from last evaluated answers (we'll evaluate now but do not save)
-    QVector<DBManager::ResultDetail> details;
-    double score = evaluateAndReturnScore(details);
-    QString body;
-    body += QString("Skore: %1 / %2\n\n").arg(score).arg(mTestQuestions.size());
-    for (int i = 0; i < details.size(); ++i) {
-        body += QString("Otázka %1: %2\n").arg(i+1).arg(details[i].correct ? "OK" : "Špatně");
-        body += QString("Odpověď studenta: %1\n\n").arg(details[i].userAnswer);
+    // the report goes to the mail queue, sent by the teacher's editor or --send-mail
+    const QString to = mEditStudentEmail->text().trimmed();
+    if (!MailTransport::isValidAddress(to)) {
+        QMessageBox::warning(this, "Chybný e-mail", "Zadejte platnou e-mailovou adresu.");
+        return;
     }
+    DBManager::ResultRecord r;
+    r.studentEmail = to;
+    r.testId = mTestId;
+    r.score = evaluateAndReturnScore(r.details);
+    r.total = mTestQuestions.size();
+    r.timestamp = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    ResultReport::TestInfo info;
+    info.name = mTestName;
+    for (const Question &q : std::as_const(mTestQuestions)) info.questions.insert(q.id, q);
 
-    QUrl mailto;
-    QString to = mEditStudentEmail->text().trimmed();
-    mailto.setScheme("mailto");
-    mailto.setPath(to);
-    QUrlQuery q;
-    QString subject = "Výsledek testu";
-    if (!mTestName.isEmpty()) subject += ": " + mTestName;
-    q.addQueryItem("subject", subject);
-    q.addQueryItem("body", body);
-    mailto.setQuery(q);
-
-    QDesktopServices::openUrl(mailto);
+    QString err;
+    if (!DBManager::instance().enqueueMails({ ResultReport::render(r, info) }, nullptr, &err)) {
+        QMessageBox::warning(this, "Chyba při odesílání", err);
+        return;
+    }
+    QMessageBox::information(this, "Výsledky", "Výsledky byly zařazeny k odeslání na " + to + ".");
 }
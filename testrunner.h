@@ -4,11 +4,13 @@
 #include <QDialog>
 #include "models.h"
 #include "dbmanager.h"
+#include "answerjournal.h"
 
 class QLabel;
 class QPushButton;
 class QLineEdit;
 class QWidget;
+class AnswerWidgetPool;
 
 class Testrunner : public QDialog
 {
@@ -42,7 +44,7 @@ private:
     // UI
     QLabel *mLblProgress;
     QLabel *mLblQuestion;
-    QWidget *mAnswerWidget; // holder for dynamic widgets
+    AnswerWidgetPool *mAnswerPool; // reusable answer widgets
     QPushButton *mBtnNext;
     QPushButton *mBtnSubmit;
 
@@ -50,8 +52,7 @@ private:
     QLineEdit *mEditStudentEmail;
     QPushButton *mBtnSendEmail;
 
-    // per-question dynamic widgets & storage
-    QList<QWidget*> mCurrentAnswerWidgets;
+    // per-question answer storage
     struct StoredAnswer {
         QString questionId;
         // for choices: store selected option texts (matching by text)
@@ -64,6 +65,8 @@ private:
     // store current test id/name for saving results / email subject
     QString mTestId;
     QString mTestName;
+
+    AnswerJournal mJournal; // crash-safe log of the answers given so far
 };
 
 #endif // TESTRUNNER_H
@@ -0,0 +1,247 @@
+#include "variantprinter.h"
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+#include <QMutex>
+#include <QDir>
+#include <QFileInfo>
+#include <QFontDatabase>
+#include <QPdfWriter>
+#include <QPageLayout>
+#include <QTextDocument>
+#include <QDebug>
+
+VariantPrinter::VariantPrinter(QObject *parent)
+    : QObject(parent)
+{
+}
+
+VariantPrinter::~VariantPrinter()
+{
+    if (mWorker) {
+        mCancel = true;
+        mWorker->wait();
+    }
+}
+
+// checks shared by both paths; the seeds of all variants are drawn up front,
+// so variant k is the same whichever thread renders it
+static bool prepareJob(const ExamSessionManager::QuestionBank &bank, const VariantPrinter::Options &o,
+                       QVector<quint32> *seeds, quint32 *jobSeed, QString *err)
+{
+    if (bank.questions.isEmpty()) {
+        if (err) *err = "Test has no questions";
+        return false;
+    }
+    seeds->clear();
+    if (o.count <= 0) return true;
+    if (!QDir().mkpath(o.directory) || !QFileInfo(o.directory).isWritable()) {
+        if (err) *err = "Cannot write to " + o.directory;
+        return false;
+    }
+    *jobSeed = o.seed ? o.seed : QRandomGenerator::global()->generate();
+    QRandomGenerator gen(*jobSeed);
+    seeds->resize(o.count);
+    for (quint32 &s : *seeds) s = gen.generate();
+    return true;
+}
+
+static int numberWidth(int count)
+{
+    return qMax(3, int(QString::number(count).size()));
+}
+
+void VariantPrinter::start(const ExamSessionManager::QuestionBank &bank, const Options &o)
+{
+    if (isRunning()) return; // previous job still running
+    mCancel = false;
+    if (!QFontDatabase::supportsThreadedFontRendering()) {
+        // text layout only works on the GUI thread here: one variant per event loop pass,
+        // so the window stays responsive and cancel() is seen between variants
+        auto job = std::make_unique<InlineJob>();
+        QString err;
+        if (!prepareJob(bank, o, &job->seeds, &job->jobSeed, &err)) {
+            emit finished(false, err);
+            return;
+        }
+        job->bank = bank;
+        job->options = o;
+        mInline = std::move(job);
+        QTimer::singleShot(0, this, &VariantPrinter::printNextInline);
+        return;
+    }
+    auto progressFn = [this, o](int done) { emit progress(done, o.count); };
+    auto result = std::make_shared<QString>();
+    auto ok = std::make_shared<bool>(false);
+    QThread *worker = QThread::create([this, bank, o, progressFn, result, ok]() {
+        *ok = printVariants(bank, o, &mCancel, progressFn, result.get());
+    });
+    worker->setObjectName("variant-printer");
+    connect(worker, &QThread::finished, this, [this, worker, o, result, ok]() {
+        worker->deleteLater();
+        mWorker = nullptr;
+        if (*ok) qDebug() << "Variants written to" << o.directory;
+        else qDebug() << "Printing variants failed:" << *result;
+        emit finished(*ok, *ok ? o.directory : *result);
+    });
+    mWorker = worker;
+    worker->start();
+}
+
+void VariantPrinter::printNextInline()
+{
+    if (!mInline) return;
+    InlineJob &job = *mInline;
+    const Options &o = job.options;
+    bool ok = true;
+    QString err;
+    if (mCancel) {
+        ok = false;
+        err = QString("Cancelled after %1 of %2 variants").arg(job.done).arg(o.count);
+    } else if (job.done < o.count) {
+        ok = printVariant(job.bank, job.done + 1, numberWidth(o.count), job.seeds[job.done], job.jobSeed,
+                          o.directory, &err);
+        if (ok) emit progress(++job.done, o.count);
+    }
+    if (ok && job.done < o.count) {
+        QTimer::singleShot(0, this, &VariantPrinter::printNextInline);
+        return;
+    }
+    const QString directory = o.directory;
+    mInline.reset();
+    if (ok) qDebug() << "Variants written to" << directory;
+    else qDebug() << "Printing variants failed:" << err;
+    emit finished(ok, ok ? directory : err);
+}
+
+bool VariantPrinter::printVariants(const ExamSessionManager::QuestionBank &bank, const Options &o,
+                                   const std::atomic<bool> *cancel, const std::function<void(int)> &progress,
+                                   QString *err)
+{
+    QVector<quint32> seeds;
+    quint32 jobSeed = 0;
+    if (!prepareJob(bank, o, &seeds, &jobSeed, err)) return false;
+    if (seeds.isEmpty()) return true;
+    const int width = numberWidth(o.count);
+
+    std::atomic<int> next{0};
+    std::atomic<int> done{0};
+    std::atomic<bool> failed{false};
+    QMutex errLock;
+    QString firstError;
+    auto work = [&]() {
+        for (;;) {
+            if (failed || (cancel && *cancel)) return;
+            const int v = next++;
+            if (v >= o.count) return;
+            QString e;
+            if (!printVariant(bank, v + 1, width, seeds[v], jobSeed, o.directory, &e)) {
+                QMutexLocker lock(&errLock);
+                if (!failed.exchange(true)) firstError = e;
+                return;
+            }
+            const int n = ++done;
+            if (progress) progress(n);
+        }
+    };
+
+    if (!QFontDatabase::supportsThreadedFontRendering()) {
+        work();
+    } else {
+        // a few long-running tasks pulling variant numbers, rather than one task per variant
+        QThreadPool pool;
+        const int threads = o.threads > 0 ? o.threads : QThread::idealThreadCount();
+        pool.setMaxThreadCount(qBound(1, threads, o.count));
+        for (int i = 0; i < pool.maxThreadCount(); ++i) pool.start(work);
+        pool.waitForDone();
+    }
+
+    if (failed) {
+        if (err) *err = firstError;
+        return false;
+    }
+    if (cancel && *cancel) {
+        if (err) *err = QString("Cancelled after %1 of %2 variants").arg(int(done)).arg(o.count);
+        return false;
+    }
+    return true;
+}
+
+static QString htmlText(const QString &s)
+{
+    QString out = s.toHtmlEscaped();
+    out.replace('\n', "<br>");
+    return out;
+}
+
+static QString optionLabel(int k)
+{
+    return k < 26 ? QString(QChar('A' + k)) : QString::number(k + 1);
+}
+
+static bool writePdf(const QString &path, const QString &title, const QString &html, QString *err)
+{
+    QPdfWriter writer(path);
+    writer.setPageSize(QPageSize(QPageSize::A4));
+    writer.setPageMargins(QMarginsF(15, 15, 15, 15), QPageLayout::Millimeter);
+    writer.setResolution(300);
+    writer.setTitle(title);
+    writer.setCreator("QtTestMaker");
+    QTextDocument doc;
+    doc.setHtml(html);
+    doc.print(&writer);
+    // QPdfWriter only warns when the file cannot be opened
+    if (QFileInfo(path).size() == 0) {
+        if (err) *err = "Cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool VariantPrinter::printVariant(const ExamSessionManager::QuestionBank &bank, int number, int numberWidth,
+                                  quint32 seed, quint32 jobSeed, const QString &directory, QString *err)
+{
+    QRandomGenerator rng(seed);
+    const QVector<quint32> drawn = ExamSessionManager::drawQuestions(bank, rng);
+    const QString name = bank.test.name.toHtmlEscaped();
+    const QString variant = QString::number(number);
+
+    QString sheet;
+    QString key;
+    sheet.reserve(4096);
+    sheet += "<h2>" + name + "</h2>";
+    sheet += "<p>Varianta " + variant + "&nbsp;&nbsp;&nbsp;&nbsp;Jméno: ______________________________</p>";
+    if (!bank.test.description.isEmpty()) sheet += "<p>" + htmlText(bank.test.description) + "</p>";
+    sheet += "<ol>";
+    key += "<h2>Klíč: " + name + ", varianta " + variant + "</h2>";
+    key += QString("<p>Sada %1, kód varianty %2</p>").arg(jobSeed).arg(seed, 8, 16, QChar('0'));
+    key += "<table border=\"1\" cellspacing=\"0\" cellpadding=\"4\"><tr><th>Otázka</th><th>Správná odpověď</th></tr>";
+
+    for (int i = 0; i < drawn.size(); ++i) {
+        const Question q = ExamSessionManager::presented(bank, drawn[i], seed);
+        sheet += "<li><p>" + htmlText(q.text);
+        QString answer;
+        if (q.type == QuestionType::TextAnswer) {
+            sheet += "</p><p>Odpověď: ______________________________</p>";
+            answer = htmlText(q.expectedText);
+        } else {
+            sheet += q.type == QuestionType::MultipleChoice ? " <i>(může být více správných)</i></p>" : "</p>";
+            const QVector<int> order = ExamSessionManager::optionOrder(seed, i, q.options.size());
+            QStringList correct;
+            for (int k = 0; k < order.size(); ++k) {
+                const Answer &a = q.options[order[k]];
+                sheet += "<p>&#9744; " + optionLabel(k) + ") " + htmlText(a.text) + "</p>";
+                if (a.correct) correct.append(optionLabel(k));
+            }
+            answer = correct.join(", ");
+        }
+        sheet += "</li>";
+        key += QString("<tr><td>%1</td><td>%2</td></tr>").arg(i + 1).arg(answer);
+    }
+    sheet += "</ol>";
+    key += "</table>";
+
+    const QString base = QDir(directory).filePath(QString("varianta-%1").arg(number, numberWidth, 10, QChar('0')));
+    return writePdf(base + ".pdf", bank.test.name + " - varianta " + variant, sheet, err)
+        && writePdf(base + "-klic.pdf", bank.test.name + " - klíč, varianta " + variant, key, err);
+}
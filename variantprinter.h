@@ -0,0 +1,72 @@
+#ifndef VARIANTPRINTER_H
+#define VARIANTPRINTER_H
+
+#include <QObject>
+#include <QPointer>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include "examsessionmanager.h"
+
+class QThread;
+
+// Printable variants of a test for exams on paper.
+//
+// Every variant is drawn like an attempt on the exam host (blueprint strata,
+// question order, option order and template values all follow from one
+// per-variant seed, see ExamSessionManager) and written as two PDFs into the
+// output directory: varianta-NNN.pdf for the student and varianta-NNN-klic.pdf
+// with the answer key. Variants are independent, so they are rendered on a
+// thread pool with one QTextDocument/QPdfWriter per variant; the per-variant
+// seeds come from one job seed, which is printed on the keys and reproduces
+// the whole set (--seed on the command line).
+class VariantPrinter : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options {
+        QString directory;
+        int count = 30;
+        quint32 seed = 0; // 0 = random
+        int threads = 0;  // 0 = all cores
+    };
+
+    explicit VariantPrinter(QObject *parent = nullptr);
+    ~VariantPrinter() override;
+
+    bool isRunning() const { return mWorker != nullptr || mInline != nullptr; }
+    // renders in the background, reports through progress() and finished()
+    void start(const ExamSessionManager::QuestionBank &bank, const Options &o);
+    void cancel() { mCancel = true; }
+
+    // synchronous (worker thread body, also used by the CLI); progress is
+    // called from the pool threads with the number of variants done; without
+    // threaded font rendering everything runs on the calling thread
+    static bool printVariants(const ExamSessionManager::QuestionBank &bank, const Options &o,
+                              const std::atomic<bool> *cancel = nullptr,
+                              const std::function<void(int)> &progress = {}, QString *err = nullptr);
+    // one variant and its key; thread safe
+    static bool printVariant(const ExamSessionManager::QuestionBank &bank, int number, int numberWidth,
+                             quint32 seed, quint32 jobSeed, const QString &directory, QString *err = nullptr);
+
+signals:
+    void progress(int done, int total);
+    void finished(bool ok, const QString &directoryOrError);
+
+private:
+    // job run on the GUI thread when fonts cannot be rendered on other threads
+    struct InlineJob {
+        ExamSessionManager::QuestionBank bank;
+        Options options;
+        QVector<quint32> seeds;
+        quint32 jobSeed = 0;
+        int done = 0;
+    };
+    void printNextInline();
+
+    QPointer<QThread> mWorker;
+    std::unique_ptr<InlineJob> mInline;
+    std::atomic<bool> mCancel{false};
+};
+
+#endif // VARIANTPRINTER_H